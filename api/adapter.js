@@ -23,6 +23,7 @@ const Descriptor = require('./descriptor');
 const AdType = require('./util/adType');
 const Converter = require('./util/sdConv');
 const ToText = require('./util/toText');
+const EventBatch = require('./util/eventBatch');
 const logLevel = require('./util/logLevel');
 const Security = require('./security');
 
@@ -246,6 +247,13 @@ class Adapter extends EventEmitter {
                 retransmissionInterval: 100,
                 responseTimeout: 750,
                 enableBLE: true,
+                transmitWindowSize: 7,
+                eventFormat: 'object',
+                eventQueueMemoryLimit: 16 * 1024 * 1024,
+                eventQueueHighWatermark: 1024,
+                eventBatchMaxCount: 256,
+                eventBatchMaxLatency: 10,
+                eventCoalescing: false,
             };
         } else {
             if (!options.baudRate) options.baudRate = 115200;
@@ -256,6 +264,13 @@ class Adapter extends EventEmitter {
             if (!options.retransmissionInterval) options.retransmissionInterval = 100;
             if (!options.responseTimeout) options.responseTimeout = 750;
             if ((typeof options.enableBLE) == 'undefined') options.enableBLE = true;
+            if (!options.transmitWindowSize) options.transmitWindowSize = 7;
+            if (!options.eventFormat) options.eventFormat = 'object';
+            if (!options.eventQueueMemoryLimit) options.eventQueueMemoryLimit = 16 * 1024 * 1024;
+            if (!options.eventQueueHighWatermark) options.eventQueueHighWatermark = 1024;
+            if (!options.eventBatchMaxCount) options.eventBatchMaxCount = 256;
+            if ((typeof options.eventBatchMaxLatency) == 'undefined') options.eventBatchMaxLatency = 10;
+            if ((typeof options.eventCoalescing) == 'undefined') options.eventCoalescing = false;
         }
 
         this._changeState({baudRate: options.baudRate, parity: options.parity, flowControl: options.flowControl});
@@ -291,8 +306,13 @@ class Adapter extends EventEmitter {
         });
     }
 
-    getStats() {
-        return this._adapter.getStats();
+    /**
+     * Get statistics of the events received from the Adapter.
+     * With options.histograms set to true, latencies in nanoseconds ({count, min, max, p50, p99, p999}) are included
+     * for each stage of the event pipeline, and round trip times of the commands sent, keyed by op code.
+     */
+    getStats(options) {
+        return this._adapter.getStats(options || {});
     }
 
     enableBLE(options, callback) {
@@ -354,11 +374,18 @@ class Adapter extends EventEmitter {
         this.emit('logMessage', severity, message);
     }
 
-    _eventCallback(eventArray) {
-        eventArray.forEach(event => {
-            const text = new ToText(event);
-            // TODO: set the correct level for different types of events:
-            this.emit('logMessage', logLevel.DEBUG, text.toString());
+    // Called with an array of event objects, or with a binary event batch and the events in it that are
+    // delivered as objects when the adapter is opened with eventFormat 'binary'.
+    _eventCallback(eventArray, eventObjects) {
+        const events = eventObjects !== undefined ? new EventBatch(eventArray, eventObjects, this._bleDriver) : eventArray;
+
+        events.forEach(event => {
+            // Events packed in binary batches are not logged, creating the text would decode every property
+            if (!(event instanceof EventBatch.BinaryEvent)) {
+                const text = new ToText(event);
+                // TODO: set the correct level for different types of events:
+                this.emit('logMessage', logLevel.DEBUG, text.toString());
+            }
 
             switch (event.id) {
                 case this._bleDriver.BLE_GAP_EVT_CONNECTED:
@@ -1609,6 +1636,11 @@ class Adapter extends EventEmitter {
     // Only for central
 
     // options: { active: x, interval: x, window: x timeout: x TODO: other params}. Callback signature function(err).
+    // options.filter drops advertising reports natively, before they reach JavaScript:
+    // { addresses: ['AA:BB:CC:DD:EE:FF'], excludeAddresses: [], serviceUuids: ['180D'], manufacturerIds: [0x0059],
+    //   namePrefix: 'Nordic', minRssi: -80, deduplicate: true, refreshPeriod: 1000 }
+    // A report passes if it matches any of addresses, serviceUuids, manufacturerIds or namePrefix, or if none are given.
+    // With deduplicate, unchanged reports from an address are dropped until refreshPeriod ms have passed.
     startScan(options, callback) {
         this._adapter.gapStartScan(options, err => {
             if (err) {
@@ -0,0 +1,342 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+'use strict';
+
+// Reader for the event batches delivered by the addon when the adapter is opened with eventFormat 'binary'.
+// The layout is documented in src/event_batch.h.
+
+const BATCH_VERSION = 1;
+const BATCH_HEADER_LENGTH = 8;
+const RECORD_HEADER_LENGTH = 16;
+const RECORD_PACKED = 1;
+
+const PACKED_EVENT_NAMES = [
+    'BLE_EVT_TX_COMPLETE',
+    'BLE_GAP_EVT_RSSI_CHANGED',
+    'BLE_GAP_EVT_ADV_REPORT',
+    'BLE_GATTC_EVT_HVX',
+];
+
+// Names of the constants exported by the driver with the given prefix, indexed by value
+function constantNames(bleDriver, prefix) {
+    const names = {};
+
+    for (let name in bleDriver) {
+        if (name.indexOf(prefix) === 0 && typeof bleDriver[name] === 'number') {
+            names[bleDriver[name]] = name;
+        }
+    }
+
+    return names;
+}
+
+function hex16(value) {
+    return ('000' + value.toString(16).toUpperCase()).slice(-4);
+}
+
+function hex8(value) {
+    return ('0' + value.toString(16).toUpperCase()).slice(-2);
+}
+
+// Names used by the driver, looked up once per driver
+class EventNames {
+    constructor(bleDriver) {
+        this.events = {};
+
+        for (let name of PACKED_EVENT_NAMES) {
+            this.events[bleDriver[name]] = name;
+        }
+
+        this.addressTypes = constantNames(bleDriver, 'BLE_GAP_ADDR_TYPE_');
+        this.advertisingTypes = constantNames(bleDriver, 'BLE_GAP_ADV_TYPE_');
+        this.adTypes = constantNames(bleDriver, 'BLE_GAP_AD_TYPE_');
+        this.gattStatus = constantNames(bleDriver, 'BLE_GATT_STATUS_');
+
+        const flags = constantNames(bleDriver, 'BLE_GAP_ADV_FLAG');
+        this.advertisingFlags = Object.keys(flags)
+            .map(value => parseInt(value, 10))
+            .sort((a, b) => a - b)
+            .map(value => ({ value: value, name: flags[value] }));
+
+        this.advReport = bleDriver.BLE_GAP_EVT_ADV_REPORT;
+        this.flagsAdType = bleDriver.BLE_GAP_AD_TYPE_FLAGS;
+        this.shortNameAdType = bleDriver.BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME;
+        this.completeNameAdType = bleDriver.BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME;
+        this.uuid16AdTypes = [bleDriver.BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE, bleDriver.BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE];
+        this.uuid32AdTypes = [bleDriver.BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_MORE_AVAILABLE, bleDriver.BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_COMPLETE];
+        this.uuid128AdTypes = [bleDriver.BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE, bleDriver.BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE];
+        this.txPowerAdType = bleDriver.BLE_GAP_AD_TYPE_TX_POWER_LEVEL;
+
+        // Shortest value of the AD types, as checked by src/ad_structures.cpp
+        this.adMinimumLengths = {};
+        const minimumLengths = {
+            BLE_GAP_AD_TYPE_FLAGS: 1,
+            BLE_GAP_AD_TYPE_TX_POWER_LEVEL: 1,
+            BLE_GAP_AD_TYPE_SECURITY_MANAGER_OOB_FLAGS: 1,
+            BLE_GAP_AD_TYPE_LE_ROLE: 1,
+            BLE_GAP_AD_TYPE_URI: 1,
+            BLE_GAP_AD_TYPE_APPEARANCE: 2,
+            BLE_GAP_AD_TYPE_ADVERTISING_INTERVAL: 2,
+            BLE_GAP_AD_TYPE_3D_INFORMATION_DATA: 2,
+            BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA: 2,
+            BLE_GAP_AD_TYPE_SERVICE_DATA: 2,
+            BLE_GAP_AD_TYPE_CLASS_OF_DEVICE: 3,
+            BLE_GAP_AD_TYPE_SLAVE_CONNECTION_INTERVAL_RANGE: 4,
+            BLE_GAP_AD_TYPE_SERVICE_DATA_32BIT_UUID: 4,
+            BLE_GAP_AD_TYPE_PUBLIC_TARGET_ADDRESS: 6,
+            BLE_GAP_AD_TYPE_RANDOM_TARGET_ADDRESS: 6,
+            BLE_GAP_AD_TYPE_LE_BLUETOOTH_DEVICE_ADDRESS: 7,
+            BLE_GAP_AD_TYPE_SIMPLE_PAIRING_HASH_C: 16,
+            BLE_GAP_AD_TYPE_SIMPLE_PAIRING_RANDOMIZER_R: 16,
+            BLE_GAP_AD_TYPE_SECURITY_MANAGER_TK_VALUE: 16,
+            BLE_GAP_AD_TYPE_SIMPLE_PAIRING_HASH_C256: 16,
+            BLE_GAP_AD_TYPE_SIMPLE_PAIRING_RANDOMIZER_R256: 16,
+            BLE_GAP_AD_TYPE_SERVICE_DATA_128BIT_UUID: 16,
+        };
+
+        for (let name in minimumLengths) {
+            this.adMinimumLengths[bleDriver[name]] = minimumLengths[name];
+        }
+    }
+}
+
+/**
+ * Event packed in a binary event batch. The properties have the same names and values as the
+ * event objects of the object event format, and are decoded when they are read.
+ */
+class BinaryEvent {
+    constructor(view, offset, names) {
+        this._view = view;
+        this._offset = offset;
+        this._payload = offset + RECORD_HEADER_LENGTH;
+        this._names = names;
+    }
+
+    get id() {
+        return this._view.getUint16(this._offset + 2, true);
+    }
+
+    get name() {
+        return this._names.events[this.id];
+    }
+
+    // Milliseconds since epoch, as the time of object events
+    get time() {
+        return this._view.getFloat64(this._offset + 8, true);
+    }
+
+    get conn_handle() {
+        return this._view.getUint16(this._offset + 4, true);
+    }
+
+    // BLE_EVT_TX_COMPLETE
+    get count() {
+        return this._view.getUint8(this._payload);
+    }
+
+    // BLE_GAP_EVT_RSSI_CHANGED and BLE_GAP_EVT_ADV_REPORT
+    get rssi() {
+        return this._view.getInt8(this.id === this._names.advReport ? this._payload + 7 : this._payload);
+    }
+
+    // BLE_GAP_EVT_ADV_REPORT
+    get peer_addr() {
+        const address = [];
+
+        for (let i = 6; i > 0; i--) {
+            address.push(hex8(this._view.getUint8(this._payload + i)));
+        }
+
+        return {
+            address: address.join(':'),
+            type: this._names.addressTypes[this._view.getUint8(this._payload)],
+        };
+    }
+
+    get scan_rsp() {
+        return (this._view.getUint8(this._payload + 8) & 0x01) !== 0;
+    }
+
+    get adv_type() {
+        if (this.scan_rsp) {
+            return undefined;
+        }
+
+        return this._names.advertisingTypes[(this._view.getUint8(this._payload + 8) >> 1) & 0x03];
+    }
+
+    // Advertising data, or attribute data for BLE_GATTC_EVT_HVX, as a view into the batch
+    get raw() {
+        if (this.id === this._names.advReport) {
+            return new Uint8Array(this._view.buffer, this._payload + 10, this._view.getUint8(this._payload + 9));
+        }
+
+        return new Uint8Array(this._view.buffer, this._payload + 10, this._view.getUint16(this._payload + 8, true));
+    }
+
+    get data() {
+        const raw = this.raw;
+
+        if (this.id === this._names.advReport) {
+            return raw.length > 0 ? parseAdvertisingData(raw, this._names) : undefined;
+        }
+
+        return Array.prototype.slice.call(raw);
+    }
+
+    // BLE_GATTC_EVT_HVX
+    get gatt_status() {
+        return this._view.getUint16(this._payload, true);
+    }
+
+    get gatt_status_name() {
+        return this._names.gattStatus[this.gatt_status] || 'Unknown GATT status';
+    }
+
+    get error_handle() {
+        return this._view.getUint16(this._payload + 2, true);
+    }
+
+    get handle() {
+        return this._view.getUint16(this._payload + 4, true);
+    }
+
+    get type() {
+        return this._view.getUint8(this._payload + 6);
+    }
+
+    get len() {
+        return this._view.getUint16(this._payload + 8, true);
+    }
+}
+
+// Parses advertising data into the same object as the addon creates for object events
+function parseAdvertisingData(raw, names) {
+    const data = {};
+    let pos = 0;
+
+    while (pos < raw.length) {
+        const adLength = raw[pos];
+        pos++;
+
+        if (pos + adLength > raw.length || adLength === 0) {
+            break;
+        }
+
+        const adType = raw[pos];
+        const start = pos + 1;
+        const end = pos + adLength;
+        const name = names.adTypes[adType];
+
+        // Fields shorter than their type requires are left out, as by the addon
+        if (end - start < (names.adMinimumLengths[adType] || 0)) {
+            pos += adLength;
+            continue;
+        }
+
+        if (adType === names.flagsAdType) {
+            data[name] = names.advertisingFlags
+                .filter(flag => (raw[start] & flag.value) !== 0)
+                .map(flag => flag.name);
+        } else if (adType === names.shortNameAdType || adType === names.completeNameAdType) {
+            data[name] = Buffer.from(raw.buffer, raw.byteOffset + start, end - start).toString();
+        } else if (names.uuid16AdTypes.indexOf(adType) !== -1) {
+            data[name] = [];
+
+            for (let i = start; i + 1 < end; i += 2) {
+                data[name].push(hex16(raw[i] | (raw[i + 1] << 8)));
+            }
+        } else if (names.uuid32AdTypes.indexOf(adType) !== -1) {
+            data[name] = [];
+
+            for (let i = start; i + 3 < end; i += 4) {
+                data[name].push(hex16(raw[i + 2] | (raw[i + 3] << 8)) + hex16(raw[i] | (raw[i + 1] << 8)) + '-0000-1000-8000-00805F9B34FB');
+            }
+        } else if (names.uuid128AdTypes.indexOf(adType) !== -1) {
+            data[name] = [];
+
+            for (let i = start; i + 15 < end; i += 16) {
+                const parts = [];
+
+                for (let j = 14; j >= 0; j -= 2) {
+                    parts.push(hex16(raw[i + j] | (raw[i + j + 1] << 8)));
+                }
+
+                data[name].push(`${parts[0]}${parts[1]}-${parts[2]}-${parts[3]}-${parts[4]}-${parts[5]}${parts[6]}${parts[7]}`);
+            }
+        } else if (adType === names.txPowerAdType) {
+            data[name] = raw[start];
+        } else {
+            data[name !== undefined ? name : String(adType)] = Array.prototype.slice.call(raw, start, end);
+        }
+
+        pos += adLength;
+    }
+
+    return data;
+}
+
+const eventNamesCache = new WeakMap();
+
+/**
+ * Batch of events received from the addon in the binary event format.
+ *
+ * @param {ArrayBuffer} buffer - The packed events.
+ * @param {Array} objects - Events delivered as objects, in the order they appear in the batch.
+ * @param {Object} bleDriver - The driver, used for event and constant names.
+ */
+class EventBatch {
+    constructor(buffer, objects, bleDriver) {
+        this._view = new DataView(buffer);
+        this._objects = objects;
+
+        if (this._view.getUint16(0, true) !== BATCH_VERSION) {
+            throw new Error(`Unsupported event batch version ${this._view.getUint16(0, true)}.`);
+        }
+
+        if (!eventNamesCache.has(bleDriver)) {
+            eventNamesCache.set(bleDriver, new EventNames(bleDriver));
+        }
+
+        this._names = eventNamesCache.get(bleDriver);
+    }
+
+    get length() {
+        return this._view.getUint32(4, true);
+    }
+
+    /**
+     * Calls callback with each event of the batch in the order they were received. Packed events
+     * are passed as BinaryEvent instances, other events as the objects created by the addon.
+     */
+    forEach(callback) {
+        const length = this.length;
+        let offset = BATCH_HEADER_LENGTH;
+        let objectIndex = 0;
+
+        for (let i = 0; i < length; i++) {
+            const recordLength = this._view.getUint16(offset, true);
+
+            if (this._view.getUint8(offset + 6) === RECORD_PACKED) {
+                callback(new BinaryEvent(this._view, offset, this._names), i);
+            } else {
+                callback(this._objects[objectIndex++], i);
+            }
+
+            offset += recordLength;
+        }
+    }
+}
+
+module.exports = EventBatch;
+module.exports.BinaryEvent = BinaryEvent;
@@ -128,6 +128,7 @@ class ToText {
 
             if (key == 'id') { continue; }
             if (key == 'data') { continue; }
+            if (key == 'raw') { continue; }
             if (key == 'name') { continue; }
 
             let value = eval(`obj.${key}`);
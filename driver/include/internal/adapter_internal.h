@@ -24,6 +24,7 @@ class AdapterInternal {
         uint32_t open(const sd_rpc_status_handler_t status_callback, const sd_rpc_evt_handler_t event_callback, const sd_rpc_log_handler_t log_callback);
         uint32_t close() const;
         static bool isInternalError(const uint32_t error_code);
+        uint32_t logSeverityFilterSet(sd_rpc_log_severity_t severity_filter) const;
 
         void statusHandler(sd_rpc_app_status_t code, const char * error);
         void eventHandler(ble_evt_t *event);
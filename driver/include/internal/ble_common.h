@@ -4,7 +4,7 @@
 #include <functional>
 #include "adapter.h"
 #include <stdint.h>
-#include "app_ble_gap_sec_keys.h"
+#include "app_ble_conn_table.h"
 
 typedef std::function<uint32_t(uint8_t*, uint32_t*)> encode_function_t;
 typedef std::function<uint32_t(uint8_t*, uint32_t, uint32_t*)> decode_function_t;
@@ -12,24 +12,22 @@ typedef std::function<uint32_t(uint8_t*, uint32_t, uint32_t*)> decode_function_t
 uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, decode_function_t decode_function);
 
 /*
- * We do not want to change the codecs provided by the SDK too much. The BLESecurityContext provides a way to set the root
- * security context before calling the codecs. Typically the root context is the SerializationTransport object.
+ * We do not want to change the codecs provided by the SDK too much. The BLEConnectionContext provides a way to set the root
+ * connection context before calling the codecs. The root context is the connection table of the adapter, owned by its
+ * SerializationTransport. The table is locked while the context exists, so the context should only cover the codec calls.
 */
 
-class BLESecurityContext
+class BLEConnectionContext
 {
-private:
-    void *context;
-
 public:
-    explicit BLESecurityContext(void* context) : context(context)
+    explicit BLEConnectionContext(app_ble_conn_table_t &table)
     {
-        app_ble_gap_sec_context_root_set(context);
+        app_ble_conn_context_root_set(&table);
     }
 
-    ~BLESecurityContext()
+    ~BLEConnectionContext()
     {
-        app_ble_gap_sec_context_root_release();
+        app_ble_conn_context_root_release();
     }
 };
 
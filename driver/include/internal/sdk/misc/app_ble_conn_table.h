@@ -0,0 +1,93 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+#ifndef _APP_BLE_CONN_TABLE_H
+#define _APP_BLE_CONN_TABLE_H
+
+ /**@file
+ *
+ * @defgroup app_ble_conn_table Per-adapter table of connection state in application device.
+ * @{
+ * @ingroup  ser_app_s130_codecs
+ *
+ * @brief    State of the connections of one adapter, the root context of the keyset and user memory functions
+ *           used by the codecs.
+ */
+
+#include "ble.h"
+#include "sd_rpc_types.h"
+#include "app_ble_gap_sec_keys.h"
+#include "app_ble_user_mem.h"
+#include <stdint.h>
+
+#include <array>
+#include <mutex>
+
+/**@brief State of one connection handle.
+ */
+typedef struct
+{
+  sd_rpc_conn_state_t      state;    /**< Connection state reported by @ref sd_rpc_conn_state_get.*/
+  ser_ble_gap_app_keyset_t keyset;   /**< Keyset of the pairing in progress, used while keyset.conn_active is 1.*/
+  ser_ble_user_mem_t       user_mem; /**< User memory block, used while user_mem.conn_active is 1.*/
+} app_ble_conn_entry_t;
+
+/**@brief Connection state of one adapter, owned by the SerializationTransport of the adapter.
+ *
+ * @note  The entries are stored inline and indexed by connection handle, so looking up a connection neither
+ *        searches nor allocates. Each adapter has a table of its own, so that the adapters do not wait for each other.
+ */
+class app_ble_conn_table_t
+{
+public:
+    app_ble_conn_table_t();
+
+    /**@brief Entry of a connection handle, nullptr if the handle is SD_RPC_MAX_CONNECTIONS or more. */
+    app_ble_conn_entry_t *find(uint16_t conn_handle);
+
+    /**@brief Updates the connection state from a decoded event. Must be called with the table locked. */
+    void update(const ble_evt_t *p_event);
+
+    /**@brief Copies the state of a connection. Locks the table. */
+    uint32_t getState(uint16_t conn_handle, sd_rpc_conn_state_t *p_state);
+
+    std::mutex mutex; /**< Locked while the table is the root context of a thread. */
+
+private:
+    std::array<app_ble_conn_entry_t, SD_RPC_MAX_CONNECTIONS> entries;
+};
+
+/**@brief Sets root context for calls to the *_context_create, *_context_destroy, *_context_find functions of the
+*         keysets and user memory in the calling thread
+*
+* @note The table is locked until the root context is released.
+*
+* @param[in]     p_table             table of the adapter to find connections in
+*/
+void app_ble_conn_context_root_set(app_ble_conn_table_t *p_table);
+
+/**@brief Release root context for calls to *_context_create, *_context_destroy, *_context_find in the calling thread
+*
+*/
+void app_ble_conn_context_root_release();
+
+/**@brief Root context of the calling thread, nullptr if none is set.
+*/
+app_ble_conn_table_t *app_ble_conn_context_root_get();
+
+/**@brief Entry of a connection handle in the root context of the calling thread.
+*
+* @retval nullptr No root context is set, or the connection handle is outside the table.
+*/
+app_ble_conn_entry_t *app_ble_conn_context_find(uint16_t conn_handle);
+/** @} */
+
+#endif //_APP_BLE_CONN_TABLE_H
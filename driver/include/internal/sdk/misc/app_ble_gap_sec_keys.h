@@ -36,42 +36,29 @@
 
 /**@brief GAP connection - keyset mapping structure.
  *
- * @note  This structure is used to map keysets to connection instances, and will be stored in a static table.
+ * @note  This structure is used to map keysets to connection instances, and is stored in the connection table of the adapter.
  */
 typedef struct
 {
-  uint8_t                conn_active;    /**< Indication that keys for this connection are used by soft device. 0: keys used; 1: keys not used*/
+  uint8_t                conn_active;    /**< Indication that keys for this connection are used by soft device. 1: keys used; 0: keys not used*/
   ble_gap_sec_keyset_t   keyset;         /**< Keyset structure, see @ref ble_gap_sec_keyset_t.*/
 } ser_ble_gap_app_keyset_t;
 
-
-/**@brief Sets root context for calls to *_context_create, *_context_destroy, *_context_find
-*
-* @param[in]     context             root pointer to use as key for finding keysets
-*/
-void app_ble_gap_sec_context_root_set(void *context);
-
-
-/**@brief Release root context for calls to *_context_create, *_context_destroy, *_context_find
-*
-*/
-void app_ble_gap_sec_context_root_release();
-
+/* The functions below look up the keysets in the root context set with app_ble_conn_context_root_set */
 
 /**@brief allocates instance for storage of encryption keys.
  *
- * @param[in]     adapter             adapter
  * @param[in]     conn_handle         conn_handle
  * @param[out]    **pp_gap_app_keyset Pointer to the keyset corresponding to the given conn_handle
  *
  * @retval NRF_SUCCESS                Context allocated.
- * @retval NRF_ERROR_NO_MEM           No free instance available.
+ * @retval NRF_ERROR_NO_MEM           Connection handle outside the connection table.
+ * @retval NRF_ERROR_INVALID_DATA     No root context set.
  */
 uint32_t app_ble_gap_sec_context_create(uint16_t conn_handle, ser_ble_gap_app_keyset_t **pp_gap_app_keyset);
 
 /**@brief release instance identified by a connection handle.
  *
- * @param[in]     adapter             adapter
  * @param[in]     conn_handle         conn_handle
  *
  * @retval NRF_SUCCESS                Context released.
@@ -79,9 +66,8 @@ uint32_t app_ble_gap_sec_context_create(uint16_t conn_handle, ser_ble_gap_app_ke
  */
 uint32_t app_ble_gap_sec_context_destroy(uint16_t conn_handle);
 
-/**@brief finds index of instance identified by a connection handle in m_app_keys_table[].
+/**@brief finds instance identified by a connection handle.
  *
- * @param[in]     adapter             adapter
  * @param[in]     conn_handle         conn_handle
  *
  * @param[out]    **pp_gap_app_keyset Pointer to the keyset corresponding to the given conn_handle
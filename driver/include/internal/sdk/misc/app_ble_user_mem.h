@@ -32,30 +32,32 @@
  */
 
 #include "ble.h"
-#include "ser_config.h"
 #include <stdint.h>
 
 /**@brief Connection - user memory mapping structure.
  *
- * @note  This structure is used to map user memory to connection instances, and will be stored in a static table.
+ * @note  This structure is used to map user memory to connection instances, and is stored in the connection table of the adapter.
  */
 //lint -esym(452,ser_ble_user_mem_t) 
 typedef struct
 {
   uint16_t               conn_handle;    /**< Connection handle.*/
-  uint8_t                conn_active;    /**< Indication that user memory for this connection is used by soft device. 0: memory used; 1: memory not used*/
+  uint8_t                conn_active;    /**< Indication that user memory for this connection is used by soft device. 1: memory used; 0: memory not used*/
   ble_user_mem_block_t   mem_block;      /**< User memory block structure, see @ref ble_user_mem_block_t.*/
 } ser_ble_user_mem_t;
 
-/**@brief allocates instance in m_user_mem_table[] for storage.
+/* The functions below look up the user memory in the root context set with app_ble_conn_context_root_set */
+
+/**@brief allocates instance for storage of user memory.
  *
  * @param[in]     conn_handle         conn_handle
- * @param[out]    p_index             pointer to the index of allocated instance
+ * @param[out]    pp_user_mem         Pointer to the instance corresponding to the given conn_handle
  *
  * @retval NRF_SUCCESS                Context allocated.
- * @retval NRF_ERROR_NO_MEM           No free instance available.
+ * @retval NRF_ERROR_NO_MEM           Connection handle outside the connection table.
+ * @retval NRF_ERROR_INVALID_DATA     No root context set.
  */
-uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index);
+uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem);
 
 /**@brief release instance identified by a connection handle.
  *
@@ -66,16 +68,16 @@ uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, uint32_t *p_index
  */
 uint32_t app_ble_user_mem_context_destroy(uint16_t conn_handle);
 
-/**@brief finds index of instance identified by a connection handle in m_user_mem_table[].
+/**@brief finds instance identified by a connection handle.
  *
  * @param[in]     conn_handle         conn_handle
  *
- * @param[out]    p_index             Pointer to the index of the entry in the context table corresponding to the given conn_handle
+ * @param[out]    pp_user_mem         Pointer to the instance corresponding to the given conn_handle
  *
  * @retval NRF_SUCCESS                Context found
  * @retval NRF_ERROR_NOT_FOUND        instance with conn_handle not found
  */
-uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, uint32_t *p_index);
+uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem);
 /** @} */
 
 #endif //_APP_BLE_USER_MEM_H
@@ -0,0 +1,30 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef EVENT_POOL_H
+#define EVENT_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Allocator for decoded events. Buffers are taken from free lists of a few size classes so that
+ * events can be allocated with their exact decoded size without calling malloc for every event.
+ * Buffers may be released from any thread.
+ */
+class EventPool
+{
+public:
+    static void *allocate(size_t size);
+    static void release(void *buffer);
+};
+
+#endif //EVENT_POOL_H
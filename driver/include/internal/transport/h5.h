@@ -14,6 +14,7 @@
 #define H5_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <vector>
 
 const uint32_t H5_HEADER_LENGTH = 4;
@@ -40,6 +41,9 @@ typedef enum
     CONTROL_PKT_SYNC_CONFIG_RESPONSE,
 } control_pkt_type;
 
+// CRC-16-CCITT used for the data integrity check of H5 packets
+uint16_t calculate_crc16_checksum(const uint8_t *start, const uint8_t *end);
+
 void h5_encode(std::vector<uint8_t> &in_packet,
                std::vector<uint8_t> &out_packet,
                uint8_t seq_num,
@@ -48,14 +52,20 @@ void h5_encode(std::vector<uint8_t> &in_packet,
                bool reliable_packet,
                h5_pkt_type_t packet_type);
 
-uint32_t h5_decode(std::vector<uint8_t> &slip_dec_packet,
-	std::vector<uint8_t> &h5_dec_packet,
-	uint8_t *seq_num,
-	uint8_t *ack_num,
+// Validates the header checksum of a received packet and returns the length of the packet, including header
+// and CRC, stated in the header. header must contain at least H5_HEADER_LENGTH bytes.
+uint32_t h5_decode_header(const uint8_t *header, size_t *packet_length);
+
+// Decodes a SLIP decoded packet. h5_payload is set to point to the payload inside slip_dec_packet.
+uint32_t h5_decode(uint8_t *slip_dec_packet,
+    size_t length,
+    uint8_t **h5_payload,
+    uint16_t *payload_length,
+    uint8_t *seq_num,
+    uint8_t *ack_num,
     bool *_data_integrity,
-    uint16_t *_payload_length,
     uint8_t *_header_checksum,
-	bool *reliable_packet,
-	h5_pkt_type_t *packet_type);
+    bool *reliable_packet,
+    h5_pkt_type_t *packet_type);
 
 #endif //H5_H
@@ -19,11 +19,13 @@
 #include <condition_variable>
 
 #include <vector>
+#include <deque>
 
 #include <stdint.h>
 #include <map>
 #include <thread>
 #include "h5.h"
+#include "slip.h"
 
 typedef enum
 {
@@ -177,31 +179,66 @@ public:
 
 class H5Transport : public Transport {
 public:
-    H5Transport(Transport *nextTransportLayer, uint32_t retransmission_interval);
+    H5Transport(Transport *nextTransportLayer, uint32_t retransmission_interval, uint8_t transmit_window_size);
     ~H5Transport();
     uint32_t open(status_cb_t status_callback, data_cb_t data_callback, log_cb_t log_callback) override;
     uint32_t close() override;
     uint32_t send(std::vector<uint8_t> &data) override;
 
+    // Returns as soon as the packet is in the transmit window, waiting only while the window is full.
+    // completion_callback is called when the packet is acknowledged or given up.
+    uint32_t sendAsync(std::vector<uint8_t> &data, send_cb_t completion_callback) override;
+    void setLogSeverityFilter(sd_rpc_log_severity_t severity_filter) override;
+    uint64_t getReadTime() const override;
+    void setLatencyStatistics(LatencyStatistics *latency_statistics) override;
+
 private:
     void dataHandler(uint8_t *data, size_t length);
     void statusHandler(sd_rpc_app_status_t code, const char * error);
-    void processPacket(std::vector<uint8_t>& packet);
+    void processPacket(uint8_t *packet, size_t length);
+    void validateRxPacketLength();
 
     void sendControlPacket(control_pkt_type type);
 
     void incrementSeqNum();
     void incrementAckNum();
 
+    bool processAcknowledgement(uint8_t ack_num);
+    std::chrono::steady_clock::time_point checkRetransmissionTimer();
+    void retransmitOutstandingPackets(std::vector<send_cb_t> &failedPackets);
+    void failOutstandingPackets(std::vector<send_cb_t> &failedPackets);
+    static void completePackets(std::vector<send_cb_t> &completionCallbacks, uint32_t error_code);
+    uint8_t syncConfigToSend() const;
+
     Transport *nextTransportLayer;
-    std::vector<uint8_t> lastPacket;
 
     // Variables used for reliable packets
     uint8_t seqNum;
     uint8_t ackNum;
 
-    bool c0Found;
-    std::vector<uint8_t> unprocessedData;
+    // Reliable packet sent to target that is not acknowledged yet
+    struct OutstandingPacket
+    {
+        uint8_t seqNum;
+        std::vector<uint8_t> h5Packet;
+        std::vector<uint8_t> slipPacket;
+        uint8_t remainingRetransmissions;
+        std::chrono::steady_clock::time_point retransmitAt;
+        send_cb_t completionCallback;
+    };
+
+    // Sliding window, oldest packet first. Protected by ackMutex.
+    // Completion callbacks of packets removed from the window are called after ackMutex is released.
+    std::deque<OutstandingPacket> outstandingPackets;
+    uint8_t maxTransmitWindowSize; // Window size requested by the application
+    uint8_t transmitWindowSize;    // Window size negotiated with target
+    bool transmitWindowOpen;       // Packets are accepted, only in state ACTIVE. Protected by ackMutex.
+
+    // Incoming packet being SLIP decoded in place, reused for all packets to avoid allocations in the read thread
+    slip_decode_state_t slipState;
+    std::vector<uint8_t> rxPacket;
+    size_t rxPacketLength; // Length of rxPacket stated in its header, 0 until the header is received
+    uint64_t rxPacketStartTime; // Read time of the start of rxPacket
 
     // Variables used in state RESET/UNINITIALIZED/INITIALIZED
     std::mutex syncMutex; // TODO: evaluate a new name for syncMutex
@@ -217,14 +254,14 @@ private:
     uint32_t outgoingPacketCount;
     uint32_t errorPacketCount;
 
-    void logPacket(bool outgoing, std::vector<uint8_t> &packet);
+    void logPacket(bool outgoing, uint8_t *packet, size_t length);
     void log(std::string &logLine) const;
     void log(char const *logLine) const;
     void logStateTransition(h5_state_t from, h5_state_t to) const;
     static std::string stateToString(h5_state_t state);
-    std::string asHex(std::vector<uint8_t> &packet) const;
+    std::string asHex(uint8_t *packet, size_t length) const;
     std::string hciPacketLinkControlToString(std::vector<uint8_t> payload) const;
-    std::string h5PktToString(bool out, std::vector<uint8_t> &h5Packet) const;
+    std::string h5PktToString(bool out, uint8_t *h5Packet, size_t length) const;
     static std::string pktTypeToString(h5_pkt_type_t pktType);
 
     // State machine related
@@ -258,6 +295,7 @@ private:
     static const uint8_t syncConfigRspFirstByte = 0x04;
     static const uint8_t syncConfigRspSecondByte = 0x7B;
     static const uint8_t syncConfigField = 0x11;
+    static const uint8_t syncConfigWindowSizeMask = 0x07;
 };
 
 #endif //H5_TRANSPORT_H
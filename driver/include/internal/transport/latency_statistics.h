@@ -0,0 +1,79 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef LATENCY_STATISTICS_H
+#define LATENCY_STATISTICS_H
+
+#include "sd_rpc_types.h"
+
+#include <array>
+#include <atomic>
+
+#include <stdint.h>
+
+/*
+ * Histogram of latencies in nanoseconds. Values are counted in buckets of 16 per power of two, so that
+ * percentiles are accurate to within 1/16 of the value without storing the samples. Recording is lock-free
+ * and may be done from any thread.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(uint64_t latency);
+    void getSummary(sd_rpc_latency_t *latency) const;
+
+private:
+    static const uint32_t SUB_BUCKET_BITS = 4;
+    static const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const uint32_t MAX_MAGNITUDE = 40; // Values from 2^40 ns, about 18 minutes, are counted in the last bucket
+    static const uint32_t BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static uint32_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(uint32_t index);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+};
+
+/*
+ * Latencies of the stages of the event pipeline and the command round trip times of one adapter.
+ * Owned by SerializationTransport and shared with the transport layers below it.
+ */
+class LatencyStatistics
+{
+public:
+    LatencyStatistics();
+    ~LatencyStatistics();
+
+    // Current time in nanoseconds of std::chrono::steady_clock, the clock all latencies are measured with
+    static uint64_t now();
+
+    void record(sd_rpc_latency_stage_t stage, uint64_t latency);
+    void recordSince(sd_rpc_latency_stage_t stage, uint64_t startTime);
+    void recordCommand(uint8_t opCode, uint64_t latency);
+
+    uint32_t getLatency(sd_rpc_latency_stage_t stage, sd_rpc_latency_t *latency) const;
+
+    // Returns NRF_ERROR_NOT_FOUND if no command with opCode has completed
+    uint32_t getCommandLatency(uint8_t opCode, sd_rpc_latency_t *latency) const;
+
+private:
+    std::array<LatencyHistogram, SD_RPC_LATENCY_STAGE_COUNT> stages;
+
+    // Created the first time a command with the op code completes
+    std::array<std::atomic<LatencyHistogram *>, 256> commands;
+};
+
+#endif //LATENCY_STATISTICS_H
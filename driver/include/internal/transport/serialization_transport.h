@@ -14,24 +14,25 @@
 #define SERIALIZATION_TRANSPORT_H
 
 #include "transport.h"
+#include "latency_statistics.h"
+#include "app_ble_conn_table.h"
 
 #include "ble.h"
+#include "ser_config.h"
 
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 
-#include <queue>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
 #include <stdint.h>
 
 typedef uint32_t(*transport_rsp_handler_t)(const uint8_t *p_buffer, uint16_t length);
 typedef std::function<void(ble_evt_t * p_ble_evt)> evt_cb_t;
-
-struct eventData_t
-{
-    uint8_t *data;
-    uint32_t dataLength;
-};
+typedef std::function<void(uint32_t error_code)> rsp_cb_t;
 
 typedef enum
 {
@@ -40,6 +41,8 @@ typedef enum
     SERIALIZATION_EVENT = 2
 } serialization_pkt_type_t;
 
+const uint32_t SERIALIZATION_PKT_TYPE_LENGTH = 1; // Packet type in front of every command, response and event
+
 class SerializationTransport {
 public:
     SerializationTransport(Transport *dataLinkLayer, uint32_t response_timeout);
@@ -48,32 +51,126 @@ public:
     uint32_t close();
     uint32_t send(uint8_t *cmdBuffer, uint32_t cmdLength, uint8_t *rspBuffer, uint32_t *rspLength);
 
+    // Sends a command encoded after SERIALIZATION_PKT_TYPE_LENGTH reserved bytes at the start of cmdPacket.
+    // The command is passed to the data link layer without being copied.
+    uint32_t send(std::vector<uint8_t> &cmdPacket, uint8_t *rspBuffer, uint32_t *rspLength);
+
+    // Submits a command without waiting for it to be delivered or for the response, several commands may be in flight.
+    // response_callback is called with NRF_SUCCESS when the response is copied into rspBuffer, or with an error code
+    // if the command is not delivered or no response is received within the response timeout. Without rspBuffer it
+    // is called when the command is delivered. It is not called if sendAsync returns an error.
+    // The callback may be called from the transport read or state machine threads and must not block.
+    // rspBuffer and rspLength must stay valid until response_callback is called.
+    uint32_t sendAsync(uint8_t *cmdBuffer, uint32_t cmdLength, uint8_t *rspBuffer, uint32_t *rspLength, rsp_cb_t response_callback);
+    uint32_t sendAsync(std::vector<uint8_t> &cmdPacket, uint8_t *rspBuffer, uint32_t *rspLength, rsp_cb_t response_callback);
+
+    // Largest number of events waiting for the event thread at the same time, and number of events that did not
+    // fit in the event queue and were buffered on the heap instead.
+    void getEventQueueStatistics(uint32_t *high_watermark, uint32_t *overflow_count) const;
+
+    // Keeps the event currently passed to the event callback after the callback returns, instead of it being
+    // released. Must be called from the event callback. The event is released with EventPool::release.
+    uint32_t retainEvent(ble_evt_t *event);
+
+    // Time the event currently passed to the event callback was read from the physical layer, in nanoseconds of
+    // std::chrono::steady_clock. Must be called from the event callback.
+    uint32_t getEventReadTime(const ble_evt_t *event, uint64_t *read_time) const;
+
+    // Log messages with a lower severity than severity_filter are not formatted or passed to the log callback.
+    // The filter is also applied to the transport layers below.
+    void setLogSeverityFilter(sd_rpc_log_severity_t severity_filter);
+
+    // Latencies of the event pipeline, recorded by this and the transport layers below, and of the commands sent
+    LatencyStatistics &getLatencyStatistics();
+
+    // State, keysets and user memory of the connections of this adapter, the root context of the codecs
+    app_ble_conn_table_t &getConnectionTable();
+
 private:
     SerializationTransport();
     void readHandler(uint8_t *data, size_t length);
     void eventHandlingRunner();
 
+    void pushEvent(uint8_t *data, size_t length, uint64_t readTime);
+    void processEvent(uint8_t *data, uint32_t length, uint64_t readTime);
+    bool eventAvailable() const;
+    bool isLogEnabled(sd_rpc_log_severity_t severity) const;
+
+    void onCommandDelivered(uint32_t commandId, uint32_t error_code);
+    std::chrono::steady_clock::time_point nextResponseDeadline();
+    void expirePendingCommands();
+    void failPendingCommands(uint32_t error_code);
+
     status_cb_t statusCallback;
     evt_cb_t eventCallback;
     log_cb_t logCallback;
+    std::atomic<int> logSeverityFilter;
 
     Transport *nextTransportLayer;
     uint32_t responseTimeout;
 
-    bool rspReceived;
-    uint8_t *responseBuffer;
-    uint32_t *responseLength;
+    // Command sent to target that is waiting for its response
+    struct PendingCommand
+    {
+        uint32_t id;
+        uint8_t opCode;
+        uint8_t *responseBuffer;
+        uint32_t *responseLength;
+        std::chrono::steady_clock::time_point deadline;
+        rsp_cb_t responseCallback;
+    };
 
-    std::mutex sendMutex;
+    std::mutex sendMutex; // Keeps the order of pendingCommands equal to the order commands are queued for target
 
     std::mutex responseMutex;
-    std::condition_variable responseWaitCondition;
+    std::deque<PendingCommand> pendingCommands; // Oldest command first. Protected by responseMutex.
+    uint32_t nextCommandId;
+
+    std::atomic<bool> runEventThread; // Variable to control if thread shall run, used in thread to exit/keep running inthread
+    std::thread * eventThread;
 
-    bool runEventThread; // Variable to control if thread shall run, used in thread to exit/keep running inthread
+    // Events are passed from the read thread to the event thread in a lock-free single producer, single consumer
+    // ring of preallocated slots. eventHead is only written by the event thread, eventTail only by the read thread.
+    static const uint32_t EVENT_QUEUE_SLOTS = 64;
+
+    struct EventSlot
+    {
+        uint64_t readTime;
+        uint32_t dataLength;
+        uint8_t data[SER_HAL_TRANSPORT_MAX_PKT_SIZE];
+    };
+
+    std::vector<EventSlot> eventSlots;
+    std::atomic<uint32_t> eventHead;
+    std::atomic<uint32_t> eventTail;
+
+    // Events that do not fit in the ring are buffered here, in order, until the event thread has caught up.
+    // Protected by eventMutex.
+    struct OverflowEvent
+    {
+        uint64_t readTime;
+        std::vector<uint8_t> data;
+    };
+
+    std::deque<OverflowEvent> eventOverflow;
+    std::atomic<bool> eventOverflowActive;
+
+    // Only used to wake up the event thread when it is idle
     std::mutex eventMutex;
     std::condition_variable eventWaitCondition;
-    std::thread * eventThread;
-    std::queue<eventData_t> eventQueue;
+    std::atomic<bool> eventThreadWaiting;
+
+    std::atomic<uint32_t> eventQueueHighWatermark;
+    std::atomic<uint32_t> eventOverflowCount;
+
+    // Events are decoded into eventDecodeBuffer and then copied to a buffer of the decoded size. Only used by the event thread.
+    std::vector<uint64_t> eventDecodeBuffer;
+    ble_evt_t *currentEvent;
+    uint64_t currentEventReadTime;
+    bool currentEventRetained;
+
+    LatencyStatistics latencyStatistics;
+    app_ble_conn_table_t connectionTable;
 };
 
 #endif //SERIALIZATION_TRANSPORT_H
@@ -14,8 +14,37 @@
 #define SLIP_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <vector>
 
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+// State of an incremental SLIP decoder that processes received data as it arrives
+typedef enum
+{
+    SLIP_STATE_HUNTING,  // Waiting for SLIP_END that starts a packet
+    SLIP_STATE_DECODING, // Inside a packet
+    SLIP_STATE_ESCAPED   // Inside a packet, previous byte was SLIP_ESC
+} slip_decode_state_t;
+
+// Largest possible SLIP encoded length of a packet, every byte escaped and SLIP_END on both sides
+inline size_t slip_encoded_max_length(size_t length)
+{
+    return 2 * length + 2;
+}
+
+// Returns the number of bytes at the start of data that are neither SLIP_END nor SLIP_ESC
+size_t slip_unescaped_length(const uint8_t *data, size_t length);
+
+// out_packet must have room for slip_encoded_max_length(length) bytes. Returns the encoded length.
+size_t slip_encode(const uint8_t *in_packet, size_t length, uint8_t *out_packet);
+
+// out_packet must have room for length bytes
+uint32_t slip_decode(const uint8_t *packet, size_t length, uint8_t *out_packet, size_t *out_length);
+
 void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet);
 uint32_t slip_decode(std::vector<uint8_t> &packet, std::vector<uint8_t> &out_packet);
 
@@ -14,7 +14,9 @@
 #define TRANSPORT_H
 
 #include "sd_rpc_types.h"
+#include "latency_statistics.h"
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <vector>
@@ -24,6 +26,7 @@
 typedef std::function<void(sd_rpc_app_status_t code, const char *message)> status_cb_t;
 typedef std::function<void(uint8_t *data, size_t length)> data_cb_t;
 typedef std::function<void(sd_rpc_log_severity_t severity, std::string message)> log_cb_t;
+typedef std::function<void(uint32_t error_code)> send_cb_t;
 
 class Transport {
 public:
@@ -32,12 +35,34 @@ public:
     virtual uint32_t close();
     virtual uint32_t send(std::vector<uint8_t> &data) = 0;
 
+    // Queues data for sending and returns without waiting for it to be delivered. completion_callback is called
+    // with the result of the delivery, possibly from another thread and before sendAsync returns. It is not called
+    // if sendAsync returns an error. Data queued by one thread is delivered in the order it is queued.
+    // The default implementation delivers the data with send before returning.
+    virtual uint32_t sendAsync(std::vector<uint8_t> &data, send_cb_t completion_callback);
+
+    // Log messages with a lower severity than severity_filter are not formatted or passed to the log callback
+    virtual void setLogSeverityFilter(sd_rpc_log_severity_t severity_filter);
+
+    // Time the data passed to the data callback was read from the physical layer, in nanoseconds of
+    // std::chrono::steady_clock. Only valid while the data callback runs.
+    virtual uint64_t getReadTime() const;
+
+    // Latencies measured by this layer are recorded in latency_statistics, if not nullptr.
+    // Must be set before the transport is opened.
+    virtual void setLatencyStatistics(LatencyStatistics *latency_statistics);
+
 protected:
     Transport();
 
+    bool isLogEnabled(sd_rpc_log_severity_t severity) const;
+
     status_cb_t statusCallback;
     data_cb_t dataCallback;
     log_cb_t logCallback;
+
+    std::atomic<int> logSeverityFilter;
+    LatencyStatistics *latencyStatistics;
 };
 
 #endif //TRANSPORT_H
@@ -50,6 +50,10 @@ public:
      */
     uint32_t send(std::vector<uint8_t> &data);
 
+    /**@brief Returns the time the data currently passed to the data callback was read.
+     */
+    uint64_t getReadTime() const override;
+
 private:
 
     /**@brief Called when background thread receives bytes from uart.
@@ -86,6 +90,7 @@ private:
     boost::function<void(const boost::system::error_code, const size_t)> callbackWriteHandle;
 
     bool asyncWriteInProgress;
+    uint64_t readTime; // Only used by the read thread
     UartSettingsBoost uartSettingsBoost;
 };
 
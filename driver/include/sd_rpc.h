@@ -26,6 +26,15 @@ extern "C" {
 
 SD_RPC_API physical_layer_t *sd_rpc_physical_layer_create_uart(const char * port_name, uint32_t baud_rate, sd_rpc_flow_control_t flow_control, sd_rpc_parity_t parity);
 SD_RPC_API data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire(physical_layer_t *physical_layer, uint32_t retransmission_interval);
+/**@brief Create a Bluetooth Three Wire (H5) data link layer that sends more than one reliable packet before they are
+*         acknowledged. sd_rpc_data_link_layer_create_bt_three_wire creates one with a transmit window of 1.
+*
+* @param[in]  physical_layer           Physical layer to send and receive packets through.
+* @param[in]  retransmission_interval  Duration in milliseconds to wait for an acknowledgement before a reliable packet is resent.
+* @param[in]  transmit_window_size     Maximum number of reliable packets in flight (1-7). The window used is the
+*                                      smallest of this value and the window size reported by the target.
+*/
+SD_RPC_API data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire_windowed(physical_layer_t *physical_layer, uint32_t retransmission_interval, uint8_t transmit_window_size);
 SD_RPC_API transport_layer_t *sd_rpc_transport_layer_create(data_link_layer_t *data_link_layer, uint32_t response_timeout);
 SD_RPC_API adapter_t *sd_rpc_adapter_create(transport_layer_t* transport_layer);
 SD_RPC_API void sd_rpc_adapter_delete(adapter_t *adapter);
@@ -50,6 +59,103 @@ SD_RPC_API uint32_t sd_rpc_open(adapter_t *adapter, sd_rpc_status_handler_t stat
 */
 SD_RPC_API uint32_t sd_rpc_close(adapter_t *adapter);
 
+/**@brief Keep the event passed to the event handler after the handler returns.
+*
+* @details By default the event is only valid while the event handler runs. A retained event is owned
+*          by the application and must be released with @ref sd_rpc_evt_release when it is no longer used.
+*
+* @note This function must be called from the event handler, with the event passed to it.
+*
+* @param[in]  adapter    Adapter the event was received from.
+* @param[in]  p_ble_evt  Event passed to the event handler.
+*
+* @retval NRF_SUCCESS              The event is retained.
+* @retval NRF_ERROR_INVALID_STATE  p_ble_evt is not the event currently passed to the event handler.
+*/
+SD_RPC_API uint32_t sd_rpc_evt_retain(adapter_t *adapter, ble_evt_t *p_ble_evt);
+
+/**@brief Release an event retained with @ref sd_rpc_evt_retain.
+*
+* @note This function may be called from any thread, also after the adapter is closed.
+*
+* @param[in]  p_ble_evt  Retained event.
+*/
+SD_RPC_API void sd_rpc_evt_release(ble_evt_t *p_ble_evt);
+
+/**@brief Get the time the event passed to the event handler was read from the serial port.
+*
+* @details The time is in nanoseconds of a monotonic clock (std::chrono::steady_clock) and is taken when
+*          the bytes holding the event are received, before they are decoded and queued for the event handler.
+*
+* @note This function must be called from the event handler, with the event passed to it.
+*
+* @param[in]  adapter      Adapter the event was received from.
+* @param[in]  p_ble_evt    Event passed to the event handler.
+* @param[out] p_read_time  Time the event was read.
+*
+* @retval NRF_SUCCESS              p_read_time is set.
+* @retval NRF_ERROR_NULL           p_read_time is NULL.
+* @retval NRF_ERROR_INVALID_STATE  p_ble_evt is not the event currently passed to the event handler.
+*/
+SD_RPC_API uint32_t sd_rpc_evt_read_time(adapter_t *adapter, const ble_evt_t *p_ble_evt, uint64_t *p_read_time);
+
+/**@brief Get the latencies measured for a stage of the event pipeline.
+*
+* @details The transport stages are measured by the driver. @ref SD_RPC_LATENCY_EVENT_QUEUED and
+*          @ref SD_RPC_LATENCY_EVENT_DELIVERED are only measured if the application records them
+*          with @ref sd_rpc_latency_record.
+*
+* @param[in]  adapter    Adapter the latencies are measured for.
+* @param[in]  stage      Stage of the event pipeline.
+* @param[out] p_latency  Summary of the latencies measured since the adapter was created.
+*
+* @retval NRF_SUCCESS              p_latency is set.
+* @retval NRF_ERROR_NULL           p_latency is NULL.
+* @retval NRF_ERROR_INVALID_PARAM  stage is not one of the stages in sd_rpc_latency_stage_t.
+*/
+SD_RPC_API uint32_t sd_rpc_latency_get(adapter_t *adapter, sd_rpc_latency_stage_t stage, sd_rpc_latency_t *p_latency);
+
+/**@brief Record a latency measured by the application for a stage of the event pipeline.
+*
+* @details Latencies are measured from the time returned by @ref sd_rpc_evt_read_time.
+*          This function may be called from any thread.
+*
+* @param[in]  adapter  Adapter the event was received from.
+* @param[in]  stage    Stage of the event pipeline.
+* @param[in]  latency  Latency in nanoseconds.
+*
+* @retval NRF_SUCCESS              The latency is recorded.
+* @retval NRF_ERROR_INVALID_PARAM  stage is not one of the stages in sd_rpc_latency_stage_t.
+*/
+SD_RPC_API uint32_t sd_rpc_latency_record(adapter_t *adapter, sd_rpc_latency_stage_t stage, uint64_t latency);
+
+/**@brief Get the round trip times of the commands with an op code sent to the target.
+*
+* @details The round trip time is measured from when the command is encoded until its response is decoded.
+*
+* @param[in]  adapter    Adapter the commands are sent with.
+* @param[in]  op_code    Serialization op code of the command, the SVC number of the SoftDevice function.
+* @param[out] p_latency  Summary of the round trip times measured since the adapter was created.
+*
+* @retval NRF_SUCCESS         p_latency is set.
+* @retval NRF_ERROR_NULL      p_latency is NULL.
+* @retval NRF_ERROR_NOT_FOUND No command with op_code has completed.
+*/
+SD_RPC_API uint32_t sd_rpc_command_latency_get(adapter_t *adapter, uint8_t op_code, sd_rpc_latency_t *p_latency);
+
+/**@brief Get the state of a connection, as kept by the driver from the events of the connection.
+*
+* @param[in]  adapter      Adapter the connection belongs to.
+* @param[in]  conn_handle  Connection handle.
+* @param[out] p_state      State of the connection.
+*
+* @retval NRF_SUCCESS             p_state is set.
+* @retval NRF_ERROR_NULL          p_state is NULL.
+* @retval NRF_ERROR_INVALID_PARAM conn_handle is SD_RPC_MAX_CONNECTIONS or more.
+* @retval NRF_ERROR_NOT_FOUND     There is no connection with conn_handle.
+*/
+SD_RPC_API uint32_t sd_rpc_conn_state_get(adapter_t *adapter, uint16_t conn_handle, sd_rpc_conn_state_t *p_state);
+
 /**@brief Set the lowest log level for messages to be logged to handler.
 *        Default log handler severity filter is LOG_INFO.
 *
@@ -53,6 +53,45 @@ typedef enum
     SD_RPC_PARITY_EVEN
 } sd_rpc_parity_t;
 
+/**@brief Stages of the event pipeline that latencies are measured for. All latencies are in nanoseconds. */
+typedef enum
+{
+    SD_RPC_LATENCY_UART_READ,       /**< Time spent handling one read from the serial port */
+    SD_RPC_LATENCY_FRAME_COMPLETE,  /**< From the read of the start of a packet until the packet is complete */
+    SD_RPC_LATENCY_ACK_SENT,        /**< From the read that completes a reliable packet until its acknowledgement is sent */
+    SD_RPC_LATENCY_EVENT_DECODED,   /**< From the read of an event until it is decoded */
+    SD_RPC_LATENCY_EVENT_QUEUED,    /**< From the read of an event until it is queued by the application */
+    SD_RPC_LATENCY_EVENT_DELIVERED, /**< From the read of an event until it is delivered by the application */
+    SD_RPC_LATENCY_STAGE_COUNT
+} sd_rpc_latency_stage_t;
+
+/**@brief Summary of the latencies measured for a stage or command, in nanoseconds.
+*        Percentiles are accurate to within 1/16 of the value.
+*/
+typedef struct
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+} sd_rpc_latency_t;
+
+/**@brief Number of connection handles the driver keeps connection state for, from 0 to SD_RPC_MAX_CONNECTIONS - 1.
+*        Covers the connections of all supported SoftDevices.
+*/
+#define SD_RPC_MAX_CONNECTIONS 32
+
+/**@brief State of a connection, kept by the driver from the events of the connection.
+*/
+typedef struct
+{
+    uint8_t            connected; /**< 1 from BLE_GAP_EVT_CONNECTED until BLE_GAP_EVT_DISCONNECTED */
+    uint16_t           att_mtu;   /**< ATT MTU of the connection */
+    ble_gap_conn_sec_t conn_sec;  /**< Security mode, level and key size, from BLE_GAP_EVT_CONN_SEC_UPDATE */
+} sd_rpc_conn_state_t;
+
 /**@brief Function pointer type for event callbacks.
 */
 typedef void(*sd_rpc_status_handler_t)(adapter_t *adapter, sd_rpc_app_status_t code, const char * message);
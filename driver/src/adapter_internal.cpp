@@ -48,6 +48,17 @@ uint32_t AdapterInternal::close() const
     return transport->close();
 }
 
+uint32_t AdapterInternal::logSeverityFilterSet(sd_rpc_log_severity_t severity_filter) const
+{
+    if (severity_filter < SD_RPC_LOG_TRACE || severity_filter > SD_RPC_LOG_FATAL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    transport->setLogSeverityFilter(severity_filter);
+    return NRF_SUCCESS;
+}
+
 void AdapterInternal::statusHandler(sd_rpc_app_status_t code, const char * message)
 {
     adapter_t adapter;
@@ -12,8 +12,8 @@
 
  #include "ble_common.h"
 
-#include <memory>
 #include <sstream>
+#include <vector>
 
 #include "adapter_internal.h"
 #include "nrf_error.h"
@@ -21,44 +21,41 @@
 
 uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, decode_function_t decode_function)
 {
-    uint32_t tx_buffer_length = SER_HAL_TRANSPORT_MAX_PKT_SIZE;
-    uint32_t rx_buffer_length = 0;
+    // The buffers are reused by all commands sent from the same thread. The thread is blocked until the
+    // response is received or has timed out, so a buffer is never used by two commands at the same time.
+    thread_local std::vector<uint8_t> tx_packet(SERIALIZATION_PKT_TYPE_LENGTH + SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    thread_local std::vector<uint8_t> rx_buffer(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
 
-    std::unique_ptr<uint8_t> tx_buffer(static_cast<uint8_t*>(std::malloc(SER_HAL_TRANSPORT_MAX_PKT_SIZE)));
-    std::unique_ptr<uint8_t> rx_buffer(static_cast<uint8_t*>(std::malloc(SER_HAL_TRANSPORT_MAX_PKT_SIZE)));
+    auto start_time = LatencyStatistics::now();
 
-    std::stringstream error_message;
+    uint32_t tx_buffer_length = SER_HAL_TRANSPORT_MAX_PKT_SIZE;
+    uint32_t rx_buffer_length = 0;
 
     auto _adapter = static_cast<AdapterInternal*>(adapter->internal);
 
-    uint32_t err_code = encode_function(tx_buffer.get(), &tx_buffer_length);
+    // Encode the command after the serialization packet type so that it can be sent without being copied.
+    // Resizing within the initial size does not reallocate.
+    tx_packet.resize(SERIALIZATION_PKT_TYPE_LENGTH + SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+    uint32_t err_code = encode_function(tx_packet.data() + SERIALIZATION_PKT_TYPE_LENGTH, &tx_buffer_length);
 
     if (_adapter->isInternalError(err_code))
     {
+        std::stringstream error_message;
         error_message << "Not able to decode packet received from target. Code #" << err_code;
         _adapter->statusHandler(PKT_DECODE_ERROR, error_message.str().c_str());
         return NRF_ERROR_INTERNAL;
     }
 
-    if (decode_function != nullptr)
-    {
-        err_code = _adapter->transport->send(
-            tx_buffer.get(),
-            tx_buffer_length,
-            rx_buffer.get(),
-            &rx_buffer_length);
-    }
-    else
-    {
-        err_code = _adapter->transport->send(
-            tx_buffer.get(),
-            tx_buffer_length,
-            nullptr,
-            &rx_buffer_length);
-    }
+    tx_packet.resize(SERIALIZATION_PKT_TYPE_LENGTH + tx_buffer_length);
+
+    err_code = _adapter->transport->send(
+        tx_packet,
+        decode_function != nullptr ? rx_buffer.data() : nullptr,
+        &rx_buffer_length);
 
     if (_adapter->isInternalError(err_code))
     {
+        std::stringstream error_message;
         error_message << "Error sending packet to target. Code #" << err_code;
         _adapter->statusHandler(PKT_SEND_ERROR, error_message.str().c_str());
         return NRF_ERROR_INTERNAL;
@@ -68,15 +65,21 @@ uint32_t encode_decode(adapter_t *adapter, encode_function_t encode_function, de
 
     if (decode_function != nullptr)
     {
-        err_code = decode_function(rx_buffer.get(), rx_buffer_length, &result_code);
+        err_code = decode_function(rx_buffer.data(), rx_buffer_length, &result_code);
     }
 
     if (_adapter->isInternalError(err_code))
     {
+        std::stringstream error_message;
         error_message << "Not able to decode packet. Code #" << err_code;
         _adapter->statusHandler(PKT_DECODE_ERROR, error_message.str().c_str());
         return NRF_ERROR_INTERNAL;
     }
 
+    // Round trip time from the command is encoded until its response is decoded
+    _adapter->transport->getLatencyStatistics().recordCommand(
+        tx_packet[SERIALIZATION_PKT_TYPE_LENGTH],
+        LatencyStatistics::now() - start_time);
+
     return result_code;
 }
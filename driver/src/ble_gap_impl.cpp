@@ -22,7 +22,7 @@
 #include "ble_gap_app.h" // Encoder/decoder functions
 
 //TODO: Find a way to support multiple adapters
-#include "app_ble_gap_sec_keys.h" // m_app_keys_table and app_ble_gap_sec_context_create 
+#include "app_ble_gap_sec_keys.h" // app_ble_gap_sec_context_create
 
 #include <stdint.h>
 
@@ -588,19 +588,23 @@ uint32_t sd_ble_gap_sec_params_reply(adapter_t *adapter,
     // First allocate security context for serialization. We add the a security context for the 
     // connection even if the developer has not provided a p_sec_keyset since the same structure
     // will be used for storing keys received from the peer.
+    // The context is only held while the keyset is created, not while waiting for the response.
     auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
-    BLESecurityContext context(adapterInternal->transport);
 
-    err_code = app_ble_gap_sec_context_create(conn_handle, &keyset);
-
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-    
-    if (p_sec_keyset)
     {
-        std::memcpy(&keyset->keyset, p_sec_keyset, sizeof(ble_gap_sec_keyset_t));
+        BLEConnectionContext context(adapterInternal->transport->getConnectionTable());
+
+        err_code = app_ble_gap_sec_context_create(conn_handle, &keyset);
+
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        if (p_sec_keyset)
+        {
+            std::memcpy(&keyset->keyset, p_sec_keyset, sizeof(ble_gap_sec_keyset_t));
+        }
     }
 
     return encode_decode(adapter, encode_function, decode_function);
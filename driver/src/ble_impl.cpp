@@ -12,6 +12,7 @@
 
 #include "adapter.h"
 #include "ble_common.h"
+#include "adapter_internal.h"
 
 #include "ble.h"
 #include "ble_app.h"
@@ -193,11 +194,6 @@ uint32_t sd_ble_enable(adapter_t *adapter, ble_enable_params_t * p_params, uint3
 
 uint32_t sd_ble_user_mem_reply(adapter_t *adapter, uint16_t conn_handle, ble_user_mem_block_t const *p_block)
 {
-    if (p_block != nullptr)
-    {
-        return NRF_ERROR_INVALID_PARAM;
-    }
-
     encode_function_t encode_function = [&](uint8_t *buffer, uint32_t *length) -> uint32_t {
         return ble_user_mem_reply_req_enc(
             conn_handle,
@@ -213,7 +209,34 @@ uint32_t sd_ble_user_mem_reply(adapter_t *adapter, uint16_t conn_handle, ble_use
             result);
     };
 
-    return encode_decode(adapter, encode_function, decode_function);
+    auto adapterInternal = static_cast<AdapterInternal*>(adapter->internal);
+
+    // The block is stored in the connection table so that the events of the queued writes can be decoded into it.
+    // The context is only held while the block is stored, not while waiting for the response.
+    if (p_block != nullptr)
+    {
+        BLEConnectionContext context(adapterInternal->transport->getConnectionTable());
+        ser_ble_user_mem_t *user_mem;
+
+        auto err_code = app_ble_user_mem_context_create(conn_handle, &user_mem);
+
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        user_mem->mem_block = *p_block;
+    }
+
+    auto err_code = encode_decode(adapter, encode_function, decode_function);
+
+    if (err_code != NRF_SUCCESS && p_block != nullptr)
+    {
+        BLEConnectionContext context(adapterInternal->transport->getConnectionTable());
+        app_ble_user_mem_context_destroy(conn_handle);
+    }
+
+    return err_code;
 }
 
 
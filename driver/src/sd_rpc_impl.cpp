@@ -17,6 +17,7 @@
 #include "h5_transport.h"
 #include "uart_boost.h"
 #include "uart_settings_boost.h"
+#include "event_pool.h"
 
 #include <stdlib.h>
 
@@ -55,10 +56,15 @@ physical_layer_t *sd_rpc_physical_layer_create_uart(const char * port_name, uint
 }
 
 data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire(physical_layer_t *physical_layer, uint32_t retransmission_interval)
+{
+    return sd_rpc_data_link_layer_create_bt_three_wire_windowed(physical_layer, retransmission_interval, 1);
+}
+
+data_link_layer_t *sd_rpc_data_link_layer_create_bt_three_wire_windowed(physical_layer_t *physical_layer, uint32_t retransmission_interval, uint8_t transmit_window_size)
 {
     auto dataLinkLayer = static_cast<data_link_layer_t *>(malloc(sizeof(data_link_layer_t)));
     auto physicalLayer = static_cast<Transport *>(physical_layer->internal);
-    auto h5 = new H5Transport(physicalLayer, retransmission_interval);
+    auto h5 = new H5Transport(physicalLayer, retransmission_interval, transmit_window_size);
     dataLinkLayer->internal = static_cast<void *>(h5);
     return dataLinkLayer;
 }
@@ -98,3 +104,56 @@ uint32_t sd_rpc_close(adapter_t *adapter)
     auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
     return adapterLayer->close();
 }
+
+uint32_t sd_rpc_evt_retain(adapter_t *adapter, ble_evt_t *p_ble_evt)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->transport->retainEvent(p_ble_evt);
+}
+
+void sd_rpc_evt_release(ble_evt_t *p_ble_evt)
+{
+    EventPool::release(p_ble_evt);
+}
+
+uint32_t sd_rpc_evt_read_time(adapter_t *adapter, const ble_evt_t *p_ble_evt, uint64_t *p_read_time)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->transport->getEventReadTime(p_ble_evt, p_read_time);
+}
+
+uint32_t sd_rpc_latency_get(adapter_t *adapter, sd_rpc_latency_stage_t stage, sd_rpc_latency_t *p_latency)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->transport->getLatencyStatistics().getLatency(stage, p_latency);
+}
+
+uint32_t sd_rpc_latency_record(adapter_t *adapter, sd_rpc_latency_stage_t stage, uint64_t latency)
+{
+    if (stage < 0 || stage >= SD_RPC_LATENCY_STAGE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    adapterLayer->transport->getLatencyStatistics().record(stage, latency);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_rpc_command_latency_get(adapter_t *adapter, uint8_t op_code, sd_rpc_latency_t *p_latency)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->transport->getLatencyStatistics().getCommandLatency(op_code, p_latency);
+}
+
+uint32_t sd_rpc_conn_state_get(adapter_t *adapter, uint16_t conn_handle, sd_rpc_conn_state_t *p_state)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->transport->getConnectionTable().getState(conn_handle, p_state);
+}
+
+uint32_t sd_rpc_log_handler_severity_filter_set(adapter_t *adapter, sd_rpc_log_severity_t severity_filter)
+{
+    auto adapterLayer = static_cast<AdapterInternal*>(adapter->internal);
+    return adapterLayer->logSeverityFilterSet(severity_filter);
+}
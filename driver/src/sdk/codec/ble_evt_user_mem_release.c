@@ -17,8 +17,6 @@
 #include "ble_evt_app.h"
 #include "app_ble_user_mem.h"
 
-extern ser_ble_user_mem_t m_app_user_mem_table[];
-
 uint32_t ble_evt_user_mem_release_dec(uint8_t const * const p_buf,
                                       uint32_t              packet_len,
                                       ble_evt_t * const     p_event,
@@ -57,10 +55,10 @@ uint32_t ble_evt_user_mem_release_dec(uint8_t const * const p_buf,
     if (p_buf[index++] == SER_FIELD_PRESENT)
     {
         // Using connection handle find which mem block to release in Application Processor
-        uint32_t user_mem_table_index;
-        err_code = app_ble_user_mem_context_find(p_event->evt.common_evt.conn_handle, &user_mem_table_index);
+        ser_ble_user_mem_t * p_user_mem;
+        err_code = app_ble_user_mem_context_find(p_event->evt.common_evt.conn_handle, &p_user_mem);
         SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-        p_user_mem_rel->mem_block.p_mem = m_app_user_mem_table[user_mem_table_index].mem_block.p_mem;
+        p_user_mem_rel->mem_block.p_mem = p_user_mem->mem_block.p_mem;
     }
     else
     {
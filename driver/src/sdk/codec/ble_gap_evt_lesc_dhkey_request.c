@@ -16,7 +16,6 @@
 #include "cond_field_serialization.h"
 #include "app_util.h"
 #include "app_ble_gap_sec_keys.h"
-extern ser_ble_gap_app_keyset_t m_app_keys_table[];
 
 uint32_t ble_gap_evt_lesc_dhkey_request_dec(uint8_t const * const p_buf,
                                             uint32_t              packet_len,
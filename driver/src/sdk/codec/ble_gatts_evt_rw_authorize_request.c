@@ -16,8 +16,6 @@
 #include "app_ble_user_mem.h"
 #include "app_util.h"
 
-extern ser_ble_user_mem_t m_app_user_mem_table[];
-
 uint32_t ble_gatts_evt_rw_authorize_request_dec(uint8_t const * const p_buf,
                                                 uint32_t              packet_len,
                                                 ble_evt_t * const     p_event,
@@ -62,11 +60,11 @@ uint32_t ble_gatts_evt_rw_authorize_request_dec(uint8_t const * const p_buf,
     {
         if((p_event->evt.gatts_evt.params.authorize_request.type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) && (p_event->evt.gatts_evt.params.authorize_request.request.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW))
         {
-            uint32_t conn_index;
+            ser_ble_user_mem_t * p_user_mem;
         
-            if(app_ble_user_mem_context_find(p_event->evt.gatts_evt.conn_handle, &conn_index) != NRF_ERROR_NOT_FOUND)
+            if(app_ble_user_mem_context_find(p_event->evt.gatts_evt.conn_handle, &p_user_mem) != NRF_ERROR_NOT_FOUND)
             {      
-                err_code = len16data_dec(p_buf, packet_len, &index, &m_app_user_mem_table[conn_index].mem_block.p_mem, &m_app_user_mem_table[conn_index].mem_block.len);
+                err_code = len16data_dec(p_buf, packet_len, &index, &p_user_mem->mem_block.p_mem, &p_user_mem->mem_block.len);
                 SER_ASSERT(err_code == NRF_SUCCESS, err_code);
             }
         }
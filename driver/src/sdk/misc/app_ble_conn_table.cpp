@@ -0,0 +1,111 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+*
+* The information contained herein is property of Nordic Semiconductor ASA.
+* Terms and conditions of usage are described in detail in NORDIC
+* SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+*
+* Licensees are granted free, non-transferable use of the information. NO
+* WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+* the file.
+*
+*/
+
+#include "app_ble_conn_table.h"
+#include "nrf_error.h"
+#include <cstring>
+
+// Table of the adapter whose codecs run in this thread, set by app_ble_conn_context_root_set
+static thread_local app_ble_conn_table_t *current_table = nullptr;
+
+static void reset_entry(app_ble_conn_entry_t &entry)
+{
+    std::memset(&entry, 0, sizeof(entry));
+    entry.state.att_mtu = GATT_MTU_SIZE_DEFAULT;
+    entry.state.conn_sec.sec_mode.sm = 1;
+    entry.state.conn_sec.sec_mode.lv = 1;
+}
+
+app_ble_conn_table_t::app_ble_conn_table_t()
+{
+    for (auto &entry : entries)
+    {
+        reset_entry(entry);
+    }
+}
+
+app_ble_conn_entry_t *app_ble_conn_table_t::find(uint16_t conn_handle)
+{
+    return conn_handle < entries.size() ? &entries[conn_handle] : nullptr;
+}
+
+void app_ble_conn_table_t::update(const ble_evt_t *p_event)
+{
+    switch (p_event->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            auto entry = find(p_event->evt.gap_evt.conn_handle);
+            if (entry == nullptr) return;
+
+            // Keysets and user memory left from an earlier connection with the same handle are dropped
+            reset_entry(*entry);
+            entry->state.connected = 1;
+            break;
+        }
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            auto entry = find(p_event->evt.gap_evt.conn_handle);
+            if (entry == nullptr) return;
+
+            reset_entry(*entry);
+            break;
+        }
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+        {
+            auto entry = find(p_event->evt.gap_evt.conn_handle);
+            if (entry == nullptr) return;
+
+            entry->state.conn_sec = p_event->evt.gap_evt.params.conn_sec_update.conn_sec;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+uint32_t app_ble_conn_table_t::getState(uint16_t conn_handle, sd_rpc_conn_state_t *p_state)
+{
+    if (p_state == nullptr) return NRF_ERROR_NULL;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = find(conn_handle);
+
+    if (entry == nullptr) return NRF_ERROR_INVALID_PARAM;
+    if (!entry->state.connected) return NRF_ERROR_NOT_FOUND;
+
+    *p_state = entry->state;
+    return NRF_SUCCESS;
+}
+
+void app_ble_conn_context_root_set(app_ble_conn_table_t *p_table)
+{
+    p_table->mutex.lock();
+    current_table = p_table;
+}
+
+void app_ble_conn_context_root_release()
+{
+    auto table = current_table;
+    current_table = nullptr;
+    table->mutex.unlock();
+}
+
+app_ble_conn_table_t *app_ble_conn_context_root_get()
+{
+    return current_table;
+}
+
+app_ble_conn_entry_t *app_ble_conn_context_find(uint16_t conn_handle)
+{
+    return current_table == nullptr ? nullptr : current_table->find(conn_handle);
+}
@@ -23,70 +23,23 @@
 */
 
 #include "app_ble_gap_sec_keys.h"
+#include "app_ble_conn_table.h"
 #include "nrf_error.h"
 #include <stddef.h>
-
-// C++ code
-#include "adapter.h"
-
-#include <map>
-#include <vector>
-#include <thread>
-#include <mutex>
-
-#include <boost/thread/tss.hpp>
-
-typedef std::map<uint16_t, ser_ble_gap_app_keyset_t*> connhandle_keyset_t;
-
-// Map with context, each with a set of conn_handle and each conn_handle a ser_ble_gap_app_keyset_t*
-std::map<void*, connhandle_keyset_t*> m_app_keys_table;
-void *current_context = nullptr;
-std::mutex current_context_mutex;
-
-void app_ble_gap_sec_context_root_set(void *context)
-{
-    current_context_mutex.lock();
-    current_context = context;
-}
-
-void app_ble_gap_sec_context_root_release()
-{
-    current_context = nullptr;
-    current_context_mutex.unlock();
-}
+#include <cstring>
 
 uint32_t app_ble_gap_sec_context_create(uint16_t conn_handle, ser_ble_gap_app_keyset_t **pp_gap_app_keyset)
 {
-    if (current_context == nullptr) return NRF_ERROR_INVALID_DATA;
-
-    auto tempRootContext = m_app_keys_table.find(current_context);
-
-    auto keyset = new ser_ble_gap_app_keyset_t();
-
-    // If current context is not found we have to add it
-    if (tempRootContext == m_app_keys_table.end()) 
-    {
-        auto connectionAndKeyset = new std::map<uint16_t, ser_ble_gap_app_keyset_t*>{
-            { conn_handle, keyset }
-        };
+    auto table = app_ble_conn_context_root_get();
+    if (table == nullptr) return NRF_ERROR_INVALID_DATA;
 
-        m_app_keys_table.insert(std::make_pair(current_context, connectionAndKeyset));
-    }
-    else
-    {
-        auto connHandleMap = tempRootContext->second;
-        auto connHandle = connHandleMap->find(conn_handle);
+    auto entry = table->find(conn_handle);
+    if (entry == nullptr) return NRF_ERROR_NO_MEM;
 
-        // If connection handle does not exist from before
-        // we create a new ser_ble_gap_app_keyset_t for the connnection handle
-        if (connHandle != connHandleMap->end())
-        {
-            delete connHandle->second;
-            connHandleMap->erase(conn_handle);
-        }
-
-        connHandleMap->insert(std::make_pair(conn_handle, keyset));
-    }
+    // A keyset left from an earlier pairing on the connection handle is replaced
+    auto keyset = &entry->keyset;
+    std::memset(keyset, 0, sizeof(ser_ble_gap_app_keyset_t));
+    keyset->conn_active = 1;
 
     *pp_gap_app_keyset = keyset;
     return NRF_SUCCESS;
@@ -94,28 +47,18 @@ uint32_t app_ble_gap_sec_context_create(uint16_t conn_handle, ser_ble_gap_app_ke
 
 uint32_t app_ble_gap_sec_context_destroy(uint16_t conn_handle)
 {
-    auto tempAdapter = m_app_keys_table.find(current_context);
-    if (tempAdapter == m_app_keys_table.end()) return NRF_ERROR_NOT_FOUND;
-
-    auto connHandleMap = tempAdapter->second;
-    auto connHandle = connHandleMap->find(conn_handle);
-
-    if (connHandle == connHandleMap->end()) return NRF_ERROR_NOT_FOUND;
-    delete connHandle->second; // Delete the ser_ble_gap_app_keyset_t 
-    connHandleMap->erase(conn_handle);
+    auto entry = app_ble_conn_context_find(conn_handle);
+    if (entry == nullptr || !entry->keyset.conn_active) return NRF_ERROR_NOT_FOUND;
 
+    entry->keyset.conn_active = 0;
     return NRF_SUCCESS;
 }
 
 uint32_t app_ble_gap_sec_context_find(uint16_t conn_handle, ser_ble_gap_app_keyset_t **pp_gap_app_keyset)
 {
-    auto tempAdapter = m_app_keys_table.find(current_context);
-    if (tempAdapter == m_app_keys_table.end()) return NRF_ERROR_NOT_FOUND;
-
-    auto connHandleMap = tempAdapter->second;
-    auto connHandle = connHandleMap->find(conn_handle);
+    auto entry = app_ble_conn_context_find(conn_handle);
+    if (entry == nullptr || !entry->keyset.conn_active) return NRF_ERROR_NOT_FOUND;
 
-    if (connHandle == connHandleMap->end()) return NRF_ERROR_NOT_FOUND;
-    *pp_gap_app_keyset = connHandle->second;
+    *pp_gap_app_keyset = &entry->keyset;
     return NRF_SUCCESS;
 }
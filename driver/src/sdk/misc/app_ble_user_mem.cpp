@@ -0,0 +1,48 @@
+/* Copyright (c) 2014 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_ble_user_mem.h"
+#include "app_ble_conn_table.h"
+#include "nrf_error.h"
+#include <stddef.h>
+
+uint32_t app_ble_user_mem_context_create(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem)
+{
+  if (app_ble_conn_context_root_get() == nullptr) return NRF_ERROR_INVALID_DATA;
+
+  auto entry = app_ble_conn_context_find(conn_handle);
+  if (entry == nullptr) return NRF_ERROR_NO_MEM;
+
+  entry->user_mem.conn_active = 1;
+  entry->user_mem.conn_handle = conn_handle;
+  *pp_user_mem = &entry->user_mem;
+
+  return NRF_SUCCESS;
+}
+
+uint32_t app_ble_user_mem_context_destroy(uint16_t conn_handle)
+{
+  auto entry = app_ble_conn_context_find(conn_handle);
+  if (entry == nullptr || !entry->user_mem.conn_active) return NRF_ERROR_NOT_FOUND;
+
+  entry->user_mem.conn_active = 0;
+  return NRF_SUCCESS;
+}
+
+uint32_t app_ble_user_mem_context_find(uint16_t conn_handle, ser_ble_user_mem_t **pp_user_mem)
+{
+  auto entry = app_ble_conn_context_find(conn_handle);
+  if (entry == nullptr || !entry->user_mem.conn_active) return NRF_ERROR_NOT_FOUND;
+
+  *pp_user_mem = &entry->user_mem;
+  return NRF_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "event_pool.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    const size_t SIZE_CLASSES[] = { 64, 128, 256, 512, 1024 };
+    const size_t SIZE_CLASS_COUNT = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+    const size_t NO_SIZE_CLASS = SIZE_CLASS_COUNT;
+
+    // Number of free buffers kept per size class, buffers released beyond this are freed
+    const size_t MAX_FREE_BUFFERS = 256;
+
+    // Stored in front of every buffer so that release knows where the buffer belongs
+    union BufferHeader
+    {
+        size_t sizeClass;
+        long double alignment;
+        void *pointerAlignment;
+    };
+
+    struct FreeLists
+    {
+        std::mutex mutex;
+        std::vector<BufferHeader *> buffers[SIZE_CLASS_COUNT];
+    };
+
+    FreeLists &freeLists()
+    {
+        static FreeLists lists;
+        return lists;
+    }
+}
+
+void *EventPool::allocate(size_t size)
+{
+    auto sizeClass = NO_SIZE_CLASS;
+
+    for (size_t i = 0; i < SIZE_CLASS_COUNT; i++)
+    {
+        if (size <= SIZE_CLASSES[i])
+        {
+            sizeClass = i;
+            break;
+        }
+    }
+
+    BufferHeader *header = nullptr;
+
+    if (sizeClass != NO_SIZE_CLASS)
+    {
+        auto &lists = freeLists();
+        std::lock_guard<std::mutex> lock(lists.mutex);
+        auto &buffers = lists.buffers[sizeClass];
+
+        if (!buffers.empty())
+        {
+            header = buffers.back();
+            buffers.pop_back();
+        }
+    }
+
+    if (header == nullptr)
+    {
+        auto bufferSize = sizeClass != NO_SIZE_CLASS ? SIZE_CLASSES[sizeClass] : size;
+        header = static_cast<BufferHeader *>(std::malloc(sizeof(BufferHeader) + bufferSize));
+
+        if (header == nullptr)
+        {
+            return nullptr;
+        }
+
+        header->sizeClass = sizeClass;
+    }
+
+    return header + 1;
+}
+
+void EventPool::release(void *buffer)
+{
+    if (buffer == nullptr)
+    {
+        return;
+    }
+
+    auto header = static_cast<BufferHeader *>(buffer) - 1;
+
+    if (header->sizeClass != NO_SIZE_CLASS)
+    {
+        auto &lists = freeLists();
+        std::lock_guard<std::mutex> lock(lists.mutex);
+        auto &buffers = lists.buffers[header->sizeClass];
+
+        if (buffers.size() < MAX_FREE_BUFFERS)
+        {
+            buffers.push_back(header);
+            return;
+        }
+    }
+
+    std::free(header);
+}
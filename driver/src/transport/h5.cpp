@@ -28,7 +28,7 @@ const uint16_t payloadLengthFirstNibbleMask = 0x000F;
 const uint16_t payloadLengthSecondNibbleMask = 0x0FF0;
 const uint8_t payloadLengthOffset = 4;
 
-uint8_t calculate_header_checksum(std::vector<uint8_t> &header)
+uint8_t calculate_header_checksum(const uint8_t *header)
 {
     uint16_t checksum;
 
@@ -41,17 +41,64 @@ uint8_t calculate_header_checksum(std::vector<uint8_t> &header)
     return static_cast<uint8_t>(checksum);
 }
 
-uint16_t calculate_crc16_checksum(std::vector<uint8_t>::iterator start, std::vector<uint8_t>::iterator end)
+namespace
 {
+    // Lookup tables for CRC-16-CCITT (polynomial 0x1021) processing four bytes per iteration.
+    // table[n][i] is the CRC contribution of byte i followed by n zero bytes.
+    struct Crc16Tables
+    {
+        uint16_t table[4][256];
+
+        Crc16Tables()
+        {
+            for (uint16_t i = 0; i < 256; i++)
+            {
+                uint16_t crc = static_cast<uint16_t>(i << 8);
+
+                for (auto bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+                }
+
+                table[0][i] = crc;
+            }
+
+            for (auto n = 1; n < 4; n++)
+            {
+                for (auto i = 0; i < 256; i++)
+                {
+                    auto previous = table[n - 1][i];
+                    table[n][i] = static_cast<uint16_t>((previous << 8) ^ table[0][previous >> 8]);
+                }
+            }
+        }
+    };
+
+    const Crc16Tables &crc16Tables()
+    {
+        static const Crc16Tables tables;
+        return tables;
+    }
+}
+
+uint16_t calculate_crc16_checksum(const uint8_t *start, const uint8_t *end)
+{
+    auto &table = crc16Tables().table;
     uint16_t crc = 0xFFFF;
 
-    std::for_each(start, end, [&crc](uint8_t data) {
-        crc = (crc >> 8) | (crc << 8);
-        crc ^= data;
-        crc ^= (crc & 0xFF) >> 4;
-        crc ^= crc << 12;
-        crc ^= (crc & 0xFF) << 5;
-    });
+    while (end - start >= 4)
+    {
+        crc = table[3][start[0] ^ (crc >> 8)]
+            ^ table[2][start[1] ^ (crc & 0xFF)]
+            ^ table[1][start[2]]
+            ^ table[0][start[3]];
+        start += 4;
+    }
+
+    while (start != end)
+    {
+        crc = static_cast<uint16_t>((crc << 8) ^ table[0][*start++ ^ (crc >> 8)]);
+    }
 
     return crc;
 }
@@ -75,12 +122,12 @@ void add_h5_header(std::vector<uint8_t> &out_packet,
         | ((payload_length & payloadLengthFirstNibbleMask) << payloadLengthOffset));
 
     out_packet.push_back((payload_length & payloadLengthSecondNibbleMask) >> payloadLengthOffset);
-    out_packet.push_back(calculate_header_checksum(out_packet));
+    out_packet.push_back(calculate_header_checksum(out_packet.data() + out_packet.size() - 3));
 }
 
 void add_crc16(std::vector<uint8_t> &out_packet)
 {
-    uint16_t crc16 = calculate_crc16_checksum(out_packet.begin(), out_packet.end());
+    uint16_t crc16 = calculate_crc16_checksum(out_packet.data(), out_packet.data() + out_packet.size());
     out_packet.push_back(crc16 & 0xFF);
     out_packet.push_back((crc16 >> 8) & 0xFF);
 }
@@ -93,6 +140,8 @@ void h5_encode(std::vector<uint8_t> &in_packet,
                    bool reliable_packet,
                    h5_pkt_type_t packet_type)
 {
+    out_packet.reserve(out_packet.size() + H5_HEADER_LENGTH + in_packet.size() + (crc_present ? 2 : 0));
+
     add_h5_header(
         out_packet,
         seq_num,
@@ -111,19 +160,35 @@ void h5_encode(std::vector<uint8_t> &in_packet,
     }
 }
 
-uint32_t h5_decode(std::vector<uint8_t> &slipPayload,
-                   std::vector<uint8_t> &h5Payload,
+uint32_t h5_decode_header(const uint8_t *header, size_t *packet_length)
+{
+    if (header[3] != calculate_header_checksum(header))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    auto crc_present = static_cast<bool>(((header[0] >> crcPresentPos) & crcPresentMask) != 0);
+    uint16_t payload_length = ((header[1] >> payloadLengthOffset) & payloadLengthFirstNibbleMask) + (static_cast<uint16_t>(header[2]) << payloadLengthOffset);
+
+    *packet_length = payload_length + H5_HEADER_LENGTH + (crc_present ? 2 : 0);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t h5_decode(uint8_t *slipPayload,
+                   size_t length,
+                   uint8_t **h5Payload,
+                   uint16_t *_payload_length,
                    uint8_t *seq_num,
                    uint8_t *ack_num,
                    bool *_data_integrity,
-                   uint16_t *_payload_length,
                    uint8_t *_header_checksum,
                    bool *reliable_packet,
                    h5_pkt_type_t *packet_type)
 {
     uint16_t payload_length;
 
-    if (slipPayload.size() < 4)
+    if (length < H5_HEADER_LENGTH)
     {
         return NRF_ERROR_INVALID_LENGTH;
     }
@@ -139,12 +204,12 @@ uint32_t h5_decode(std::vector<uint8_t> &slipPayload,
     // Check if received packet size matches the packet size stated in header
     auto calculatedPayloadSize = payload_length + H5_HEADER_LENGTH + (crc_present ? 2 : 0);
 
-    if (slipPayload.size() != calculatedPayloadSize)
+    if (length != calculatedPayloadSize)
     {
         return NRF_ERROR_INVALID_DATA;
     }
 
-    if (_payload_length != nullptr) *_payload_length = payload_length;
+    *_payload_length = payload_length;
     if (_data_integrity != nullptr) *_data_integrity = crc_present;
     if (_header_checksum != nullptr) *_header_checksum = header_checksum;
 
@@ -158,7 +223,7 @@ uint32_t h5_decode(std::vector<uint8_t> &slipPayload,
     if (crc_present)
     {
         uint16_t packet_checksum = slipPayload[payload_length + H5_HEADER_LENGTH] + (slipPayload[payload_length + H5_HEADER_LENGTH + 1] << 8);
-        auto calculated_packet_checksum = calculate_crc16_checksum(slipPayload.begin(), slipPayload.begin() + payload_length + H5_HEADER_LENGTH);
+        auto calculated_packet_checksum = calculate_crc16_checksum(slipPayload, slipPayload + payload_length + H5_HEADER_LENGTH);
 
         if (packet_checksum != calculated_packet_checksum)
         {
@@ -166,11 +231,8 @@ uint32_t h5_decode(std::vector<uint8_t> &slipPayload,
         }
     }
 
-    if (payload_length > 0)
-    {
-        auto payloadIterator = slipPayload.begin() + 4;
-        h5Payload.insert(h5Payload.begin(), payloadIterator, payloadIterator + payload_length);
-    }
+    // The payload is not copied, it refers to the data in slipPayload
+    *h5Payload = slipPayload + H5_HEADER_LENGTH;
 
     return NRF_SUCCESS;
 }
@@ -49,16 +49,20 @@ const uint8_t PACKET_RETRANSMISSIONS = 4;                              // Number
 // Other constants
 const auto OPEN_WAIT_TIMEOUT = std::chrono::milliseconds(2000);   // Duration to wait for state ACTIVE after open is called
 const auto RESET_WAIT_DURATION = std::chrono::milliseconds(300);  // Duration to wait before continuing UART communication after reset is sent to target
+const uint8_t MAX_TRANSMIT_WINDOW_SIZE = 7;                         // Largest window the 3 bit sequence numbers allow
+const size_t MAX_PACKET_LENGTH = H5_HEADER_LENGTH + 0xFFF + 2;      // Header, largest payload the 12 bit length field allows and CRC
 
 #pragma region Public methods
-H5Transport::H5Transport(Transport *_nextTransportLayer, uint32_t retransmission_interval)
+H5Transport::H5Transport(Transport *_nextTransportLayer, uint32_t retransmission_interval, uint8_t transmit_window_size)
     : Transport(),
-    seqNum(0), ackNum(0), c0Found(false),
-    unprocessedData(), incomingPacketCount(0), outgoingPacketCount(0),
+    seqNum(0), ackNum(0), transmitWindowSize(1), transmitWindowOpen(false), slipState(SLIP_STATE_HUNTING),
+    rxPacket(), rxPacketLength(0), rxPacketStartTime(0), incomingPacketCount(0), outgoingPacketCount(0),
     errorPacketCount(0), currentState(STATE_START), stateMachineThread(nullptr)
 {
     this->nextTransportLayer = _nextTransportLayer;
     retransmissionInterval = std::chrono::milliseconds(retransmission_interval);
+    maxTransmitWindowSize = std::min(std::max(transmit_window_size, static_cast<uint8_t>(1)), MAX_TRANSMIT_WINDOW_SIZE);
+    rxPacket.reserve(MAX_PACKET_LENGTH);
 
     setupStateMachine();
 }
@@ -113,11 +117,15 @@ uint32_t H5Transport::open(status_cb_t status_callback, data_cb_t data_callback,
     auto _exitCriterias = dynamic_cast<StartExitCriterias*>(exitCriterias[STATE_START]);
 
     auto errorCode = Transport::open(status_callback, data_callback, log_callback);
-    lastPacket.clear();
 
     if (errorCode != NRF_SUCCESS)
     {
-        _exitCriterias->ioResourceError = true;
+        {
+            // Set under the lock the state machine waits with, so that the notification is not lost
+            std::lock_guard<std::mutex> syncGuard(syncMutex);
+            _exitCriterias->ioResourceError = true;
+        }
+
         syncWaitCondition.notify_all();
         return errorCode;
     }
@@ -128,12 +136,20 @@ uint32_t H5Transport::open(status_cb_t status_callback, data_cb_t data_callback,
 
     if (errorCode != NRF_SUCCESS)
     {
-        _exitCriterias->ioResourceError = true;
+        {
+            std::lock_guard<std::mutex> syncGuard(syncMutex);
+            _exitCriterias->ioResourceError = true;
+        }
+
         syncWaitCondition.notify_all();
         return NRF_ERROR_INTERNAL;
     }
 
-    _exitCriterias->isOpened = true;
+    {
+        std::lock_guard<std::mutex> syncGuard(syncMutex);
+        _exitCriterias->isOpened = true;
+    }
+
     syncWaitCondition.notify_all();
 
     if (waitForState(STATE_ACTIVE, OPEN_WAIT_TIMEOUT))
@@ -171,81 +187,117 @@ uint32_t H5Transport::close()
 }
 
 uint32_t H5Transport::send(std::vector<uint8_t> &data)
+{
+    std::mutex completionMutex;
+    std::condition_variable completionCondition;
+    auto completed = false;
+    uint32_t result = NRF_SUCCESS;
+
+    auto errorCode = sendAsync(data, [&](uint32_t error_code)
+    {
+        std::lock_guard<std::mutex> completionGuard(completionMutex);
+        result = error_code;
+        completed = true;
+        completionCondition.notify_one();
+    });
+
+    if (errorCode != NRF_SUCCESS)
+    {
+        return errorCode;
+    }
+
+    std::unique_lock<std::mutex> completionGuard(completionMutex);
+    completionCondition.wait(completionGuard, [&] { return completed; });
+
+    return result;
+}
+
+uint32_t H5Transport::sendAsync(std::vector<uint8_t> &data, send_cb_t completion_callback)
 {
     if (currentState != STATE_ACTIVE) {
         return NRF_ERROR_INVALID_STATE;
     }
 
-    // max theoretical length of encoded packet, aditional 6 bytes h5 encoding and all bytes escaped + 2 packet encapsuling
-    std::vector<uint8_t> h5EncodedPacket;
+    std::unique_lock<std::mutex> ackGuard(ackMutex);
+
+    // Wait for a free slot in the transmit window. Slots are released when packets are acknowledged
+    // or given up, and all of them when state ACTIVE is left.
+    ackWaitCondition.wait(ackGuard, [&] { return !transmitWindowOpen || outstandingPackets.size() < transmitWindowSize; });
+
+    if (!transmitWindowOpen)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    OutstandingPacket outstandingPacket;
 
     h5_encode(data,
-              h5EncodedPacket,
+              outstandingPacket.h5Packet,
               seqNum,
               ackNum,
               true,
               true,
               VENDOR_SPECIFIC_PACKET);
 
-    std::vector<uint8_t> encodedPacket;
-    slip_encode(h5EncodedPacket, encodedPacket);
+    slip_encode(outstandingPacket.h5Packet, outstandingPacket.slipPacket);
 
-    auto remainingRetransmissions = PACKET_RETRANSMISSIONS;
+    outstandingPacket.seqNum = seqNum;
+    outstandingPacket.remainingRetransmissions = PACKET_RETRANSMISSIONS - 1;
+    outstandingPacket.retransmitAt = std::chrono::steady_clock::now() + retransmissionInterval;
+    outstandingPacket.completionCallback = completion_callback;
 
-    lastPacket.clear();
-    lastPacket = encodedPacket;
+    incrementSeqNum();
+    outstandingPackets.push_back(std::move(outstandingPacket));
 
-    std::unique_lock<std::mutex> ackGuard(ackMutex);
+    // Packets are written while holding ackMutex so that they reach the UART in sequence number order.
+    // The retransmission timer is served by the state machine thread.
+    auto &packet = outstandingPackets.back();
+    logPacket(true, packet.h5Packet.data(), packet.h5Packet.size());
+    nextTransportLayer->send(packet.slipPacket);
 
-    while (remainingRetransmissions--)
-    {
-        logPacket(true, h5EncodedPacket);
-        nextTransportLayer->send(lastPacket);
-
-        auto status = ackWaitCondition.wait_for(ackGuard, std::chrono::milliseconds(retransmissionInterval));
+    return NRF_SUCCESS;
+}
 
-        if (status == std::cv_status::no_timeout)
-        {
-            lastPacket.clear();
-            return NRF_SUCCESS;
-        }
-    }
+void H5Transport::setLogSeverityFilter(sd_rpc_log_severity_t severity_filter)
+{
+    Transport::setLogSeverityFilter(severity_filter);
+    nextTransportLayer->setLogSeverityFilter(severity_filter);
+}
 
-    lastPacket.clear();
+// Packets are passed on in the read handler of the physical layer, they are read at the same time as the data below
+uint64_t H5Transport::getReadTime() const
+{
+    return nextTransportLayer->getReadTime();
+}
 
-    return NRF_ERROR_TIMEOUT;
+void H5Transport::setLatencyStatistics(LatencyStatistics *latency_statistics)
+{
+    Transport::setLatencyStatistics(latency_statistics);
+    nextTransportLayer->setLatencyStatistics(latency_statistics);
 }
 #pragma endregion Public methods
 
 #pragma region Processing incoming data from UART
-void H5Transport::processPacket(std::vector<uint8_t> &packet)
+void H5Transport::processPacket(uint8_t *packet, size_t length)
 {
     uint8_t seq_num;
     uint8_t ack_num;
     bool reliable_packet;
     h5_pkt_type_t packet_type;
+    uint8_t *h5Payload;
+    uint16_t h5PayloadLength;
 
-    std::vector<uint8_t> slipPayload;
-    auto err_code = slip_decode(packet, slipPayload);
-
-    if (err_code != NRF_SUCCESS)
-    {
-        errorPacketCount++;
-        return;
-    }
+    logPacket(false, packet, length);
 
-    logPacket(false, slipPayload);
-
-    std::vector<uint8_t> h5Payload;
-
-    err_code = h5_decode(
-        slipPayload, 
-        h5Payload,
+    auto err_code = h5_decode(
+        packet,
+        length,
+        &h5Payload,
+        &h5PayloadLength,
         &seq_num,
         &ack_num,
         nullptr,
         nullptr,
-        nullptr,
         &reliable_packet,
         &packet_type);
 
@@ -264,6 +316,12 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
 
     if (packet_type == LINK_CONTROL_PACKET)
     {
+        if (h5PayloadLength < 2)
+        {
+            errorPacketCount++;
+            return;
+        }
+
         auto isSyncPacket = h5Payload[0] == syncFirstByte && h5Payload[1] == syncSecondByte;
         auto isSyncResponsePacket = h5Payload[0] == syncRspFirstByte && h5Payload[1] == syncRspSecondByte;
         auto isSyncConfigPacket = h5Payload[0] == syncConfigFirstByte && h5Payload[1] == syncConfigSecondByte;
@@ -285,6 +343,14 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
             auto exit = dynamic_cast<InitializedExitCriterias*>(exitCriterias[currentState]);
 
             if (isSyncConfigResponsePacket) {
+                // Use the smallest of the requested window size and the one supported by target
+                uint8_t targetWindowSize = h5PayloadLength > 2 ? (h5Payload[2] & syncConfigWindowSizeMask) : 1;
+
+                {
+                    std::lock_guard<std::mutex> ackGuard(ackMutex);
+                    transmitWindowSize = std::max(std::min(maxTransmitWindowSize, targetWindowSize), static_cast<uint8_t>(1));
+                }
+
                 exit->syncConfigRspReceived = true;
                 syncWaitCondition.notify_all();
             }
@@ -322,7 +388,18 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
                 {
                     incrementAckNum();
                     sendControlPacket(CONTROL_PKT_ACK);
-                    dataCallback(h5Payload.data(), h5Payload.size());
+
+                    if (latencyStatistics != nullptr)
+                    {
+                        latencyStatistics->recordSince(SD_RPC_LATENCY_ACK_SENT, getReadTime());
+                    }
+
+                    dataCallback(h5Payload, h5PayloadLength);
+                }
+                else if (((ackNum - seq_num) & 0x07) <= transmitWindowSize)
+                {
+                    // Retransmission of a packet already received, the acknowledgement was probably lost
+                    sendControlPacket(CONTROL_PKT_ACK);
                 }
                 else
                 {
@@ -334,21 +411,16 @@ void H5Transport::processPacket(std::vector<uint8_t> &packet)
     }
     else if (packet_type == ACK_PACKET)
     {
-        if (ack_num == ((seqNum + 1) & 0x07))
-        {
-            // Received a packet with valid ack_num, inform threads that wait the command is received on the other end
-            std::lock_guard<std::mutex> ackGuard(ackMutex);
-            incrementSeqNum();
-            ackWaitCondition.notify_all();
-        }
-        else if (ack_num == seqNum)
+        // Acknowledgements before the link is active are left from an earlier session of the target, discard them
+        if (currentState == STATE_ACTIVE && !processAcknowledgement(ack_num))
         {
-            // Discard packet, we assume that we have received a reply from a previous packet
-        }
-        else
-        {
-            dynamic_cast<ActiveExitCriterias*>(exitCriterias[currentState])->irrecoverableSyncError = true;
-            syncWaitCondition.notify_all();
+            auto exit = dynamic_cast<ActiveExitCriterias*>(exitCriterias[currentState]);
+
+            if (exit != nullptr)
+            {
+                exit->irrecoverableSyncError = true;
+                syncWaitCondition.notify_all();
+            }
         }
     }
 }
@@ -372,55 +444,113 @@ void H5Transport::statusHandler(sd_rpc_app_status_t code, const char * error)
 
 void H5Transport::dataHandler(uint8_t *data, size_t length)
 {
-    std::vector<uint8_t> packet;
+    // SLIP decode the received data directly into rxPacket. The packet is kept between callbacks
+    // until the SLIP_END that terminates it is received.
+    size_t i = 0;
 
-    // Check if we have any data from before that has not been processed.
-    // If so add the remaining data from previous callback(s) to this packet
-    if (!unprocessedData.empty())
+    while (i < length)
     {
-        packet.insert(packet.begin(), unprocessedData.begin(), unprocessedData.end());
-    }
+        if (slipState == SLIP_STATE_DECODING)
+        {
+            // Copy data that does not need unescaping in one go. Stop at the end of the header so that it
+            // is validated before the rest of the packet is received, and one byte past the stated length
+            // so that too long packets are detected.
+            auto limit = (rxPacketLength == 0 ? H5_HEADER_LENGTH : rxPacketLength + 1) - rxPacket.size();
+            auto run = slip_unescaped_length(data + i, std::min(length - i, limit));
 
-    for (size_t i = 0; i < length; i++)
-    {
-        packet.push_back(data[i]);
+            if (run > 0)
+            {
+                rxPacket.insert(rxPacket.end(), data + i, data + i + run);
+                i += run;
+                validateRxPacketLength();
+                continue;
+            }
+        }
+
+        auto byte = data[i++];
 
-        if (data[i] == 0xC0)
+        if (byte == SLIP_END)
         {
-            if (c0Found)
+            if (slipState == SLIP_STATE_DECODING && !rxPacket.empty())
             {
                 // End of packet found
+                if (latencyStatistics != nullptr)
+                {
+                    latencyStatistics->recordSince(SD_RPC_LATENCY_FRAME_COMPLETE, rxPacketStartTime);
+                }
 
-                // If we have two 0xC0 after another we assume it is the beginning of a new packet, and not the end
-                if (packet.size() == 2)
+                processPacket(rxPacket.data(), rxPacket.size());
+                slipState = SLIP_STATE_HUNTING;
+            }
+            else
+            {
+                if (slipState == SLIP_STATE_ESCAPED)
                 {
-                    packet.clear();
-                    packet.push_back(0xc0);
-                    continue;
+                    errorPacketCount++;
                 }
 
-                processPacket(packet);
+                // Start of packet found. If we have two 0xC0 after another we assume it is the
+                // beginning of a new packet, and not the end.
+                slipState = SLIP_STATE_DECODING;
+                rxPacketStartTime = getReadTime();
+            }
+
+            rxPacket.clear();
+            rxPacketLength = 0;
+            continue;
+        }
+
+        if (slipState == SLIP_STATE_HUNTING)
+        {
+            // Data before the start of packet is irrelevant
+            continue;
+        }
 
-                packet.clear();
-                unprocessedData.clear();
-                c0Found = false;
+        if (slipState == SLIP_STATE_ESCAPED)
+        {
+            if (byte == SLIP_ESC_END)
+            {
+                byte = SLIP_END;
+            }
+            else if (byte == SLIP_ESC_ESC)
+            {
+                byte = SLIP_ESC;
             }
             else
             {
-                // Start of packet found
-                c0Found = true;
-
-                // Clear previous data from packet since data before the start of packet is irrelevant.
-                packet.clear();
-                packet.push_back(0xC0);
+                errorPacketCount++;
+                slipState = SLIP_STATE_HUNTING;
+                continue;
             }
+
+            slipState = SLIP_STATE_DECODING;
         }
+        else if (byte == SLIP_ESC)
+        {
+            slipState = SLIP_STATE_ESCAPED;
+            continue;
+        }
+
+        rxPacket.push_back(byte);
+        validateRxPacketLength();
     }
+}
 
-    if (!packet.empty())
+void H5Transport::validateRxPacketLength()
+{
+    // Validate the header as soon as it is received, and drop packets that are longer than stated in the header
+    if (rxPacketLength == 0 && rxPacket.size() == H5_HEADER_LENGTH)
+    {
+        if (h5_decode_header(rxPacket.data(), &rxPacketLength) != NRF_SUCCESS)
+        {
+            errorPacketCount++;
+            slipState = SLIP_STATE_HUNTING;
+        }
+    }
+    else if (rxPacketLength != 0 && rxPacket.size() > rxPacketLength)
     {
-        unprocessedData.clear();
-        unprocessedData.insert(unprocessedData.begin(), packet.begin(), packet.end());
+        errorPacketCount++;
+        slipState = SLIP_STATE_HUNTING;
     }
 }
 
@@ -436,14 +566,55 @@ void H5Transport::incrementAckNum()
     ackNum = ackNum & 0x07;
 }
 
+bool H5Transport::processAcknowledgement(uint8_t ack_num)
+{
+    std::vector<send_cb_t> acknowledgedPackets;
+    std::unique_lock<std::mutex> ackGuard(ackMutex);
+
+    // Nothing is outstanding, the acknowledgement is a reply to a previous packet
+    if (outstandingPackets.empty())
+    {
+        return true;
+    }
+
+    // ack_num is the next sequence number the target expects, acknowledging all packets before it
+    auto oldestSeqNum = outstandingPackets.front().seqNum;
+    size_t acknowledgedCount = (ack_num - oldestSeqNum) & 0x07;
+
+    if (acknowledgedCount > outstandingPackets.size())
+    {
+        return false;
+    }
+
+    // An acknowledgement count of zero is a reply to a previous packet, discard it
+    if (acknowledgedCount == 0)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < acknowledgedCount; i++)
+    {
+        acknowledgedPackets.push_back(std::move(outstandingPackets.front().completionCallback));
+        outstandingPackets.pop_front();
+    }
+
+    // Inform threads that wait that the window has room
+    ackWaitCondition.notify_all();
+    ackGuard.unlock();
+
+    completePackets(acknowledgedPackets, NRF_SUCCESS);
+
+    return true;
+}
+
 #pragma endregion Processing of incoming packets from UART
 
 #pragma region  State machine
 void H5Transport::setupStateMachine()
 {
     stateActions[STATE_START] = [&]() -> h5_state_t {
+        // Reset by startStateMachine, open may have set the criteria before this thread runs
         auto exit = dynamic_cast<StartExitCriterias*>(exitCriterias[STATE_START]);
-        exit->reset();
 
         std::unique_lock<std::mutex> syncGuard(syncMutex);
 
@@ -523,6 +694,15 @@ void H5Transport::setupStateMachine()
         uint8_t syncRetransmission = PACKET_RETRANSMISSIONS;
         std::unique_lock<std::mutex> syncGuard(syncMutex);
 
+        {
+            // Reset before entering STATE_ACTIVE since packets may be sent as soon as the state is entered.
+            // Stop-and-wait until target has replied with its window size.
+            std::lock_guard<std::mutex> ackGuard(ackMutex);
+            seqNum = 0;
+            ackNum = 0;
+            transmitWindowSize = 1;
+        }
+
         // Send a package immediately
         sendControlPacket(CONTROL_PKT_SYNC_CONFIG);
         exit->syncConfigSent = true;
@@ -541,6 +721,9 @@ void H5Transport::setupStateMachine()
         if (exit->syncConfigSent && exit->syncConfigRspReceived
             && exit->syncConfigReceived && exit->syncConfigRspSent)
         {
+            // Opened before the state is entered, since packets may be sent as soon as it is
+            std::lock_guard<std::mutex> ackGuard(ackMutex);
+            transmitWindowOpen = true;
             return STATE_ACTIVE;
         }
         else
@@ -551,9 +734,6 @@ void H5Transport::setupStateMachine()
 
     stateActions[STATE_ACTIVE] = [&]() -> h5_state_t
     {
-        seqNum = 0;
-        ackNum = 0;
-
         std::unique_lock<std::mutex> syncGuard(syncMutex);
         auto exit = dynamic_cast<ActiveExitCriterias*>(exitCriterias[STATE_ACTIVE]);
         exit->reset();
@@ -562,9 +742,20 @@ void H5Transport::setupStateMachine()
 
         while (!exit->isFullfilled())
         {
-            syncWaitCondition.wait(syncGuard);
+            syncWaitCondition.wait_until(syncGuard, checkRetransmissionTimer());
         }
 
+        std::vector<send_cb_t> failedPackets;
+
+        {
+            // Packets in the window will not be acknowledged after leaving this state
+            std::lock_guard<std::mutex> ackGuard(ackMutex);
+            transmitWindowOpen = false;
+            failOutstandingPackets(failedPackets);
+        }
+
+        completePackets(failedPackets, NRF_ERROR_INVALID_STATE);
+
         if (exit->syncReceived || exit->irrecoverableSyncError)
         {
             return STATE_RESET;
@@ -601,6 +792,7 @@ void H5Transport::startStateMachine()
 {
     runStateMachine = true;
     currentState = STATE_START;
+    exitCriterias[STATE_START]->reset();
 
     if (stateMachineThread == nullptr)
     {
@@ -687,6 +879,12 @@ void H5Transport::sendControlPacket(control_pkt_type type)
     }
 
     auto payload = pkt_pattern[type];
+
+    if (type == CONTROL_PKT_SYNC_CONFIG || type == CONTROL_PKT_SYNC_CONFIG_RESPONSE)
+    {
+        payload[2] = syncConfigToSend();
+    }
+
     std::vector<uint8_t> h5Packet;
 
     h5_encode(payload,
@@ -700,11 +898,89 @@ void H5Transport::sendControlPacket(control_pkt_type type)
     std::vector<uint8_t> slipPacket;
     slip_encode(h5Packet, slipPacket);
 
-    logPacket(true, h5Packet);
+    logPacket(true, h5Packet.data(), h5Packet.size());
 
     nextTransportLayer->send(slipPacket);
 }
 
+uint8_t H5Transport::syncConfigToSend() const
+{
+    return (syncConfigField & ~syncConfigWindowSizeMask) | maxTransmitWindowSize;
+}
+
+// Retransmits the window if the oldest packet has timed out. Returns the time the timer is to be checked again.
+std::chrono::steady_clock::time_point H5Transport::checkRetransmissionTimer()
+{
+    std::vector<send_cb_t> failedPackets;
+    std::unique_lock<std::mutex> ackGuard(ackMutex);
+
+    // Since the target discards packets received out of order, the whole window is
+    // retransmitted when the oldest packet times out.
+    if (!outstandingPackets.empty() && std::chrono::steady_clock::now() >= outstandingPackets.front().retransmitAt)
+    {
+        retransmitOutstandingPackets(failedPackets);
+    }
+
+    auto nextCheck = outstandingPackets.empty()
+        ? std::chrono::steady_clock::now() + retransmissionInterval
+        : outstandingPackets.front().retransmitAt;
+
+    ackGuard.unlock();
+
+    completePackets(failedPackets, NRF_ERROR_TIMEOUT);
+
+    return nextCheck;
+}
+
+// Must be called with ackMutex held
+void H5Transport::retransmitOutstandingPackets(std::vector<send_cb_t> &failedPackets)
+{
+    auto &oldestPacket = outstandingPackets.front();
+
+    if (oldestPacket.remainingRetransmissions == 0)
+    {
+        // Reuse the sequence number of the oldest packet, target has not accepted it or any of the following
+        seqNum = oldestPacket.seqNum;
+        failOutstandingPackets(failedPackets);
+        return;
+    }
+
+    oldestPacket.remainingRetransmissions--;
+
+    auto retransmitAt = std::chrono::steady_clock::now() + retransmissionInterval;
+
+    for (auto &packet : outstandingPackets)
+    {
+        logPacket(true, packet.h5Packet.data(), packet.h5Packet.size());
+        nextTransportLayer->send(packet.slipPacket);
+        packet.retransmitAt = retransmitAt;
+    }
+}
+
+// Must be called with ackMutex held
+void H5Transport::failOutstandingPackets(std::vector<send_cb_t> &failedPackets)
+{
+    for (auto &packet : outstandingPackets)
+    {
+        failedPackets.push_back(std::move(packet.completionCallback));
+    }
+
+    outstandingPackets.clear();
+    ackWaitCondition.notify_all();
+}
+
+// Must be called without ackMutex held, the callbacks may send new packets
+void H5Transport::completePackets(std::vector<send_cb_t> &completionCallbacks, uint32_t error_code)
+{
+    for (auto &callback : completionCallbacks)
+    {
+        if (callback != nullptr)
+        {
+            callback(error_code);
+        }
+    }
+}
+
 #pragma endregion Methods related to sending packet types defined in the Three Wire Standard
 
 #pragma region Debugging
@@ -718,11 +994,11 @@ std::string H5Transport::pktTypeToString(h5_pkt_type_t pktType)
     return pktTypeString[pktType];
 }
 
-std::string H5Transport::asHex(std::vector<uint8_t> &packet) const
+std::string H5Transport::asHex(uint8_t *packet, size_t length) const
 {
     std::stringstream hex;
 
-    for_each(packet.begin(), packet.end(), [&](uint8_t byte){
+    std::for_each(packet, packet + length, [&](uint8_t byte){
         hex << std::setfill('0') << std::setw(2) << std::hex << +byte << " ";
     });
 
@@ -769,29 +1045,35 @@ std::string H5Transport::hciPacketLinkControlToString(std::vector<uint8_t> paylo
     return retval.str();
 }
 
-std::string H5Transport::h5PktToString(bool out, std::vector<uint8_t> &h5Packet) const
+std::string H5Transport::h5PktToString(bool out, uint8_t *h5Packet, size_t length) const
 {
-    std::vector<uint8_t> payload;
+    uint8_t *payload = nullptr;
 
     uint8_t seq_num;
     uint8_t ack_num;
     bool reliable_packet;
     h5_pkt_type_t packet_type;
     bool data_integrity;
-    uint16_t payload_length;
+    uint16_t payload_length = 0;
     uint8_t header_checksum;
 
     auto err_code = h5_decode(
-        h5Packet, 
-        payload,
+        h5Packet,
+        length,
+        &payload,
+        &payload_length,
         &seq_num,
         &ack_num,
         &data_integrity,
-        &payload_length,
         &header_checksum,
         &reliable_packet,
         &packet_type);
 
+    if (err_code != NRF_SUCCESS)
+    {
+        payload_length = 0;
+    }
+
     std::stringstream count;
 
     if (out)
@@ -806,7 +1088,7 @@ std::string H5Transport::h5PktToString(bool out, std::vector<uint8_t> &h5Packet)
     std::stringstream retval;
     retval
         << count.str()
-        << " [" << asHex(payload) << "]" << std::endl
+        << " [" << asHex(payload, payload_length) << "]" << std::endl
         << std::setw(20) << "type:" << std::setw(20) << pktTypeToString(packet_type)
         << " reliable:" << std::setw(3) << (reliable_packet ? "yes" : "no")
         << " seq#:" << std::hex << +seq_num << " ack#:" << std::hex << +ack_num
@@ -822,13 +1104,13 @@ std::string H5Transport::h5PktToString(bool out, std::vector<uint8_t> &h5Packet)
 
     if (packet_type == LINK_CONTROL_PACKET)
     {
-        retval << std::endl << std::setw(15) << "" << hciPacketLinkControlToString(payload);
+        retval << std::endl << std::setw(15) << "" << hciPacketLinkControlToString(std::vector<uint8_t>(payload, payload + payload_length));
     }
 
     return retval.str();
 }
 
-void H5Transport::logPacket(bool outgoing, std::vector<uint8_t> &packet)
+void H5Transport::logPacket(bool outgoing, uint8_t *packet, size_t length)
 {
     if (outgoing)
     {
@@ -839,7 +1121,13 @@ void H5Transport::logPacket(bool outgoing, std::vector<uint8_t> &packet)
         incomingPacketCount++;
     }
 
-    std::string logLine = h5PktToString(outgoing, packet).c_str();
+    // Decoding the packet for the log is expensive, only do it if the message is logged
+    if (!isLogEnabled(SD_RPC_LOG_DEBUG))
+    {
+        return;
+    }
+
+    std::string logLine = h5PktToString(outgoing, packet, length).c_str();
 
     if (this->logCallback != nullptr)
     {
@@ -853,6 +1141,11 @@ void H5Transport::logPacket(bool outgoing, std::vector<uint8_t> &packet)
 
 void H5Transport::log(std::string &logLine) const
 {
+    if (!isLogEnabled(SD_RPC_LOG_DEBUG))
+    {
+        return;
+    }
+
     if (this->logCallback != nullptr)
     {
         this->logCallback(SD_RPC_LOG_DEBUG, logLine);
@@ -865,12 +1158,22 @@ void H5Transport::log(std::string &logLine) const
 
 void H5Transport::log(char const *logLine) const
 {
+    if (!isLogEnabled(SD_RPC_LOG_DEBUG))
+    {
+        return;
+    }
+
     auto _logLine = std::string(logLine);
     log(_logLine);
 }
 
 void H5Transport::logStateTransition(h5_state_t from, h5_state_t to) const
 {
+    if (!isLogEnabled(SD_RPC_LOG_DEBUG))
+    {
+        return;
+    }
+
     std::stringstream logLine;
     logLine << "State change: " << stateToString(from) << " -> " << stateToString(to) << std::endl;
 
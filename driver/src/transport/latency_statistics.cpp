@@ -0,0 +1,242 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "latency_statistics.h"
+
+#include "nrf_error.h"
+
+#include <chrono>
+#include <limits>
+
+#include <stdint.h>
+
+namespace {
+
+uint32_t highestBit(uint64_t value)
+{
+    uint32_t bit = 0;
+
+    for (uint32_t shift = 32; shift > 0; shift >>= 1)
+    {
+        if ((value >> shift) != 0)
+        {
+            value >>= shift;
+            bit += shift;
+        }
+    }
+
+    return bit;
+}
+
+}
+
+LatencyHistogram::LatencyHistogram() :
+    min(std::numeric_limits<uint64_t>::max()),
+    max(0)
+{
+    for (auto &bucket : buckets)
+    {
+        bucket = 0;
+    }
+}
+
+void LatencyHistogram::record(uint64_t latency)
+{
+    buckets[bucketIndex(latency)].fetch_add(1, std::memory_order_relaxed);
+
+    auto currentMin = min.load(std::memory_order_relaxed);
+
+    while (latency < currentMin && !min.compare_exchange_weak(currentMin, latency, std::memory_order_relaxed))
+    {
+    }
+
+    auto currentMax = max.load(std::memory_order_relaxed);
+
+    while (latency > currentMax && !max.compare_exchange_weak(currentMax, latency, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::getSummary(sd_rpc_latency_t *latency) const
+{
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    uint64_t count = 0;
+
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        count += counts[i];
+    }
+
+    *latency = sd_rpc_latency_t();
+    latency->count = count;
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    latency->min = min.load(std::memory_order_relaxed);
+    latency->max = max.load(std::memory_order_relaxed);
+
+    // Ranks of the percentiles, rounded up so that the percentile covers at least that share of the values
+    const uint64_t ranks[] = { (count * 500 + 999) / 1000, (count * 990 + 999) / 1000, (count * 999 + 999) / 1000 };
+    uint64_t *percentiles[] = { &latency->p50, &latency->p99, &latency->p999 };
+
+    uint64_t seen = 0;
+    uint32_t percentile = 0;
+
+    for (uint32_t i = 0; i < BUCKET_COUNT && percentile < 3; i++)
+    {
+        seen += counts[i];
+
+        while (percentile < 3 && seen >= ranks[percentile])
+        {
+            auto upperBound = bucketUpperBound(i);
+            *percentiles[percentile] = upperBound < latency->max ? upperBound : latency->max;
+            percentile++;
+        }
+    }
+
+    // Values recorded while the buckets were read may not be part of the count
+    for (; percentile < 3; percentile++)
+    {
+        *percentiles[percentile] = latency->max;
+    }
+}
+
+// Values below SUB_BUCKET_COUNT have a bucket each, larger values share SUB_BUCKET_COUNT buckets per power of two
+uint32_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    if ((value >> MAX_MAGNITUDE) != 0)
+    {
+        value = (static_cast<uint64_t>(1) << MAX_MAGNITUDE) - 1;
+    }
+
+    auto magnitude = highestBit(value);
+    auto subBucket = static_cast<uint32_t>(value >> (magnitude - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+
+    return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    auto magnitude = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    uint64_t subBucket = index % SUB_BUCKET_COUNT;
+    auto shift = magnitude - SUB_BUCKET_BITS;
+
+    return ((SUB_BUCKET_COUNT + subBucket + 1) << shift) - 1;
+}
+
+LatencyStatistics::LatencyStatistics()
+{
+    for (auto &command : commands)
+    {
+        command = nullptr;
+    }
+}
+
+LatencyStatistics::~LatencyStatistics()
+{
+    for (auto &command : commands)
+    {
+        delete command.load();
+    }
+}
+
+uint64_t LatencyStatistics::now()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+void LatencyStatistics::record(sd_rpc_latency_stage_t stage, uint64_t latency)
+{
+    if (stage < 0 || stage >= SD_RPC_LATENCY_STAGE_COUNT)
+    {
+        return;
+    }
+
+    stages[stage].record(latency);
+}
+
+void LatencyStatistics::recordSince(sd_rpc_latency_stage_t stage, uint64_t startTime)
+{
+    auto endTime = now();
+    record(stage, endTime > startTime ? endTime - startTime : 0);
+}
+
+void LatencyStatistics::recordCommand(uint8_t opCode, uint64_t latency)
+{
+    auto histogram = commands[opCode].load();
+
+    if (histogram == nullptr)
+    {
+        auto created = new LatencyHistogram();
+
+        if (commands[opCode].compare_exchange_strong(histogram, created))
+        {
+            histogram = created;
+        }
+        else
+        {
+            // Another thread created the histogram first, histogram now points to it
+            delete created;
+        }
+    }
+
+    histogram->record(latency);
+}
+
+uint32_t LatencyStatistics::getLatency(sd_rpc_latency_stage_t stage, sd_rpc_latency_t *latency) const
+{
+    if (latency == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (stage < 0 || stage >= SD_RPC_LATENCY_STAGE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    stages[stage].getSummary(latency);
+    return NRF_SUCCESS;
+}
+
+uint32_t LatencyStatistics::getCommandLatency(uint8_t opCode, sd_rpc_latency_t *latency) const
+{
+    if (latency == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    auto histogram = commands[opCode].load();
+
+    if (histogram == nullptr)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    histogram->getSummary(latency);
+    return NRF_SUCCESS;
+}
@@ -18,24 +18,37 @@
 
 #include "ble_common.h"
 
+#include "event_pool.h"
+
+#include <algorithm>
 #include <memory>
 #include <iostream>
 #include <sstream>
 #include <cstring> // Do not remove! Required by gcc.
 
+// Largest decoded event supported, including an unknown quantity of padding
+const uint32_t MAX_DECODED_EVENT_LENGTH = 512;
+
 SerializationTransport::SerializationTransport(Transport *dataLinkLayer, uint32_t response_timeout)
     : statusCallback(nullptr), eventCallback(nullptr),
-    logCallback(nullptr), rspReceived(false),
-    responseBuffer(nullptr), responseLength(nullptr),
-    runEventThread(false)
+    logCallback(nullptr), logSeverityFilter(SD_RPC_LOG_INFO), nextCommandId(0),
+    runEventThread(false), eventSlots(EVENT_QUEUE_SLOTS), eventHead(0), eventTail(0),
+    eventOverflowActive(false), eventThreadWaiting(false),
+    eventQueueHighWatermark(0), eventOverflowCount(0),
+    eventDecodeBuffer(MAX_DECODED_EVENT_LENGTH / sizeof(uint64_t)),
+    currentEvent(nullptr), currentEventReadTime(0), currentEventRetained(false)
 {
     eventThread = nullptr;
     nextTransportLayer = dataLinkLayer;
     responseTimeout = response_timeout;
+
+    nextTransportLayer->setLatencyStatistics(&latencyStatistics);
 }
 
 
-SerializationTransport::SerializationTransport(): nextTransportLayer(nullptr), responseTimeout(0), rspReceived(false), responseBuffer(nullptr), responseLength(nullptr), runEventThread(false), eventThread(nullptr)
+SerializationTransport::SerializationTransport(): logSeverityFilter(SD_RPC_LOG_INFO), nextTransportLayer(nullptr), responseTimeout(0), nextCommandId(0), runEventThread(false), eventThread(nullptr),
+    eventHead(0), eventTail(0), eventOverflowActive(false), eventThreadWaiting(false), eventQueueHighWatermark(0), eventOverflowCount(0),
+    currentEvent(nullptr), currentEventReadTime(0), currentEventRetained(false)
 {}
 
 SerializationTransport::~SerializationTransport()
@@ -51,6 +64,18 @@ uint32_t SerializationTransport::open(status_cb_t status_callback, evt_cb_t even
 
     data_cb_t dataCallback = std::bind(&SerializationTransport::readHandler, this, std::placeholders::_1, std::placeholders::_2);
 
+    if (eventThread == nullptr)
+    {
+        // Events left from a previous session are discarded before the read thread is started
+        std::lock_guard<std::mutex> eventLock(eventMutex);
+        eventHead = 0;
+        eventTail = 0;
+        eventOverflow.clear();
+        eventOverflowActive = false;
+        eventQueueHighWatermark = 0;
+        eventOverflowCount = 0;
+    }
+
     uint32_t errorCode = nextTransportLayer->open(status_callback, dataCallback, log_callback);
 
     if (errorCode != NRF_SUCCESS)
@@ -89,95 +114,462 @@ uint32_t SerializationTransport::close()
         eventThread = nullptr;
     }
 
-    return nextTransportLayer->close();
+    auto errCode = nextTransportLayer->close();
+
+    // No responses will be received after the link is closed
+    failPendingCommands(NRF_ERROR_INTERNAL);
+
+    return errCode;
 }
 
 uint32_t SerializationTransport::send(uint8_t *cmdBuffer, uint32_t cmdLength, uint8_t *rspBuffer, uint32_t *rspLength)
 {
-    // Mutex to avoid multiple threads sending commands at the same time.
-    std::unique_lock<std::mutex> sendGuard(sendMutex);
-    rspReceived = false;
-    responseBuffer = rspBuffer;
-    responseLength = rspLength;
+    std::vector<uint8_t> commandPacket(SERIALIZATION_PKT_TYPE_LENGTH + cmdLength);
+    memcpy(&commandPacket[SERIALIZATION_PKT_TYPE_LENGTH], cmdBuffer, cmdLength * sizeof(uint8_t));
 
-    std::vector<uint8_t> commandBuffer(cmdLength + 1);
-    commandBuffer[0] = SERIALIZATION_COMMAND;
-    memcpy(&commandBuffer[1], cmdBuffer, cmdLength * sizeof(uint8_t));
+    return send(commandPacket, rspBuffer, rspLength);
+}
 
-    auto errCode = nextTransportLayer->send(commandBuffer);
+uint32_t SerializationTransport::send(std::vector<uint8_t> &cmdPacket, uint8_t *rspBuffer, uint32_t *rspLength)
+{
+    std::mutex completionMutex;
+    std::condition_variable completionCondition;
+    auto completed = false;
+    uint32_t result = NRF_SUCCESS;
+
+    auto errCode = sendAsync(cmdPacket, rspBuffer, rspLength, [&](uint32_t error_code)
+    {
+        std::lock_guard<std::mutex> completionGuard(completionMutex);
+        result = error_code;
+        completed = true;
+        completionCondition.notify_one();
+    });
 
-    if (errCode != NRF_SUCCESS) {
+    if (errCode != NRF_SUCCESS)
+    {
         return errCode;
     }
-    else if (rspBuffer == nullptr)
+
+    std::unique_lock<std::mutex> completionGuard(completionMutex);
+
+    if (!completed)
     {
-        return NRF_SUCCESS;
+        std::chrono::milliseconds timeout(responseTimeout);
+        auto wakeupTime = std::chrono::steady_clock::now() + timeout;
+
+        if (!completionCondition.wait_until(completionGuard, wakeupTime, [&] { return completed; }))
+        {
+            // Do not depend on the event thread to time out commands sent by a blocking caller
+            completionGuard.unlock();
+            expirePendingCommands();
+            completionGuard.lock();
+            completionCondition.wait(completionGuard, [&] { return completed; });
+        }
     }
 
-    std::unique_lock<std::mutex> responseGuard(responseMutex);
+    return result;
+}
+
+uint32_t SerializationTransport::sendAsync(uint8_t *cmdBuffer, uint32_t cmdLength, uint8_t *rspBuffer, uint32_t *rspLength, rsp_cb_t response_callback)
+{
+    std::vector<uint8_t> commandPacket(SERIALIZATION_PKT_TYPE_LENGTH + cmdLength);
+    memcpy(&commandPacket[SERIALIZATION_PKT_TYPE_LENGTH], cmdBuffer, cmdLength * sizeof(uint8_t));
 
-    if (!rspReceived)
+    return sendAsync(commandPacket, rspBuffer, rspLength, response_callback);
+}
+
+uint32_t SerializationTransport::sendAsync(std::vector<uint8_t> &cmdPacket, uint8_t *rspBuffer, uint32_t *rspLength, rsp_cb_t response_callback)
+{
+    if (cmdPacket.size() <= SERIALIZATION_PKT_TYPE_LENGTH)
     {
-        std::chrono::milliseconds timeout(responseTimeout);
-        std::chrono::system_clock::time_point wakeupTime = std::chrono::system_clock::now() + timeout;
-        std::cv_status status = responseWaitCondition.wait_until(responseGuard, wakeupTime);
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    cmdPacket[0] = SERIALIZATION_COMMAND;
+
+    // Mutex to keep the order of pendingCommands equal to the order commands are queued in the data link layer.
+    // It is only held until the command is queued, not until target has received it or the response is received.
+    std::unique_lock<std::mutex> sendGuard(sendMutex);
 
-        if (status == std::cv_status::timeout)
+    uint32_t commandId = 0;
+
+    if (rspBuffer != nullptr)
+    {
+        // The command must be registered before it is sent since the response may arrive before send returns
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+        commandId = nextCommandId++;
+
+        PendingCommand command;
+        command.id = commandId;
+        command.opCode = cmdPacket[SERIALIZATION_PKT_TYPE_LENGTH];
+        command.responseBuffer = rspBuffer;
+        command.responseLength = rspLength;
+        command.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(responseTimeout);
+        command.responseCallback = response_callback;
+        pendingCommands.push_back(command);
+    }
+
+    send_cb_t deliveryCallback;
+
+    if (rspBuffer == nullptr)
+    {
+        deliveryCallback = response_callback;
+    }
+    else
+    {
+        deliveryCallback = std::bind(&SerializationTransport::onCommandDelivered, this, commandId, std::placeholders::_1);
+    }
+
+    auto errCode = nextTransportLayer->sendAsync(cmdPacket, deliveryCallback);
+
+    if (errCode != NRF_SUCCESS && rspBuffer != nullptr)
+    {
+        // The command was not queued and its delivery callback is not called
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+
+        for (auto command = pendingCommands.begin(); command != pendingCommands.end(); ++command)
+        {
+            if (command->id == commandId)
+            {
+                pendingCommands.erase(command);
+                break;
+            }
+        }
+    }
+
+    return errCode;
+}
+
+// Called by the data link layer when a command is received by target, or could not be delivered
+void SerializationTransport::onCommandDelivered(uint32_t commandId, uint32_t error_code)
+{
+    rsp_cb_t failedCallback;
+
+    {
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+
+        for (auto command = pendingCommands.begin(); command != pendingCommands.end(); ++command)
+        {
+            if (command->id != commandId)
+            {
+                continue;
+            }
+
+            if (error_code != NRF_SUCCESS)
+            {
+                failedCallback = command->responseCallback;
+                pendingCommands.erase(command);
+                break;
+            }
+
+            // Response timeout starts when the command is delivered to target, as it did before commands were pipelined.
+            // Commands are delivered in the order they are queued, so deadlines stay in the same order as pendingCommands.
+            command->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(responseTimeout);
+            break;
+        }
+    }
+
+    // If the command is not found the response is already received and its callback is called
+    if (failedCallback != nullptr)
+    {
+        failedCallback(error_code);
+    }
+}
+
+std::chrono::steady_clock::time_point SerializationTransport::nextResponseDeadline()
+{
+    std::lock_guard<std::mutex> responseGuard(responseMutex);
+
+    // All commands have the same timeout, the oldest command is the first to expire
+    if (!pendingCommands.empty())
+    {
+        return pendingCommands.front().deadline;
+    }
+
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(responseTimeout);
+}
+
+void SerializationTransport::expirePendingCommands()
+{
+    std::vector<rsp_cb_t> expiredCallbacks;
+
+    {
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+        auto now = std::chrono::steady_clock::now();
+
+        while (!pendingCommands.empty() && pendingCommands.front().deadline <= now)
+        {
+            expiredCallbacks.push_back(pendingCommands.front().responseCallback);
+            pendingCommands.pop_front();
+        }
+    }
+
+    for (auto &callback : expiredCallbacks)
+    {
+        if (isLogEnabled(SD_RPC_LOG_WARNING))
         {
             logCallback(SD_RPC_LOG_WARNING, "Failed to receive response for command");
-            return NRF_ERROR_INTERNAL;
+        }
+
+        if (callback != nullptr)
+        {
+            callback(NRF_ERROR_INTERNAL);
         }
     }
+}
 
-    return NRF_SUCCESS;
+void SerializationTransport::failPendingCommands(uint32_t error_code)
+{
+    std::deque<PendingCommand> failedCommands;
+
+    {
+        std::lock_guard<std::mutex> responseGuard(responseMutex);
+        failedCommands.swap(pendingCommands);
+    }
+
+    for (auto &command : failedCommands)
+    {
+        if (command.responseCallback != nullptr)
+        {
+            command.responseCallback(error_code);
+        }
+    }
+}
+
+void SerializationTransport::getEventQueueStatistics(uint32_t *high_watermark, uint32_t *overflow_count) const
+{
+    *high_watermark = eventQueueHighWatermark;
+    *overflow_count = eventOverflowCount;
 }
 
 // Event Thread
 void SerializationTransport::eventHandlingRunner()
 {
-    while (runEventThread) {
+    while (runEventThread)
+    {
+        auto head = eventHead.load(std::memory_order_relaxed);
 
-        while (!eventQueue.empty())
+        if (head != eventTail.load(std::memory_order_acquire))
         {
-            eventData_t eventData = eventQueue.front();
-            eventQueue.pop();
-            // Allocate memory to store decoded event including an unknown quantity of padding
+            auto &slot = eventSlots[head % EVENT_QUEUE_SLOTS];
+            processEvent(slot.data, slot.dataLength, slot.readTime);
 
-            // Set security context
-            BLESecurityContext context(this);
+            // Hand the slot back to the read thread
+            eventHead.store(head + 1, std::memory_order_release);
+            continue;
+        }
 
-            uint32_t possibleEventLength = 512;
-            std::unique_ptr<ble_evt_t> event(static_cast<ble_evt_t*>(std::malloc(possibleEventLength)));
-            uint32_t errCode = ble_event_dec(eventData.data, eventData.dataLength, event.get(), &possibleEventLength);
+        // The ring is empty, continue with events that did not fit in it
+        OverflowEvent overflowEvent;
+        auto overflowEventFound = false;
 
-            if (eventCallback != nullptr && errCode == NRF_SUCCESS)
-            {
-                eventCallback(event.get());
-            }
+        {
+            std::lock_guard<std::mutex> eventLock(eventMutex);
 
-            if (errCode != NRF_SUCCESS)
+            if (!eventOverflow.empty())
             {
-                std::stringstream logMessage;
-                logMessage << "Failed to decode event, error code is " << errCode << "." << std::endl;
-                logCallback(SD_RPC_LOG_ERROR, logMessage.str().c_str());
+                overflowEventFound = true;
+                overflowEvent.readTime = eventOverflow.front().readTime;
+                overflowEvent.data.swap(eventOverflow.front().data);
+                eventOverflow.pop_front();
+
+                if (eventOverflow.empty())
+                {
+                    eventOverflowActive = false;
+                }
             }
+        }
 
-            free(eventData.data);
+        if (overflowEventFound)
+        {
+            processEvent(overflowEvent.data.data(), static_cast<uint32_t>(overflowEvent.data.size()), overflowEvent.readTime);
+            continue;
         }
 
+        expirePendingCommands();
+        auto wakeupTime = nextResponseDeadline();
+
         std::unique_lock<std::mutex> eventLock(eventMutex);
+        eventThreadWaiting = true;
+        eventWaitCondition.wait_until(eventLock, wakeupTime, [&] { return !runEventThread || eventAvailable(); });
+        eventThreadWaiting = false;
+    }
+}
+
+bool SerializationTransport::eventAvailable() const
+{
+    return eventHead.load() != eventTail.load() || !eventOverflow.empty();
+}
+
+void SerializationTransport::processEvent(uint8_t *data, uint32_t length, uint64_t readTime)
+{
+    auto decodedEvent = reinterpret_cast<ble_evt_t *>(eventDecodeBuffer.data());
+    uint32_t eventLength = MAX_DECODED_EVENT_LENGTH;
+    uint32_t errCode;
 
-        if (!runEventThread)
+    {
+        // The connection context is released before the event callback, which may call the driver
+        BLEConnectionContext context(connectionTable);
+        errCode = ble_event_dec(data, length, decodedEvent, &eventLength);
+
+        if (errCode == NRF_SUCCESS)
         {
-            break;
+            connectionTable.update(decodedEvent);
         }
+    }
 
-        if (!eventQueue.empty())
+    if (errCode != NRF_SUCCESS)
+    {
+        if (isLogEnabled(SD_RPC_LOG_ERROR))
         {
-            continue;
+            std::stringstream logMessage;
+            logMessage << "Failed to decode event, error code is " << errCode << "." << std::endl;
+            logCallback(SD_RPC_LOG_ERROR, logMessage.str().c_str());
+        }
+        return;
+    }
+
+    latencyStatistics.recordSince(SD_RPC_LATENCY_EVENT_DECODED, readTime);
+
+    if (eventCallback == nullptr)
+    {
+        return;
+    }
+
+    // Decoders may have side effects, so instead of decoding twice the event is copied to a buffer of the decoded size.
+    // The buffer is never smaller than ble_evt_t so that the event structures can be copied as a whole.
+    auto event = static_cast<ble_evt_t *>(EventPool::allocate(std::max<size_t>(eventLength, sizeof(ble_evt_t))));
+
+    if (event == nullptr)
+    {
+        if (isLogEnabled(SD_RPC_LOG_ERROR))
+        {
+            logCallback(SD_RPC_LOG_ERROR, "Failed to allocate memory for event.");
         }
+        return;
+    }
+
+    memcpy(event, decodedEvent, eventLength);
 
-        eventWaitCondition.wait(eventLock);
+    if (event->header.evt_id == BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP)
+    {
+        // The value pointers refer to memory inside the event, move them to the copy
+        auto &readRsp = event->evt.gattc_evt.params.char_val_by_uuid_read_rsp;
+        auto offset = reinterpret_cast<uint8_t *>(event) - reinterpret_cast<uint8_t *>(decodedEvent);
+
+        for (auto i = 0; i < readRsp.count; i++)
+        {
+            readRsp.handle_value[i].p_value += offset;
+        }
+    }
+
+    currentEvent = event;
+    currentEventReadTime = readTime;
+    currentEventRetained = false;
+
+    eventCallback(event);
+
+    currentEvent = nullptr;
+
+    if (!currentEventRetained)
+    {
+        EventPool::release(event);
+    }
+}
+
+uint32_t SerializationTransport::retainEvent(ble_evt_t *event)
+{
+    if (event == nullptr || event != currentEvent)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    currentEventRetained = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t SerializationTransport::getEventReadTime(const ble_evt_t *event, uint64_t *read_time) const
+{
+    if (read_time == nullptr)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (event == nullptr || event != currentEvent)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    *read_time = currentEventReadTime;
+    return NRF_SUCCESS;
+}
+
+void SerializationTransport::setLogSeverityFilter(sd_rpc_log_severity_t severity_filter)
+{
+    logSeverityFilter = severity_filter;
+    nextTransportLayer->setLogSeverityFilter(severity_filter);
+}
+
+LatencyStatistics &SerializationTransport::getLatencyStatistics()
+{
+    return latencyStatistics;
+}
+
+app_ble_conn_table_t &SerializationTransport::getConnectionTable()
+{
+    return connectionTable;
+}
+
+bool SerializationTransport::isLogEnabled(sd_rpc_log_severity_t severity) const
+{
+    return severity >= logSeverityFilter;
+}
+
+// Read Thread
+void SerializationTransport::pushEvent(uint8_t *data, size_t length, uint64_t readTime)
+{
+    auto tail = eventTail.load(std::memory_order_relaxed);
+    auto queued = tail - eventHead.load(std::memory_order_acquire);
+
+    // Events must be handled in the order they are received, so once the ring has overflowed all events are
+    // buffered on the heap until the event thread has caught up.
+    if (!eventOverflowActive && queued < EVENT_QUEUE_SLOTS && length <= sizeof(EventSlot::data))
+    {
+        auto &slot = eventSlots[tail % EVENT_QUEUE_SLOTS];
+        memcpy(slot.data, data, length);
+        slot.dataLength = static_cast<uint32_t>(length);
+        slot.readTime = readTime;
+
+        eventTail.store(tail + 1);
+
+        if (queued >= eventQueueHighWatermark.load(std::memory_order_relaxed))
+        {
+            eventQueueHighWatermark.store(queued + 1, std::memory_order_relaxed);
+        }
+
+        if (eventThreadWaiting)
+        {
+            std::lock_guard<std::mutex> eventLock(eventMutex);
+            eventWaitCondition.notify_one();
+        }
+
+        return;
+    }
+
+    auto firstOverflow = false;
+
+    {
+        std::lock_guard<std::mutex> eventLock(eventMutex);
+        firstOverflow = eventOverflowCount == 0;
+        eventOverflowActive = true;
+        eventOverflow.push_back(OverflowEvent{ readTime, std::vector<uint8_t>(data, data + length) });
+        eventOverflowCount++;
+        eventWaitCondition.notify_one();
+    }
+
+    if (firstOverflow && isLogEnabled(SD_RPC_LOG_WARNING))
+    {
+        logCallback(SD_RPC_LOG_WARNING, "Event queue is full, events are buffered until the event handler catches up");
     }
 }
 
@@ -185,29 +577,49 @@ void SerializationTransport::eventHandlingRunner()
 void SerializationTransport::readHandler(uint8_t *data, size_t length)
 {
     auto eventType = static_cast<serialization_pkt_type_t>(data[0]);
-    data += 1;
-    length -= 1;
+    data += SERIALIZATION_PKT_TYPE_LENGTH;
+    length -= SERIALIZATION_PKT_TYPE_LENGTH;
 
     if (eventType == SERIALIZATION_RESPONSE) {
-        memcpy(responseBuffer, data, length);
-        *responseLength = length;
+        rsp_cb_t responseCallback;
 
-        std::lock_guard<std::mutex> responseGuard(responseMutex);
-        rspReceived = true;
-        responseWaitCondition.notify_one();
+        {
+            std::lock_guard<std::mutex> responseGuard(responseMutex);
+
+            // Target handles commands in order, match the response with the oldest command with the same op code
+            auto command = pendingCommands.begin();
+
+            while (command != pendingCommands.end() && (length == 0 || command->opCode != data[0]))
+            {
+                ++command;
+            }
+
+            if (command == pendingCommands.end())
+            {
+                if (isLogEnabled(SD_RPC_LOG_WARNING))
+                {
+                    logCallback(SD_RPC_LOG_WARNING, "Received response without a matching command");
+                }
+
+                return;
+            }
+
+            memcpy(command->responseBuffer, data, length);
+            *command->responseLength = static_cast<uint32_t>(length);
+            responseCallback = command->responseCallback;
+            pendingCommands.erase(command);
+        }
+
+        if (responseCallback != nullptr)
+        {
+            responseCallback(NRF_SUCCESS);
+        }
     }
     else if (eventType == SERIALIZATION_EVENT)
     {
-        eventData_t eventData;
-        eventData.data = static_cast<uint8_t *>(malloc(length));
-        memcpy(eventData.data, data, length);
-        eventData.dataLength = length;
-
-        std::lock_guard<std::mutex> eventLock(eventMutex);
-        eventQueue.push(eventData);
-        eventWaitCondition.notify_one();
+        pushEvent(data, length, nextTransportLayer->getReadTime());
     }
-    else
+    else if (isLogEnabled(SD_RPC_LOG_WARNING))
     {
         logCallback(SD_RPC_LOG_WARNING, "Unknown Nordic Semiconductor vendor specific packet received");
     }
@@ -13,66 +13,142 @@
 #include "slip.h"
 #include "nrf_error.h"
 #include <vector>
-#include <algorithm>
+#include <cstring>
 
-#define SLIP_END 0xC0
-#define SLIP_ESC 0xDB
-#define SLIP_ESC_END 0xDC
-#define SLIP_ESC_ESC 0xDD
+// SSE2 is part of every x86-64 target, scan 16 bytes at a time when it is available
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SLIP_SCAN_SSE2
+#endif
 
-void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet)
+size_t slip_unescaped_length(const uint8_t *data, size_t length)
 {
-    out_packet.push_back(SLIP_END);
+    size_t i = 0;
+
+#ifdef SLIP_SCAN_SSE2
+    const auto end = _mm_set1_epi8(static_cast<char>(SLIP_END));
+    const auto esc = _mm_set1_epi8(static_cast<char>(SLIP_ESC));
 
-    for (size_t i = 0; i < in_packet.size(); i++)
+    for (; i + 16 <= length; i += 16)
     {
-        if (in_packet[i] == SLIP_END)
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        auto found = _mm_or_si128(_mm_cmpeq_epi8(block, end), _mm_cmpeq_epi8(block, esc));
+
+        if (_mm_movemask_epi8(found) != 0)
         {
-            out_packet.push_back(SLIP_ESC);
-            out_packet.push_back(SLIP_ESC_END);
+            // Let the scalar loop find the exact position within this block
+            break;
         }
-        else if (in_packet[i] == SLIP_ESC)
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        if (data[i] == SLIP_END || data[i] == SLIP_ESC)
         {
-            out_packet.push_back(SLIP_ESC);
-            out_packet.push_back(SLIP_ESC_ESC);
+            return i;
         }
-        else
+    }
+
+    return length;
+}
+
+size_t slip_encode(const uint8_t *in_packet, size_t length, uint8_t *out_packet)
+{
+    auto out = out_packet;
+    *out++ = SLIP_END;
+
+    size_t i = 0;
+
+    while (i < length)
+    {
+        // Copy the bytes that do not need escaping in one go
+        auto run = slip_unescaped_length(in_packet + i, length - i);
+        memcpy(out, in_packet + i, run);
+        out += run;
+        i += run;
+
+        if (i < length)
         {
-            out_packet.push_back(in_packet[i]);
+            *out++ = SLIP_ESC;
+            *out++ = in_packet[i] == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
+            i++;
         }
     }
 
-    out_packet.push_back(SLIP_END);
+    *out++ = SLIP_END;
+
+    return out - out_packet;
 }
 
-uint32_t slip_decode(std::vector<uint8_t> &packet, std::vector<uint8_t> &out_packet)
+void slip_encode(std::vector<uint8_t> &in_packet, std::vector<uint8_t> &out_packet)
+{
+    auto offset = out_packet.size();
+    out_packet.resize(offset + slip_encoded_max_length(in_packet.size()));
+
+    auto length = slip_encode(in_packet.data(), in_packet.size(), out_packet.data() + offset);
+    out_packet.resize(offset + length);
+}
+
+uint32_t slip_decode(const uint8_t *packet, size_t length, uint8_t *out_packet, size_t *out_length)
 {
-    for (size_t i = 0; i < packet.size(); i++)
+    auto out = out_packet;
+    size_t i = 0;
+
+    while (i < length)
     {
+        auto run = slip_unescaped_length(packet + i, length - i);
+        memcpy(out, packet + i, run);
+        out += run;
+        i += run;
+
+        if (i == length)
+        {
+            break;
+        }
+
         if (packet[i] == SLIP_END)
         {
+            i++;
             continue;
         }
-        else if (packet[i] == SLIP_ESC) {
-            i++;
-            if (packet[i] == SLIP_ESC_END)
-            {
-                out_packet.push_back(SLIP_END);
-            }
-            else if (packet[i] == SLIP_ESC_ESC)
-            {
-                out_packet.push_back(SLIP_ESC);
-            }
-            else
-            {
-                return NRF_ERROR_INVALID_DATA;
-            }
+
+        // SLIP_ESC must be followed by one of the escape codes
+        if (i + 1 == length)
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+
+        if (packet[i + 1] == SLIP_ESC_END)
+        {
+            *out++ = SLIP_END;
+        }
+        else if (packet[i + 1] == SLIP_ESC_ESC)
+        {
+            *out++ = SLIP_ESC;
         }
         else
         {
-            out_packet.push_back(packet[i]);
+            return NRF_ERROR_INVALID_DATA;
         }
+
+        i += 2;
     }
 
+    *out_length = out - out_packet;
+
     return NRF_SUCCESS;
 }
+
+uint32_t slip_decode(std::vector<uint8_t> &packet, std::vector<uint8_t> &out_packet)
+{
+    auto offset = out_packet.size();
+    out_packet.resize(offset + packet.size());
+
+    size_t length = 0;
+    auto err_code = slip_decode(packet.data(), packet.size(), out_packet.data() + offset, &length);
+
+    out_packet.resize(offset + (err_code == NRF_SUCCESS ? length : 0));
+
+    return err_code;
+}
@@ -14,11 +14,15 @@
 
 #include "nrf_error.h"
 
+#include <chrono>
+
 #include <stdint.h>
 
 using namespace std;
 
-Transport::Transport()
+Transport::Transport() :
+    logSeverityFilter(SD_RPC_LOG_INFO),
+    latencyStatistics(nullptr)
 {
     /* Intentional empty */
 }
@@ -41,3 +45,41 @@ uint32_t Transport::close()
 {
     return NRF_SUCCESS;
 }
+
+uint32_t Transport::sendAsync(std::vector<uint8_t> &data, send_cb_t completion_callback)
+{
+    auto errorCode = send(data);
+
+    if (errorCode != NRF_SUCCESS)
+    {
+        return errorCode;
+    }
+
+    if (completion_callback != nullptr)
+    {
+        completion_callback(NRF_SUCCESS);
+    }
+
+    return NRF_SUCCESS;
+}
+
+void Transport::setLogSeverityFilter(sd_rpc_log_severity_t severity_filter)
+{
+    logSeverityFilter = severity_filter;
+}
+
+bool Transport::isLogEnabled(sd_rpc_log_severity_t severity) const
+{
+    return severity >= logSeverityFilter;
+}
+
+uint64_t Transport::getReadTime() const
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void Transport::setLatencyStatistics(LatencyStatistics *latency_statistics)
+{
+    latencyStatistics = latency_statistics;
+}
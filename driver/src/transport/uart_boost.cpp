@@ -17,6 +17,7 @@
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
 
+#include <chrono>
 #include <sstream>
 #include <mutex>
 
@@ -33,6 +34,7 @@ UartBoost::UartBoost(const UartCommunicationParameters &communicationParameters)
       callbackReadHandle(),
       callbackWriteHandle(),
       asyncWriteInProgress(false),
+      readTime(0),
       uartSettingsBoost(communicationParameters)
 {
 }
@@ -100,6 +102,11 @@ uint32_t UartBoost::open(status_cb_t status_callback, data_cb_t data_callback, l
 
     startRead();
 
+    if (!isLogEnabled(SD_RPC_LOG_INFO))
+    {
+        return NRF_SUCCESS;
+    }
+
     std::stringstream flow_control_string;
     std::stringstream parity_string;
 
@@ -149,10 +156,14 @@ uint32_t UartBoost::close()
 {
     try
     {
-        std::stringstream message;
         serialPort.close();
-        message << "UART port " << uartSettingsBoost.getPortName().c_str() << " closed.";
-        logCallback(SD_RPC_LOG_INFO, message.str());
+
+        if (isLogEnabled(SD_RPC_LOG_INFO))
+        {
+            std::stringstream message;
+            message << "UART port " << uartSettingsBoost.getPortName().c_str() << " closed.";
+            logCallback(SD_RPC_LOG_INFO, message.str());
+        }
     }
     catch (std::exception& ex)
     {
@@ -185,8 +196,17 @@ void UartBoost::readHandler(const boost::system::error_code& errorCode, const si
 {
     if (errorCode == boost::system::errc::success)
     {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        readTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+
         auto readBufferData = readBuffer.data();
         dataCallback(readBufferData, bytesTransferred);
+
+        if (latencyStatistics != nullptr)
+        {
+            latencyStatistics->recordSince(SD_RPC_LATENCY_UART_READ, readTime);
+        }
+
         asyncRead(); // Initiate a new read
     }
     else if (errorCode == boost::asio::error::operation_aborted)
@@ -226,6 +246,11 @@ void UartBoost::writeHandler (const boost::system::error_code& errorCode, const
     asyncWrite();
 }
 
+uint64_t UartBoost::getReadTime() const
+{
+    return readTime;
+}
+
 void UartBoost::startRead()
 {
     asyncRead();
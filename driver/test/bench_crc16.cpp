@@ -0,0 +1,92 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+// Compares the table driven CRC16 used by the H5 transport with the bitwise implementation it replaced.
+// Usage: bench_crc16 [iterations]
+
+#include "h5.h"
+#include "ser_config.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+static uint16_t calculate_crc16_checksum_bitwise(const uint8_t *start, const uint8_t *end)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (; start != end; start++)
+    {
+        crc = (crc >> 8) | (crc << 8);
+        crc ^= *start;
+        crc ^= (crc & 0xFF) >> 4;
+        crc ^= crc << 12;
+        crc ^= (crc & 0xFF) << 5;
+    }
+
+    return crc;
+}
+
+// Keeps the compiler from optimizing away the calculations
+static volatile uint16_t crcSink;
+
+template<typename F>
+static double nanosecondsPerPacket(F crcFunction, const std::vector<uint8_t> &packet, int iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < iterations; i++)
+    {
+        crcSink = crcFunction(packet.data(), packet.data() + packet.size());
+    }
+
+    auto duration = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(duration).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    auto iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+    std::vector<size_t> packetSizes = { 4, 8, 16, 32, 64, 128, 256 };
+    packetSizes.push_back(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+
+    std::cout << std::setw(8) << "size" << std::setw(14) << "bitwise ns" << std::setw(14) << "table ns" << std::setw(10) << "speedup" << std::endl;
+
+    for (auto size : packetSizes)
+    {
+        std::vector<uint8_t> packet(size);
+
+        for (size_t i = 0; i < size; i++)
+        {
+            packet[i] = static_cast<uint8_t>(rand());
+        }
+
+        if (calculate_crc16_checksum_bitwise(packet.data(), packet.data() + size) != calculate_crc16_checksum(packet.data(), packet.data() + size))
+        {
+            std::cout << "CRC mismatch for packet size " << size << std::endl;
+            return -1;
+        }
+
+        auto bitwise = nanosecondsPerPacket(calculate_crc16_checksum_bitwise, packet, iterations);
+        auto table = nanosecondsPerPacket(calculate_crc16_checksum, packet, iterations);
+
+        std::cout << std::setw(8) << size
+            << std::setw(14) << std::fixed << std::setprecision(1) << bitwise
+            << std::setw(14) << table
+            << std::setw(9) << std::setprecision(2) << bitwise / table << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+// Compares the scan for bytes that need SLIP escaping, 16 bytes at a time where SSE2 is available, with a bytewise
+// scan. Results are checked on random buffers with SLIP_END and SLIP_ESC at every offset and alignment before the
+// scans are timed.
+// Usage: bench_slip [iterations]
+
+#include "slip.h"
+#include "ser_config.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+static size_t slip_unescaped_length_bytewise(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (data[i] == SLIP_END || data[i] == SLIP_ESC)
+        {
+            return i;
+        }
+    }
+
+    return length;
+}
+
+// Random bytes that are neither SLIP_END nor SLIP_ESC
+static void fillUnescaped(std::vector<uint8_t> &buffer)
+{
+    for (auto &byte : buffer)
+    {
+        do
+        {
+            byte = static_cast<uint8_t>(rand());
+        } while (byte == SLIP_END || byte == SLIP_ESC);
+    }
+}
+
+static bool checkScan(const std::vector<uint8_t> &buffer, size_t alignment, size_t length)
+{
+    auto data = buffer.data() + alignment;
+    auto expected = slip_unescaped_length_bytewise(data, length);
+    auto actual = slip_unescaped_length(data, length);
+
+    if (actual != expected)
+    {
+        std::cout << "Scan mismatch for alignment " << alignment << " and length " << length
+            << ": " << actual << " instead of " << expected << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkScans()
+{
+    const size_t maxAlignment = 16;
+    const size_t maxLength = 80;
+
+    std::vector<uint8_t> buffer(maxAlignment + maxLength);
+
+    for (size_t alignment = 0; alignment < maxAlignment; alignment++)
+    {
+        for (size_t length = 0; length <= maxLength; length++)
+        {
+            fillUnescaped(buffer);
+
+            if (!checkScan(buffer, alignment, length))
+            {
+                return false;
+            }
+
+            for (auto special : { SLIP_END, SLIP_ESC })
+            {
+                for (size_t offset = 0; offset < length; offset++)
+                {
+                    // One special byte at offset, and a second one after it in some of the buffers
+                    buffer[alignment + offset] = static_cast<uint8_t>(special);
+
+                    if (rand() % 2 == 0)
+                    {
+                        buffer[alignment + offset + rand() % (length - offset)] = SLIP_ESC;
+                    }
+
+                    if (!checkScan(buffer, alignment, length))
+                    {
+                        return false;
+                    }
+
+                    fillUnescaped(buffer);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Keeps the compiler from optimizing away the scans
+static volatile size_t lengthSink;
+
+template<typename F>
+static double nanosecondsPerPacket(F scanFunction, const std::vector<uint8_t> &packet, int iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto i = 0; i < iterations; i++)
+    {
+        lengthSink = scanFunction(packet.data(), packet.size());
+    }
+
+    auto duration = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(duration).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    auto iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+    if (!checkScans())
+    {
+        return -1;
+    }
+
+    std::vector<size_t> packetSizes = { 4, 8, 16, 32, 64, 128, 256 };
+    packetSizes.push_back(SER_HAL_TRANSPORT_MAX_PKT_SIZE);
+
+    std::cout << std::setw(8) << "size" << std::setw(14) << "bytewise ns" << std::setw(14) << "scan ns" << std::setw(10) << "speedup" << std::endl;
+
+    for (auto size : packetSizes)
+    {
+        // Escape-free packets, the scan runs over the whole packet
+        std::vector<uint8_t> packet(size);
+        fillUnescaped(packet);
+
+        auto bytewise = nanosecondsPerPacket(slip_unescaped_length_bytewise, packet, iterations);
+        auto scan = nanosecondsPerPacket(slip_unescaped_length, packet, iterations);
+
+        std::cout << std::setw(8) << size
+            << std::setw(14) << std::fixed << std::setprecision(1) << bytewise
+            << std::setw(14) << scan
+            << std::setw(9) << std::setprecision(2) << bytewise / scan << "x" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,373 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+// Checks that the H5 transport keeps several reliable packets in flight when the negotiated transmit window is
+// larger than one, and that the window is retransmitted when an acknowledgement is lost. Acknowledgements outside
+// the window that arrive before the link is active, as from a target still in an earlier session, are ignored. The
+// target is simulated below the H5 transport, no hardware is needed.
+// Usage: test_h5_window
+
+#include "h5_transport.h"
+#include "h5.h"
+#include "slip.h"
+#include "nrf_error.h"
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+const uint8_t TARGET_WINDOW_SIZE = 4;
+const uint32_t RETRANSMISSION_INTERVAL = 50;
+const auto WAIT_TIMEOUT = std::chrono::milliseconds(2000);
+const uint8_t STALE_ACK_NUM = 5; // Outside the empty window of a new link
+
+// Replies to the link establishment like the connectivity firmware does, after an acknowledgement left from an
+// earlier session, and records the reliable packets it receives. Reliable packets are only acknowledged when the test says so. Data is passed up from a thread of its
+// own, as the UART read thread does.
+class SimulatedTarget : public Transport
+{
+public:
+    SimulatedTarget() : running(false), acknowledgeAll(false), expectedSeqNum(0) {}
+
+    uint32_t open(status_cb_t status_callback, data_cb_t data_callback, log_cb_t log_callback) override
+    {
+        Transport::open(status_callback, data_callback, log_callback);
+        running = true;
+        readThread = std::thread(&SimulatedTarget::readWorker, this);
+        return NRF_SUCCESS;
+    }
+
+    uint32_t close() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+            condition.notify_all();
+        }
+
+        if (readThread.joinable())
+        {
+            readThread.join();
+        }
+
+        return Transport::close();
+    }
+
+    uint32_t send(std::vector<uint8_t> &data) override
+    {
+        std::vector<uint8_t> packet;
+
+        if (slip_decode(data, packet) != NRF_SUCCESS || packet.empty())
+        {
+            return NRF_SUCCESS;
+        }
+
+        uint8_t *payload;
+        uint16_t payloadLength;
+        uint8_t seqNum;
+        uint8_t ackNum;
+        bool reliable;
+        h5_pkt_type_t packetType;
+
+        if (h5_decode(packet.data(), packet.size(), &payload, &payloadLength, &seqNum, &ackNum, nullptr, nullptr, &reliable, &packetType) != NRF_SUCCESS)
+        {
+            return NRF_SUCCESS;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (packetType == LINK_CONTROL_PACKET && payloadLength >= 2)
+        {
+            if (payload[0] == 0x01) // SYNC
+            {
+                reply(ACK_PACKET, STALE_ACK_NUM, {});
+                reply(LINK_CONTROL_PACKET, 0, { 0x02, 0x7D });
+            }
+            else if (payload[0] == 0x03) // SYNC CONFIG
+            {
+                reply(ACK_PACKET, STALE_ACK_NUM, {});
+                reply(LINK_CONTROL_PACKET, 0, { 0x04, 0x7B, static_cast<uint8_t>(0x10 | TARGET_WINDOW_SIZE) });
+                reply(LINK_CONTROL_PACKET, 0, { 0x03, 0xFC, static_cast<uint8_t>(0x10 | TARGET_WINDOW_SIZE) });
+            }
+        }
+        else if (packetType == VENDOR_SPECIFIC_PACKET && reliable)
+        {
+            receivedSeqNums.push_back(seqNum);
+
+            if (seqNum == expectedSeqNum)
+            {
+                expectedSeqNum = (expectedSeqNum + 1) & 0x07;
+            }
+
+            if (acknowledgeAll)
+            {
+                reply(ACK_PACKET, expectedSeqNum, {});
+            }
+
+            condition.notify_all();
+        }
+
+        return NRF_SUCCESS;
+    }
+
+    // Acknowledges all packets received in order so far
+    void acknowledge()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reply(ACK_PACKET, expectedSeqNum, {});
+    }
+
+    void setAcknowledgeAll(bool acknowledge_all)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        acknowledgeAll = acknowledge_all;
+    }
+
+    // Sequence numbers of all reliable packets received, retransmissions included
+    bool waitForPackets(size_t count, std::vector<uint8_t> &seqNums)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto found = condition.wait_for(lock, WAIT_TIMEOUT, [&] { return receivedSeqNums.size() >= count; });
+        seqNums = receivedSeqNums;
+        return found;
+    }
+
+private:
+    // Must be called with mutex held
+    void reply(h5_pkt_type_t packetType, uint8_t ackNum, std::vector<uint8_t> payload)
+    {
+        std::vector<uint8_t> h5Packet;
+        h5_encode(payload, h5Packet, 0, ackNum, false, false, packetType);
+
+        std::vector<uint8_t> slipPacket;
+        slip_encode(h5Packet, slipPacket);
+
+        replies.push_back(slipPacket);
+        condition.notify_all();
+    }
+
+    void readWorker()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (running)
+        {
+            if (replies.empty())
+            {
+                condition.wait(lock);
+                continue;
+            }
+
+            auto data = replies.front();
+            replies.pop_front();
+
+            lock.unlock();
+            dataCallback(data.data(), data.size());
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread readThread;
+    bool running;
+    bool acknowledgeAll;
+    uint8_t expectedSeqNum;
+    std::deque<std::vector<uint8_t>> replies;
+    std::vector<uint8_t> receivedSeqNums;
+};
+
+// Results of the packets sent with sendAsync
+class Completions
+{
+public:
+    send_cb_t callback()
+    {
+        return [this](uint32_t error_code)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            results.push_back(error_code);
+            condition.notify_all();
+        };
+    }
+
+    size_t count()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return results.size();
+    }
+
+    bool waitForSuccess(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (!condition.wait_for(lock, WAIT_TIMEOUT, [&] { return results.size() >= count; }))
+        {
+            return false;
+        }
+
+        for (auto result : results)
+        {
+            if (result != NRF_SUCCESS)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<uint32_t> results;
+};
+
+static bool sendPackets(H5Transport &h5, Completions &completions, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        std::vector<uint8_t> data = { 0x00, static_cast<uint8_t>(i), 0xC0, 0xDB };
+
+        if (h5.sendAsync(data, completions.callback()) != NRF_SUCCESS)
+        {
+            std::cout << "sendAsync failed for packet " << i << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool checkWindowFilled(H5Transport &h5, SimulatedTarget &target)
+{
+    Completions completions;
+
+    // All packets of the window are sent before any of them is acknowledged
+    if (!sendPackets(h5, completions, TARGET_WINDOW_SIZE))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> seqNums;
+
+    if (!target.waitForPackets(TARGET_WINDOW_SIZE, seqNums) || completions.count() != 0)
+    {
+        std::cout << "Expected " << int(TARGET_WINDOW_SIZE) << " outstanding packets, target received " << seqNums.size()
+            << " and " << completions.count() << " are completed" << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < seqNums.size(); i++)
+    {
+        if (seqNums[i] != i)
+        {
+            std::cout << "Packet " << i << " sent with sequence number " << int(seqNums[i]) << std::endl;
+            return false;
+        }
+    }
+
+    // One cumulative acknowledgement completes the whole window
+    target.acknowledge();
+
+    if (!completions.waitForSuccess(TARGET_WINDOW_SIZE))
+    {
+        std::cout << "Outstanding packets were not completed by a cumulative acknowledgement" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkRetransmission(H5Transport &h5, SimulatedTarget &target)
+{
+    Completions completions;
+    const size_t count = 3;
+
+    // The target receives the packets, but its acknowledgement is lost
+    if (!sendPackets(h5, completions, count))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> seqNums;
+
+    if (!target.waitForPackets(TARGET_WINDOW_SIZE + count, seqNums))
+    {
+        std::cout << "Target did not receive the packets" << std::endl;
+        return false;
+    }
+
+    // The whole window is sent again, in order, when the oldest packet times out
+    target.setAcknowledgeAll(true);
+
+    if (!target.waitForPackets(TARGET_WINDOW_SIZE + 2 * count, seqNums))
+    {
+        std::cout << "Packets were not retransmitted, target received " << seqNums.size() - TARGET_WINDOW_SIZE << " packets" << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < 2 * count; i++)
+    {
+        auto expected = (TARGET_WINDOW_SIZE + i % count) & 0x07;
+
+        if (seqNums[TARGET_WINDOW_SIZE + i] != expected)
+        {
+            std::cout << "Packet " << i << " sent with sequence number " << int(seqNums[TARGET_WINDOW_SIZE + i])
+                << ", expected " << expected << std::endl;
+            return false;
+        }
+    }
+
+    if (!completions.waitForSuccess(count))
+    {
+        std::cout << "Retransmitted packets were not completed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main()
+{
+    auto target = new SimulatedTarget();
+    H5Transport h5(target, RETRANSMISSION_INTERVAL, 7);
+
+    auto errorCode = h5.open(
+        [](sd_rpc_app_status_t, const char *) {},
+        [](uint8_t *, size_t) {},
+        [](sd_rpc_log_severity_t, std::string) {});
+
+    if (errorCode != NRF_SUCCESS)
+    {
+        std::cout << "Failed to open H5 transport, error code " << errorCode << std::endl;
+        h5.close();
+        return -1;
+    }
+
+    auto result = checkWindowFilled(h5, *target) && checkRetransmission(h5, *target);
+
+    h5.close();
+
+    if (!result)
+    {
+        return -1;
+    }
+
+    std::cout << "Transmit window of " << int(TARGET_WINDOW_SIZE) << " packets filled and retransmitted" << std::endl;
+    return 0;
+}
@@ -0,0 +1,220 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "ad_structures.h"
+
+#include <cstring>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Rest of the Bluetooth base UUID, following the 32 most significant bits
+static const char BASE_UUID_SUFFIX[] = "-0000-1000-8000-00805F9B34FB";
+
+AdStructures::AdStructures(const uint8_t *data, uint8_t length) :
+    data(data),
+    fieldCount(0),
+    truncated(false)
+{
+    uint8_t pos = 0;
+
+    while (pos < length)
+    {
+        auto ad_len = data[pos];
+
+        if (ad_len == 0)
+        {
+            break;
+        }
+
+        // Compared as int since the structure may end past 255
+        if (pos + 1 + ad_len > length || fieldCount == MAX_FIELDS)
+        {
+            truncated = true;
+            break;
+        }
+
+        auto type = data[pos + 1];
+        uint8_t value_len = ad_len - 1;
+
+        if (isValid(type, value_len))
+        {
+            auto &field = fields[fieldCount++];
+            field.type = type;
+            field.offset = pos + 2;
+            field.length = value_len;
+        }
+
+        pos += 1 + ad_len;
+    }
+}
+
+const AdField *AdStructures::begin() const
+{
+    return fields;
+}
+
+const AdField *AdStructures::end() const
+{
+    return fields + fieldCount;
+}
+
+uint8_t AdStructures::count() const
+{
+    return fieldCount;
+}
+
+const AdField *AdStructures::find(uint8_t type) const
+{
+    for (auto &field : *this)
+    {
+        if (field.type == type)
+        {
+            return &field;
+        }
+    }
+
+    return nullptr;
+}
+
+const uint8_t *AdStructures::value(const AdField &field) const
+{
+    return data + field.offset;
+}
+
+bool AdStructures::isTruncated() const
+{
+    return truncated;
+}
+
+uint8_t AdStructures::elementLength(uint8_t type)
+{
+    switch (type)
+    {
+        case BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE:
+        case BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE:
+        case BLE_GAP_AD_TYPE_SOLICITED_SERVICE_UUIDS_16BIT:
+        case BLE_GAP_AD_TYPE_SERVICE_DATA:
+            return 2;
+        case BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_MORE_AVAILABLE:
+        case BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_COMPLETE:
+        case AD_TYPE_SOLICITED_SERVICE_UUIDS_32BIT:
+        case BLE_GAP_AD_TYPE_SERVICE_DATA_32BIT_UUID:
+            return 4;
+        case BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE:
+        case BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE:
+        case BLE_GAP_AD_TYPE_SOLICITED_SERVICE_UUIDS_128BIT:
+        case BLE_GAP_AD_TYPE_SERVICE_DATA_128BIT_UUID:
+            return 16;
+        case BLE_GAP_AD_TYPE_PUBLIC_TARGET_ADDRESS:
+        case BLE_GAP_AD_TYPE_RANDOM_TARGET_ADDRESS:
+            return BLE_GAP_ADDR_LEN;
+        default:
+            return 0;
+    }
+}
+
+uint8_t AdStructures::elementCount(const AdField &field)
+{
+    auto length = elementLength(field.type);
+    return length == 0 ? 0 : field.length / length;
+}
+
+uint8_t AdStructures::minimumLength(uint8_t type)
+{
+    switch (type)
+    {
+        case BLE_GAP_AD_TYPE_FLAGS:
+        case BLE_GAP_AD_TYPE_TX_POWER_LEVEL:
+        case BLE_GAP_AD_TYPE_SECURITY_MANAGER_OOB_FLAGS:
+        case BLE_GAP_AD_TYPE_LE_ROLE:
+        case BLE_GAP_AD_TYPE_URI:
+            return 1;
+        case BLE_GAP_AD_TYPE_APPEARANCE:
+        case BLE_GAP_AD_TYPE_ADVERTISING_INTERVAL:
+        case BLE_GAP_AD_TYPE_3D_INFORMATION_DATA:
+        case BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA:
+            return 2;
+        case BLE_GAP_AD_TYPE_CLASS_OF_DEVICE:
+            return 3;
+        case BLE_GAP_AD_TYPE_SLAVE_CONNECTION_INTERVAL_RANGE:
+            return 4;
+        case BLE_GAP_AD_TYPE_LE_BLUETOOTH_DEVICE_ADDRESS:
+            return BLE_GAP_ADDR_LEN + 1;
+        case BLE_GAP_AD_TYPE_SIMPLE_PAIRING_HASH_C:
+        case BLE_GAP_AD_TYPE_SIMPLE_PAIRING_RANDOMIZER_R:
+        case BLE_GAP_AD_TYPE_SECURITY_MANAGER_TK_VALUE:
+        case BLE_GAP_AD_TYPE_SIMPLE_PAIRING_HASH_C256:
+        case BLE_GAP_AD_TYPE_SIMPLE_PAIRING_RANDOMIZER_R256:
+            return 16;
+        case BLE_GAP_AD_TYPE_PUBLIC_TARGET_ADDRESS:
+        case BLE_GAP_AD_TYPE_RANDOM_TARGET_ADDRESS:
+            return BLE_GAP_ADDR_LEN;
+        default:
+            // Service data starts with its UUID, UUID lists may be empty
+            return isServiceData(type) ? elementLength(type) : 0;
+    }
+}
+
+bool AdStructures::isValid(uint8_t type, uint8_t length)
+{
+    return length >= minimumLength(type);
+}
+
+bool AdStructures::isUuidList(uint8_t type)
+{
+    return elementLength(type) != 0 && !isServiceData(type)
+        && type != BLE_GAP_AD_TYPE_PUBLIC_TARGET_ADDRESS && type != BLE_GAP_AD_TYPE_RANDOM_TARGET_ADDRESS;
+}
+
+bool AdStructures::isServiceUuidList(uint8_t type)
+{
+    return type >= BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE && type <= BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE;
+}
+
+bool AdStructures::isServiceData(uint8_t type)
+{
+    return type == BLE_GAP_AD_TYPE_SERVICE_DATA
+        || type == BLE_GAP_AD_TYPE_SERVICE_DATA_32BIT_UUID
+        || type == BLE_GAP_AD_TYPE_SERVICE_DATA_128BIT_UUID;
+}
+
+size_t AdStructures::formatUuid(const uint8_t *value, uint8_t length, char *text)
+{
+    if (length != 2 && length != 4 && length != 16)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+
+    // Most significant octet first, with dashes in the 128-bit UUIDs after octet 4, 6, 8 and 10
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (length == 16 && (i == 4 || i == 6 || i == 8 || i == 10))
+        {
+            text[pos++] = '-';
+        }
+
+        auto octet = value[length - 1 - i];
+        text[pos++] = HEX_DIGITS[octet >> 4];
+        text[pos++] = HEX_DIGITS[octet & 0x0F];
+    }
+
+    if (length == 4)
+    {
+        memcpy(text + pos, BASE_UUID_SUFFIX, sizeof(BASE_UUID_SUFFIX) - 1);
+        pos += sizeof(BASE_UUID_SUFFIX) - 1;
+    }
+
+    text[pos] = '\0';
+    return pos;
+}
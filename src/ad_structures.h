@@ -0,0 +1,89 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef AD_STRUCTURES_H
+#define AD_STRUCTURES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sd_rpc.h"
+
+// Not defined by ble_gap.h
+#define AD_TYPE_SOLICITED_SERVICE_UUIDS_32BIT 0x1F
+
+// Longest text formatUuid creates, without the terminating null
+#define AD_UUID_STR_SIZE 36
+
+struct AdField
+{
+    uint8_t type;
+    uint8_t offset; // Offset of the value in the data, the value follows the length and type octets
+    uint8_t length; // Length of the value
+};
+
+/*
+ * Offset table of the AD structures in advertising or scan response data, which has the same format as EIR data.
+ * The data is parsed in one pass when the table is constructed, without allocating memory, and the values are
+ * read from the data the table was created from.
+ *
+ * Parsing stops at a structure with length zero, which marks the start of the unused part of the data, or at a
+ * structure that does not fit in the data. In the latter case the data is truncated and the structure is left out.
+ * Fields that are shorter than their type requires are left out as well, see isValid.
+ */
+class AdStructures
+{
+public:
+    // Every structure has at least a length and a type octet
+    static const uint8_t MAX_FIELDS = UINT8_MAX / 2;
+
+    AdStructures(const uint8_t *data, uint8_t length);
+
+    const AdField *begin() const;
+    const AdField *end() const;
+    uint8_t count() const;
+
+    // Returns the first field of the type, or nullptr if there is none
+    const AdField *find(uint8_t type) const;
+    const uint8_t *value(const AdField &field) const;
+
+    bool isTruncated() const;
+
+    // Length of the elements of AD types that are lists, 0 for other types. The UUID lists have UUIDs of the
+    // given length, and the service data types start with one UUID of the given length.
+    static uint8_t elementLength(uint8_t type);
+
+    // Number of whole elements in the field, trailing octets that are not a whole element are ignored
+    static uint8_t elementCount(const AdField &field);
+
+    // Shortest value the type is valid with
+    static uint8_t minimumLength(uint8_t type);
+    static bool isValid(uint8_t type, uint8_t length);
+
+    // Lists of service UUIDs and of service solicitation UUIDs
+    static bool isUuidList(uint8_t type);
+    static bool isServiceUuidList(uint8_t type);
+    static bool isServiceData(uint8_t type);
+
+    // Formats a 16-bit, 32-bit or 128-bit UUID, LSB first in value, as upper case text, with the 32-bit UUIDs
+    // expanded on the Bluetooth base UUID. text must hold AD_UUID_STR_SIZE + 1 characters.
+    // Returns the length of the text, 0 if length is not a UUID length.
+    static size_t formatUuid(const uint8_t *value, uint8_t length, char *text);
+
+private:
+    const uint8_t *data;
+    AdField fields[MAX_FIELDS];
+    uint8_t fieldCount;
+    bool truncated;
+};
+
+#endif // AD_STRUCTURES_H
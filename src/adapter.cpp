@@ -95,9 +95,16 @@ extern "C" {
     }
 }
 
-void Adapter::initEventHandling(Nan::Callback *callback, uint32_t interval)
+void Adapter::initEventHandling(Nan::Callback *callback, uint32_t interval, event_format_t format, size_t queueMemoryLimit, uint32_t queueHighWatermark,
+                                uint32_t batchMaxCount, uint32_t batchMaxLatency, bool coalescing)
 {
     eventInterval = interval;
+    eventFormat = format;
+    eventBatchMaxCount = std::max<uint32_t>(batchMaxCount, 1);
+    eventBatchMaxLatency = batchMaxLatency;
+    lastEventBatchTime = 0;
+    eventQueue.setLimits(queueMemoryLimit, queueHighWatermark);
+    eventQueue.setCoalescing(coalescing);
 
     // Setup event related functionality
     eventCallback = callback;
@@ -108,24 +115,41 @@ void Adapter::initEventHandling(Nan::Callback *callback, uint32_t interval)
             std::terminate();
         }
 
-    // Setup event interval functionality
-    if (eventInterval > 0)
-    {
-        if (eventIntervalTimer != nullptr) {
-            eventIntervalTimer->data = static_cast<void *>(this);
-            if (uv_timer_init(uv_default_loop(), eventIntervalTimer) != 0) {
+    // Setup event interval functionality. The timer is also used for adaptive batches, so it is always initialized.
+    if (eventIntervalTimer != nullptr) {
+        eventIntervalTimer->data = static_cast<void *>(this);
+        if (uv_timer_init(uv_default_loop(), eventIntervalTimer) != 0) {
             std::cerr << "Not able to create a new async event interval timer." << std::endl;
             std::terminate();
         }
 
+        if (eventInterval > 0)
+        {
             if (uv_timer_start(eventIntervalTimer, event_interval_handler, eventInterval, eventInterval) != 0) {
-            std::cerr << "Not able to create a new event interval handler." << std::endl;
-            std::terminate();
-        }
+                std::cerr << "Not able to create a new event interval handler." << std::endl;
+                std::terminate();
+            }
         }
     }
 }
 
+// Starts the timer that sends an adaptive batch after timeout ms. If the timer is already running it was started
+// for an older event, and is left running. Returns false if the timer can not be started.
+bool Adapter::startEventBatchTimer(uint64_t timeout)
+{
+    if (eventIntervalTimer == nullptr)
+    {
+        return false;
+    }
+
+    if (uv_is_active(reinterpret_cast<uv_handle_t *>(eventIntervalTimer)))
+    {
+        return true;
+    }
+
+    return uv_timer_start(eventIntervalTimer, event_interval_handler, timeout, 0) == 0;
+}
+
 extern "C" {
     void log_handler(uv_async_t *handle)
     {
@@ -301,7 +325,13 @@ void Adapter::initGattC(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "gattcRead", GattcRead);
     Nan::SetPrototypeMethod(tpl, "gattcReadCharacteristicValues", GattcReadCharacteristicValues);
     Nan::SetPrototypeMethod(tpl, "gattcWrite", GattcWrite);
+    Nan::SetPrototypeMethod(tpl, "gattcWriteBatch", GattcWriteBatch);
     Nan::SetPrototypeMethod(tpl, "gattcConfirmHandleValue", GattcConfirmHandleValue);
+    Nan::SetPrototypeMethod(tpl, "gattcDiscoverAttributes", GattcDiscoverAttributes);
+    Nan::SetPrototypeMethod(tpl, "gattcCacheLoad", GattcCacheLoad);
+    Nan::SetPrototypeMethod(tpl, "gattcCacheSave", GattcCacheSave);
+    Nan::SetPrototypeMethod(tpl, "gattcCacheRemove", GattcCacheRemove);
+    Nan::SetPrototypeMethod(tpl, "gattcCacheClear", GattcCacheClear);
 }
 
 void Adapter::initGattS(v8::Local<v8::FunctionTemplate> tpl)
@@ -314,9 +344,21 @@ void Adapter::initGattS(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "gattsSetValue", GattsSetValue);
     Nan::SetPrototypeMethod(tpl, "gattsGetValue", GattsGetValue);
     Nan::SetPrototypeMethod(tpl, "gattsReplyReadWriteAuthorize", GattsReplyReadWriteAuthorize);
+    Nan::SetPrototypeMethod(tpl, "gattsOpenNotificationStream", GattsOpenNotificationStream);
+    Nan::SetPrototypeMethod(tpl, "gattsWriteNotificationStream", GattsWriteNotificationStream);
+    Nan::SetPrototypeMethod(tpl, "gattsCloseNotificationStream", GattsCloseNotificationStream);
 }
 
-Adapter::Adapter()
+// Deletes the baton of a command dropped when the adapter is destroyed, the callback of the command is not called
+static void discardCommand(uv_work_t *req)
+{
+    delete static_cast<Baton *>(req->data);
+}
+
+Adapter::Adapter() :
+    commandExecutor(discardCommand),
+    notificationStreams(onNotificationStreamReports, this, txCredits),
+    gattDiscovery(onGattDiscoveryReport, this)
 {
     adapter = nullptr;
 
@@ -327,6 +369,13 @@ Adapter::Adapter()
 
     eventCallback = nullptr;
 
+    eventInterval = 0;
+    eventBatchMaxCount = 1;
+    eventBatchMaxLatency = 0;
+    lastEventBatchTime = 0;
+    eventFormat = EVENT_FORMAT_OBJECT;
+    clockAnchorReadTime = 0;
+    clockAnchorTime = 0;
     eventIntervalTimer = nullptr;
 
     asyncEvent = nullptr;
@@ -345,12 +394,33 @@ Adapter::Adapter()
 
 Adapter::~Adapter()
 {
+    // Commands running in the executor use the members below, stop it before they are destroyed. Batched writes
+    // waiting for application packets are woken first, so that the executor thread is joined without delay.
+    txCredits.stop();
+    commandExecutor.stop();
+
     // Remove this adapter from the global container of adapters
     adapters.erase(std::find(adapters.begin(), adapters.end(), this));
 
     // Remove callbacks and cleanup uv_handle_t instances
     cleanUpV8Resources();
 
+    for (auto &callback : notificationStreamCallbacks)
+    {
+        delete callback.second;
+    }
+
+    for (auto &callback : gattDiscoveryCallbacks)
+    {
+        delete callback.second;
+    }
+
+    for (auto &block : userMemoryBlocks)
+    {
+        block.second->Reset();
+        delete block.second;
+    }
+
     uv_mutex_destroy(adapterCloseMutex);
 }
 
@@ -412,79 +482,95 @@ void Adapter::addEventBatchStatistics(std::chrono::milliseconds duration)
     eventCallbackBatchNumber += 1;
 }
 
-void Adapter::createSecurityKeyStorage(const uint16_t connHandle, ble_gap_sec_keyset_t *keyset)
-{
-    ble_gap_sec_keyset_t *set = new ble_gap_sec_keyset_t();
-    std::memcpy(set, keyset, sizeof(ble_gap_sec_keyset_t));
-
-    keysetMap.insert(std::pair<uint16_t, ble_gap_sec_keyset_t *>(connHandle, set));
-}
-
-void Adapter::destroySecurityKeyStorage(const uint16_t connHandle)
+// Copies the own keys of keyset, if any, to the key storage of the connection and deletes keyset, which is parsed
+// from JavaScript. Returns the keyset to pass to the driver, nullptr if the connection handle is out of range.
+ble_gap_sec_keyset_t *Adapter::createSecurityKeyStorage(const uint16_t connHandle, ble_gap_sec_keyset_t *keyset)
 {
-    auto keys = keysetMap.find(connHandle);
+    ConnectionKeys *keys = nullptr;
 
-    if (keys == keysetMap.end())
+    if (connHandle < connectionKeys.size())
     {
-        return;
+        keys = &connectionKeys[connHandle];
+        std::memset(keys, 0, sizeof(ConnectionKeys));
+
+        keys->active = true;
+        keys->keyset.keys_own.p_enc_key = &keys->ownEncKey;
+        keys->keyset.keys_own.p_id_key = &keys->ownIdKey;
+        keys->keyset.keys_own.p_sign_key = &keys->ownSignKey;
+        keys->keyset.keys_own.p_pk = &keys->ownPk;
+        keys->keyset.keys_peer.p_enc_key = &keys->peerEncKey;
+        keys->keyset.keys_peer.p_id_key = &keys->peerIdKey;
+        keys->keyset.keys_peer.p_sign_key = &keys->peerSignKey;
+        keys->keyset.keys_peer.p_pk = &keys->peerPk;
     }
 
-    auto keyset = keys->second;
-
-    if (keyset->keys_own.p_enc_key != nullptr)
+    if (keyset == nullptr)
     {
-        delete keyset->keys_own.p_enc_key;
+        return keys == nullptr ? nullptr : &keys->keyset;
     }
 
-    if (keyset->keys_own.p_id_key != nullptr)
-    {
-        delete keyset->keys_own.p_id_key;
-    }
+    auto &own = keyset->keys_own;
 
-    if (keyset->keys_own.p_sign_key != nullptr)
+    if (keys != nullptr)
     {
-        delete keyset->keys_own.p_sign_key;
+        if (own.p_enc_key != nullptr) keys->ownEncKey = *own.p_enc_key;
+        if (own.p_id_key != nullptr) keys->ownIdKey = *own.p_id_key;
+        if (own.p_sign_key != nullptr) keys->ownSignKey = *own.p_sign_key;
+        if (own.p_pk != nullptr) keys->ownPk = *own.p_pk;
     }
 
-    if (keyset->keys_own.p_pk != nullptr)
-    {
-        delete keyset->keys_own.p_pk;
-    }
+    delete own.p_enc_key;
+    delete own.p_id_key;
+    delete own.p_sign_key;
+    delete own.p_pk;
 
-    if (keyset->keys_peer.p_enc_key != nullptr)
-    {
-        delete keyset->keys_peer.p_enc_key;
-    }
+    auto &peer = keyset->keys_peer;
+    delete peer.p_enc_key;
+    delete peer.p_id_key;
+    delete peer.p_sign_key;
+    delete peer.p_pk;
 
-    if (keyset->keys_peer.p_id_key != nullptr)
-    {
-        delete keyset->keys_peer.p_id_key;
-    }
+    delete keyset;
 
-    if (keyset->keys_peer.p_sign_key != nullptr)
+    return keys == nullptr ? nullptr : &keys->keyset;
+}
+
+void Adapter::destroySecurityKeyStorage(const uint16_t connHandle)
+{
+    if (connHandle < connectionKeys.size())
     {
-        delete keyset->keys_peer.p_sign_key;
+        connectionKeys[connHandle].active = false;
     }
+}
 
-    if (keyset->keys_peer.p_pk != nullptr)
+ble_gap_sec_keyset_t *Adapter::getSecurityKey(const uint16_t connHandle)
+{
+    if (connHandle >= connectionKeys.size() || !connectionKeys[connHandle].active)
     {
-        delete keyset->keys_peer.p_pk;
+        return nullptr;
     }
 
-    delete keyset;
+    return &connectionKeys[connHandle].keyset;
+}
+
+void Adapter::borrowUserMemory(const uint16_t connHandle, Nan::Persistent<v8::Value> &borrowed)
+{
+    releaseUserMemory(connHandle);
 
-    keysetMap.erase(connHandle);
+    auto block = new Nan::Persistent<v8::Value>(Nan::New(borrowed));
+    userMemoryBlocks[connHandle] = block;
 }
 
-ble_gap_sec_keyset_t *Adapter::getSecurityKey(const uint16_t connHandle)
+void Adapter::releaseUserMemory(const uint16_t connHandle)
 {
-    auto keyset = keysetMap.find(connHandle);
+    auto it = userMemoryBlocks.find(connHandle);
 
-    if (keyset == keysetMap.end())
+    if (it == userMemoryBlocks.end())
     {
-        return 0;
+        return;
     }
 
-    return keyset->second;
-
+    it->second->Reset();
+    delete it->second;
+    userMemoryBlocks.erase(it);
 }
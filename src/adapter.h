@@ -14,14 +14,22 @@
 #define ADAPTER_H
 
 #include <nan.h>
+#include <array>
 #include <chrono>
 #include <map>
+#include <vector>
 
 #include "sd_rpc.h"
 
+#include "common.h"
 #include "circular_fifo_unsafe.h"
+#include "event_queue.h"
+#include "adv_report_filter.h"
+#include "command_executor.h"
+#include "gatt_discovery.h"
+#include "notification_stream.h"
+#include "tx_credits.h"
 
-const auto EVENT_QUEUE_SIZE = 64;
 const auto LOG_QUEUE_SIZE = 64;
 const auto STATUS_QUEUE_SIZE = 64;
 
@@ -36,12 +44,11 @@ public:
     std::string message;
 };
 
-struct EventEntry {
-public:
-    ble_evt_t *event;
-    std::string timestamp;
-    int adapterID;
-};
+typedef enum
+{
+    EVENT_FORMAT_OBJECT, // One JavaScript object per event
+    EVENT_FORMAT_BINARY  // Events packed into one ArrayBuffer per batch, see event_batch.h
+} event_format_t;
 
 struct StatusEntry
 {
@@ -54,7 +61,24 @@ public:
 //using namespace memory_relaxed_aquire_release;
 using namespace memory_sequential_unsafe;
 
-typedef CircularFifo<EventEntry *, EVENT_QUEUE_SIZE> EventQueue;
+// Keys of a pairing in progress on one connection. The keyset passed to the driver points to the keys stored
+// inline, so that no keys are allocated per pairing.
+struct ConnectionKeys
+{
+    bool active;
+    ble_gap_sec_keyset_t keyset;
+
+    ble_gap_enc_key_t ownEncKey;
+    ble_gap_id_key_t ownIdKey;
+    ble_gap_sign_info_t ownSignKey;
+    ble_gap_lesc_p256_pk_t ownPk;
+
+    ble_gap_enc_key_t peerEncKey;
+    ble_gap_id_key_t peerIdKey;
+    ble_gap_sign_info_t peerSignKey;
+    ble_gap_lesc_p256_pk_t peerPk;
+};
+
 typedef CircularFifo<LogEntry *, LOG_QUEUE_SIZE> LogQueue;
 typedef CircularFifo<StatusEntry *, STATUS_QUEUE_SIZE> StatusQueue;
 
@@ -66,7 +90,8 @@ public:
 
     adapter_t *getInternalAdapter() const;
 
-    void initEventHandling(Nan::Callback *callback, const uint32_t interval);
+    void initEventHandling(Nan::Callback *callback, const uint32_t interval, const event_format_t format, const size_t queueMemoryLimit, const uint32_t queueHighWatermark,
+                           const uint32_t batchMaxCount, const uint32_t batchMaxLatency, const bool coalescing);
     void appendEvent(ble_evt_t *event);
 
     void onRpcEvent(uv_async_t *handle);
@@ -160,7 +185,16 @@ private:
     ADAPTER_METHOD_DEFINITIONS(GattcRead);
     ADAPTER_METHOD_DEFINITIONS(GattcReadCharacteristicValues);
     ADAPTER_METHOD_DEFINITIONS(GattcWrite);
+    ADAPTER_METHOD_DEFINITIONS(GattcWriteBatch);
     ADAPTER_METHOD_DEFINITIONS(GattcConfirmHandleValue);
+    ADAPTER_METHOD_DEFINITIONS(GattcDiscoverAttributes);
+    ADAPTER_METHOD_DEFINITIONS(GattcCacheLoad);
+    ADAPTER_METHOD_DEFINITIONS(GattcCacheSave);
+    static void onGattDiscoveryReport(void *context, GattDiscoveryResult &result);
+
+    // Gattc sync methods
+    static NAN_METHOD(GattcCacheRemove);
+    static NAN_METHOD(GattcCacheClear);
 
     // Gatts async mehtods
     ADAPTER_METHOD_DEFINITIONS(GattsAddService);
@@ -172,22 +206,51 @@ private:
     ADAPTER_METHOD_DEFINITIONS(GattsGetValue);
     ADAPTER_METHOD_DEFINITIONS(GattsReplyReadWriteAuthorize);
 
+    // Gatts sync methods
+    static NAN_METHOD(GattsOpenNotificationStream);
+    static NAN_METHOD(GattsWriteNotificationStream);
+    static NAN_METHOD(GattsCloseNotificationStream);
+    static void onNotificationStreamReports(void *context, const std::vector<NotificationStreamProgress> &reports);
+
     static void initGeneric(v8::Local<v8::FunctionTemplate> tpl);
     static void initGap(v8::Local<v8::FunctionTemplate> tpl);
     static void initGattC(v8::Local<v8::FunctionTemplate> tpl);
     static void initGattS(v8::Local<v8::FunctionTemplate> tpl);
 
     void dispatchEvents();
+    bool deferEventBatch();
+    bool startEventBatchTimer(uint64_t timeout);
+    void sendEventBatch();
+    void sendEventQueueStatus();
+    void setClockAnchor();
+    EventTime eventTime(const EventEntry *eventEntry) const;
+    void eventToJs(EventEntry *eventEntry, v8::Local<v8::Array> array, const uint32_t arrayIndex);
+    v8::Local<v8::Array> createEventArray();
+    v8::Local<v8::ArrayBuffer> createEventBatch(v8::Local<v8::Array> objects);
+    void recordDeliveredLatency(const std::vector<EventEntry *> &eventEntries);
+    v8::Local<v8::Object> createLatencyHistograms();
     static uint32_t enableBLE(adapter_t *adapter);
 
-    void createSecurityKeyStorage(const uint16_t connHandle, ble_gap_sec_keyset_t *keyset);
+    ble_gap_sec_keyset_t *createSecurityKeyStorage(const uint16_t connHandle, ble_gap_sec_keyset_t *keyset);
     void destroySecurityKeyStorage(const uint16_t connHandle);
     ble_gap_sec_keyset_t *getSecurityKey(const uint16_t connHandle);
 
-    std::map<uint16_t, ble_gap_sec_keyset_t *> keysetMap;
+    void borrowUserMemory(const uint16_t connHandle, Nan::Persistent<v8::Value> &borrowed);
+    void releaseUserMemory(const uint16_t connHandle);
+
+    // Indexed by connection handle
+    std::array<ConnectionKeys, SD_RPC_MAX_CONNECTIONS> connectionKeys;
 
     adapter_t *adapter;
+    CommandExecutor commandExecutor; // Runs the calls to the BLE driver of the async methods, in the order they are made
+    TxCredits txCredits; // Application packets of each connection, taken by notification streams and batched writes
+    NotificationStreams notificationStreams;
+    std::map<uint32_t, Nan::Callback *> notificationStreamCallbacks; // Progress callback of each notification stream
+    GattDiscovery gattDiscovery;
+    std::map<uint16_t, Nan::Callback *> gattDiscoveryCallbacks; // Callback of the discovery running on each connection
+    std::map<uint16_t, Nan::Persistent<v8::Value> *> userMemoryBlocks; // Memory given in replyUserMemory, until it is released
     EventQueue eventQueue;
+    AdvReportFilter advReportFilter; // Set when scanning is started, applied before advertising reports are queued
     LogQueue logQueue;
     StatusQueue statusQueue;
 
@@ -195,9 +258,22 @@ private:
     Nan::Callback *logCallback;
     Nan::Callback *statusCallback;
 
-    // Interval to use for sending BLE driver events to JavaScript. If 0 events will be sent as soon as they are received from the BLE driver.
+    // Interval to use for sending BLE driver events to JavaScript. If 0 events are sent in adaptive batches, see deferEventBatch.
     uint32_t eventInterval;
-    uv_timer_t* eventIntervalTimer;
+
+    // Adaptive batching: largest number of events in a batch, and longest time in ms an event is held back to fill a batch.
+    // If eventBatchMaxLatency is 0 events are sent as soon as they are received from the BLE driver.
+    uint32_t eventBatchMaxCount;
+    uint32_t eventBatchMaxLatency;
+    uint64_t lastEventBatchTime; // Time the previous batch was sent, nanoseconds of std::chrono::steady_clock
+    event_format_t eventFormat;
+    std::vector<EventEntry *> eventBatch; // Events taken from eventQueue for the batch being sent to JavaScript, reused between batches
+
+    // Event read times are sent to JavaScript relative to the time the adapter was opened
+    uint64_t clockAnchorReadTime;
+    double clockAnchorTime;
+
+    uv_timer_t* eventIntervalTimer; // Sends events every eventInterval ms, or when an adaptive batch is due if eventInterval is 0
     uv_async_t* asyncEvent;
 
     uv_async_t* asyncLog;
@@ -0,0 +1,344 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "adv_report_filter.h"
+#include "ad_structures.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+// Bluetooth base UUID 00000000-0000-1000-8000-00805F9B34FB, LSB first
+static const adv_uuid_t BASE_UUID = {{
+    0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+}};
+
+// Peers that have not been seen for this long are forgotten when the peer table is full
+static const uint64_t PEER_EXPIRY_TIME = 10000000000ULL; // 10 s in ns
+
+static adv_uuid_t baseUuid(uint32_t value)
+{
+    auto uuid = BASE_UUID;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        uuid[12 + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    return uuid;
+}
+
+static uint64_t addressValue(const ble_gap_addr_t &address)
+{
+    uint64_t value = 0;
+
+    for (auto i = BLE_GAP_ADDR_LEN; i > 0; i--)
+    {
+        value = (value << 8) | address.addr[i - 1];
+    }
+
+    return value;
+}
+
+// FNV-1a hash of the report type and data
+static uint32_t reportHash(const ble_gap_evt_adv_report_t &report)
+{
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ report.type) * 16777619u;
+
+    for (auto i = 0; i < report.dlen; i++)
+    {
+        hash = (hash ^ report.data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+AdvReportFilterSettings::AdvReportFilterSettings() :
+    minRssi(INT8_MIN),
+    deduplicate(false),
+    refreshPeriod(0)
+{}
+
+AdvReportFilter::PeerState::PeerState() :
+    matched(false),
+    lastSeen(0)
+{
+    for (auto i = 0; i < 2; i++)
+    {
+        forwarded[i] = false;
+        dataHash[i] = 0;
+        forwardTime[i] = 0;
+    }
+}
+
+AdvReportFilter::AdvReportFilter() :
+    enabled(false),
+    droppedCount(0)
+{}
+
+void AdvReportFilter::setSettings(const AdvReportFilterSettings &filterSettings)
+{
+    std::lock_guard<std::mutex> lock(filterMutex);
+    settings = filterSettings;
+    peers.clear();
+    enabled = true;
+}
+
+void AdvReportFilter::disable()
+{
+    std::lock_guard<std::mutex> lock(filterMutex);
+    enabled = false;
+    peers.clear();
+}
+
+bool AdvReportFilter::accept(const ble_gap_evt_adv_report_t &report, uint64_t readTime)
+{
+    std::lock_guard<std::mutex> lock(filterMutex);
+
+    if (!enabled)
+    {
+        return true;
+    }
+
+    auto address = addressValue(report.peer_addr);
+
+    if (report.rssi < settings.minRssi || settings.deniedAddresses.count(address) != 0)
+    {
+        droppedCount++;
+        return false;
+    }
+
+    auto peer = peers.find(address);
+    auto matched = !hasMatchCriteria()
+        || (peer != peers.end() && peer->second.matched)
+        || settings.allowedAddresses.count(address) != 0
+        || matchesContent(report);
+
+    if (!matched)
+    {
+        droppedCount++;
+        return false;
+    }
+
+    if (!settings.deduplicate && !hasMatchCriteria())
+    {
+        return true;
+    }
+
+    if (peer == peers.end())
+    {
+        if (peers.size() >= MAX_PEERS)
+        {
+            expirePeers(readTime);
+        }
+
+        peer = peers.insert(std::make_pair(address, PeerState())).first;
+    }
+
+    auto &state = peer->second;
+    state.matched = true;
+    state.lastSeen = readTime;
+
+    if (!settings.deduplicate)
+    {
+        return true;
+    }
+
+    auto kind = report.scan_rsp;
+    auto hash = reportHash(report);
+    auto refreshPeriod = static_cast<uint64_t>(settings.refreshPeriod) * 1000000;
+
+    if (state.forwarded[kind] && state.dataHash[kind] == hash
+        && (refreshPeriod == 0 || readTime - state.forwardTime[kind] < refreshPeriod))
+    {
+        droppedCount++;
+        return false;
+    }
+
+    state.forwarded[kind] = true;
+    state.dataHash[kind] = hash;
+    state.forwardTime[kind] = readTime;
+
+    return true;
+}
+
+uint32_t AdvReportFilter::getDroppedCount() const
+{
+    return droppedCount;
+}
+
+bool AdvReportFilter::hasMatchCriteria() const
+{
+    return !settings.allowedAddresses.empty() || !settings.serviceUuids.empty()
+        || !settings.manufacturerIds.empty() || !settings.namePrefix.empty();
+}
+
+bool AdvReportFilter::matchesContent(const ble_gap_evt_adv_report_t &report) const
+{
+    AdStructures structures(report.data, report.dlen);
+
+    for (auto &field : structures)
+    {
+        auto value = structures.value(field);
+
+        switch (field.type)
+        {
+            case BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA:
+                if (settings.manufacturerIds.count(static_cast<uint16_t>(value[0] | (value[1] << 8))) != 0)
+                {
+                    return true;
+                }
+                break;
+            case BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME:
+            case BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME:
+                if (!settings.namePrefix.empty() && field.length >= settings.namePrefix.size()
+                    && memcmp(value, settings.namePrefix.data(), settings.namePrefix.size()) == 0)
+                {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (!AdStructures::isServiceUuidList(field.type) || settings.serviceUuids.empty())
+        {
+            continue;
+        }
+
+        auto uuid_len = AdStructures::elementLength(field.type);
+        auto uuid_count = AdStructures::elementCount(field);
+
+        for (auto i = 0; i < uuid_count; i++)
+        {
+            auto element = value + i * uuid_len;
+            adv_uuid_t uuid;
+
+            if (uuid_len == 16)
+            {
+                std::copy(element, element + 16, uuid.begin());
+            }
+            else
+            {
+                uint32_t shortUuid = 0;
+
+                for (auto j = uuid_len; j > 0; j--)
+                {
+                    shortUuid = (shortUuid << 8) | element[j - 1];
+                }
+
+                uuid = baseUuid(shortUuid);
+            }
+
+            if (std::find(settings.serviceUuids.begin(), settings.serviceUuids.end(), uuid) != settings.serviceUuids.end())
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Called when the peer table is full. If no peer has expired, all are forgotten and treated as new peers.
+void AdvReportFilter::expirePeers(uint64_t now)
+{
+    auto expiryTime = std::max(PEER_EXPIRY_TIME, static_cast<uint64_t>(settings.refreshPeriod) * 1000000);
+
+    for (auto peer = peers.begin(); peer != peers.end();)
+    {
+        if (now - peer->second.lastSeen >= expiryTime)
+        {
+            peer = peers.erase(peer);
+        }
+        else
+        {
+            ++peer;
+        }
+    }
+
+    if (peers.size() >= MAX_PEERS)
+    {
+        peers.clear();
+    }
+}
+
+bool AdvReportFilter::parseAddress(const std::string &text, uint64_t &address)
+{
+    unsigned int bytes[BLE_GAP_ADDR_LEN];
+    char trailing;
+
+    if (sscanf(text.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x%c",
+               &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0], &trailing) != BLE_GAP_ADDR_LEN)
+    {
+        return false;
+    }
+
+    address = 0;
+
+    for (auto i = BLE_GAP_ADDR_LEN; i > 0; i--)
+    {
+        address = (address << 8) | bytes[i - 1];
+    }
+
+    return true;
+}
+
+bool AdvReportFilter::parseUuid(const std::string &text, adv_uuid_t &uuid)
+{
+    std::vector<uint8_t> nibbles;
+
+    for (auto character : text)
+    {
+        if (character == '-')
+        {
+            continue;
+        }
+
+        if (!isxdigit(static_cast<unsigned char>(character)))
+        {
+            return false;
+        }
+
+        nibbles.push_back(static_cast<uint8_t>(isdigit(static_cast<unsigned char>(character))
+            ? character - '0'
+            : tolower(static_cast<unsigned char>(character)) - 'a' + 10));
+    }
+
+    if (nibbles.size() == 4 || nibbles.size() == 8)
+    {
+        uint32_t value = 0;
+
+        for (auto nibble : nibbles)
+        {
+            value = (value << 4) | nibble;
+        }
+
+        uuid = baseUuid(value);
+        return true;
+    }
+
+    if (nibbles.size() == 32)
+    {
+        // The text is most significant byte first
+        for (auto i = 0; i < 16; i++)
+        {
+            uuid[15 - i] = static_cast<uint8_t>((nibbles[2 * i] << 4) | nibbles[2 * i + 1]);
+        }
+
+        return true;
+    }
+
+    return false;
+}
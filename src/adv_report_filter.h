@@ -0,0 +1,110 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef ADV_REPORT_FILTER_H
+#define ADV_REPORT_FILTER_H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+#include "sd_rpc.h"
+
+typedef std::array<uint8_t, 16> adv_uuid_t; // 128-bit UUID, LSB first
+
+struct AdvReportFilterSettings
+{
+    AdvReportFilterSettings();
+
+    // Addresses are the 48 bits of ble_gap_addr_t.addr, the address type is ignored
+    std::set<uint64_t> allowedAddresses;
+    std::set<uint64_t> deniedAddresses;
+
+    // 16-bit and 32-bit UUIDs are stored as 128-bit UUIDs based on the Bluetooth base UUID
+    std::vector<adv_uuid_t> serviceUuids;
+    std::set<uint16_t> manufacturerIds;
+    std::string namePrefix;
+
+    int16_t minRssi; // Reports with a lower RSSI are dropped, -128 or less drops none
+
+    bool deduplicate;
+    uint32_t refreshPeriod; // Time in ms after which a duplicate report is passed on again, 0 only when its data changes
+};
+
+/*
+ * Drops advertising reports that the application is not interested in, before they are queued for JavaScript.
+ * Configured in the NodeJS thread when scanning is started, and applied in the driver event thread.
+ *
+ * A report passes the filter if its address is not denied, its RSSI is at least minRssi, and it matches any of
+ * the allowed addresses, service UUIDs, manufacturer ids or the name prefix. If none of those are set all reports
+ * match. Once a report from an address has matched, later reports from that address also match, so that scan
+ * responses without the UUIDs or name of the advertisement are passed on as well.
+ *
+ * With deduplication, a report with the same data and type as the previous report passed on from its address
+ * is dropped until refreshPeriod has passed.
+ */
+class AdvReportFilter
+{
+public:
+    AdvReportFilter();
+
+    // Replaces the settings and forgets the addresses seen so far
+    void setSettings(const AdvReportFilterSettings &settings);
+    void disable();
+
+    // readTime is the time the report was read, nanoseconds of std::chrono::steady_clock
+    bool accept(const ble_gap_evt_adv_report_t &report, uint64_t readTime);
+
+    // Number of reports dropped since the adapter was opened
+    uint32_t getDroppedCount() const;
+
+    // Parses addresses on the form "AA:BB:CC:DD:EE:FF", most significant byte first
+    static bool parseAddress(const std::string &text, uint64_t &address);
+
+    // Parses 16-bit, 32-bit and 128-bit UUIDs as hexadecimal text, with or without dashes
+    static bool parseUuid(const std::string &text, adv_uuid_t &uuid);
+
+private:
+    struct PeerState
+    {
+        PeerState();
+
+        bool matched;
+        uint64_t lastSeen;
+
+        // Indexed by scan_rsp
+        bool forwarded[2];
+        uint32_t dataHash[2];
+        uint64_t forwardTime[2];
+    };
+
+    static const size_t MAX_PEERS = 4096;
+
+    bool matchesContent(const ble_gap_evt_adv_report_t &report) const;
+    bool hasMatchCriteria() const;
+    void expirePeers(uint64_t now);
+
+    mutable std::mutex filterMutex;
+    bool enabled;
+    AdvReportFilterSettings settings;
+    std::unordered_map<uint64_t, PeerState> peers;
+
+    std::atomic<uint32_t> droppedCount;
+};
+
+#endif // ADV_REPORT_FILTER_H
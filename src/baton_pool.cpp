@@ -0,0 +1,102 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "baton_pool.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// The size class of each allocation is stored in front of it, in a header that keeps the baton aligned
+union BlockHeader
+{
+    size_t sizeClass;
+    std::max_align_t alignment;
+};
+
+static const size_t NO_SIZE_CLASS = BatonPool::SIZE_CLASS_COUNT;
+
+static std::mutex &poolMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::array<std::vector<BlockHeader *>, BatonPool::SIZE_CLASS_COUNT> &freeLists()
+{
+    static std::array<std::vector<BlockHeader *>, BatonPool::SIZE_CLASS_COUNT> lists;
+    return lists;
+}
+
+void *BatonPool::allocate(size_t size)
+{
+    auto sizeClass = size == 0 ? 0 : (size - 1) / SIZE_CLASS_LENGTH;
+    BlockHeader *block = nullptr;
+
+    if (sizeClass < SIZE_CLASS_COUNT)
+    {
+        std::lock_guard<std::mutex> lock(poolMutex());
+        auto &freeList = freeLists()[sizeClass];
+
+        if (!freeList.empty())
+        {
+            block = freeList.back();
+            freeList.pop_back();
+        }
+    }
+    else
+    {
+        sizeClass = NO_SIZE_CLASS;
+    }
+
+    if (block == nullptr)
+    {
+        auto length = sizeClass == NO_SIZE_CLASS ? size : (sizeClass + 1) * SIZE_CLASS_LENGTH;
+        block = static_cast<BlockHeader *>(malloc(sizeof(BlockHeader) + length));
+
+        if (block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        block->sizeClass = sizeClass;
+    }
+
+    return block + 1;
+}
+
+void BatonPool::release(void *pointer)
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+
+    auto block = static_cast<BlockHeader *>(pointer) - 1;
+
+    if (block->sizeClass != NO_SIZE_CLASS)
+    {
+        std::lock_guard<std::mutex> lock(poolMutex());
+        auto &freeList = freeLists()[block->sizeClass];
+
+        if (freeList.size() < MAX_FREE_PER_CLASS)
+        {
+            freeList.push_back(block);
+            return;
+        }
+    }
+
+    free(block);
+}
@@ -0,0 +1,35 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef BATON_POOL_H
+#define BATON_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Memory for batons, kept in free lists by size class so that the baton of each adapter method call reuses the
+ * memory of an earlier call instead of being allocated from the heap. Batons larger than the largest size class
+ * are allocated from the heap. Batons are created and deleted in the NodeJS thread, but the pool is locked so that
+ * it may be used from any thread.
+ */
+class BatonPool
+{
+public:
+    static void *allocate(size_t size);
+    static void release(void *pointer);
+
+    static const size_t SIZE_CLASS_LENGTH = 64;
+    static const size_t SIZE_CLASS_COUNT = 16;  // Size classes up to 1 KiB
+    static const size_t MAX_FREE_PER_CLASS = 32; // Memory released beyond this is returned to the heap
+};
+
+#endif // BATON_POOL_H
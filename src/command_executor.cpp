@@ -0,0 +1,169 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "command_executor.h"
+
+#include <exception>
+#include <iostream>
+
+CommandExecutor::CommandExecutor(command_discard_cb discard) :
+    discard(discard),
+    stopping(false),
+    asyncCompleted(nullptr),
+    pendingCount(0),
+    maxPendingCount(0)
+{}
+
+CommandExecutor::~CommandExecutor()
+{
+    stop();
+}
+
+void CommandExecutor::stop()
+{
+    if (asyncCompleted == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        stopping = true;
+    }
+
+    commandCondition.notify_one();
+    thread.join();
+
+    // Commands that have not been started, and completed commands whose after callback has not run
+    for (auto &command : commands)
+    {
+        discard(command.req);
+    }
+
+    for (auto &command : completed)
+    {
+        discard(command.req);
+    }
+
+    commands.clear();
+    completed.clear();
+    pendingCount = 0;
+
+    auto handle = reinterpret_cast<uv_handle_t *>(asyncCompleted);
+    uv_close(handle, [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+
+    asyncCompleted = nullptr;
+}
+
+void CommandExecutor::start()
+{
+    stopping = false;
+    asyncCompleted = new uv_async_t();
+    asyncCompleted->data = static_cast<void *>(this);
+
+    if (uv_async_init(uv_default_loop(), asyncCompleted, [](uv_async_t *handle) {
+        static_cast<CommandExecutor *>(handle->data)->onCompleted();
+    }) != 0)
+    {
+        std::cerr << "Not able to create the command executor async handler." << std::endl;
+        std::terminate();
+    }
+
+    // Only keeps the event loop alive while commands are pending
+    uv_unref(reinterpret_cast<uv_handle_t *>(asyncCompleted));
+
+    thread = std::thread(&CommandExecutor::run, this);
+}
+
+void CommandExecutor::queue(uv_work_t *req, command_work_cb work, command_after_cb after)
+{
+    if (asyncCompleted == nullptr)
+    {
+        start();
+    }
+
+    if (pendingCount++ == 0)
+    {
+        uv_ref(reinterpret_cast<uv_handle_t *>(asyncCompleted));
+    }
+
+    if (pendingCount > maxPendingCount)
+    {
+        maxPendingCount = pendingCount;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        commands.push_back(Command{ req, work, after });
+    }
+
+    commandCondition.notify_one();
+}
+
+void CommandExecutor::run()
+{
+    std::unique_lock<std::mutex> lock(commandMutex);
+
+    while (true)
+    {
+        commandCondition.wait(lock, [this] { return stopping || !commands.empty(); });
+
+        if (stopping)
+        {
+            return;
+        }
+
+        auto command = commands.front();
+        commands.pop_front();
+
+        lock.unlock();
+        command.work(command.req);
+        lock.lock();
+
+        completed.push_back(command);
+        uv_async_send(asyncCompleted);
+    }
+}
+
+// Runs in the NodeJS thread, uv_async_send may have coalesced the notifications of several commands
+void CommandExecutor::onCompleted()
+{
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        completing.swap(completed);
+    }
+
+    for (auto &command : completing)
+    {
+        command.after(command.req);
+    }
+
+    pendingCount -= static_cast<uint32_t>(completing.size());
+    completing.clear();
+
+    if (pendingCount == 0)
+    {
+        uv_unref(reinterpret_cast<uv_handle_t *>(asyncCompleted));
+    }
+}
+
+uint32_t CommandExecutor::getPendingCount() const
+{
+    return pendingCount;
+}
+
+uint32_t CommandExecutor::getMaxPendingCount() const
+{
+    return maxPendingCount;
+}
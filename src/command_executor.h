@@ -0,0 +1,85 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef COMMAND_EXECUTOR_H
+#define COMMAND_EXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+#include <uv.h>
+
+typedef void (*command_work_cb)(uv_work_t *req);
+typedef void (*command_after_cb)(uv_work_t *req);
+typedef void (*command_discard_cb)(uv_work_t *req);
+
+/*
+ * Runs the blocking calls to the BLE driver for one adapter in a thread of its own, in the order they are queued.
+ * The calls then neither wait behind unrelated work in the libuv thread pool nor hold its threads while waiting
+ * for the serial port. As with uv_queue_work, the work callback runs in the executor thread and the after callback
+ * in the NodeJS thread, and the NodeJS event loop is kept alive while commands are pending.
+ *
+ * The thread is started when the first command is queued and stopped by stop or when the executor is destroyed.
+ * Commands whose after callback has not run when the executor is stopped are passed to the discard callback instead.
+ */
+class CommandExecutor
+{
+public:
+    explicit CommandExecutor(command_discard_cb discard);
+    ~CommandExecutor();
+
+    // Called from the NodeJS thread
+    void queue(uv_work_t *req, command_work_cb work, command_after_cb after);
+
+    // Called from the NodeJS thread. Waits for the running command to finish and discards all commands left,
+    // no work or after callbacks are called after stop returns.
+    void stop();
+
+    // Number of commands queued or running, and the largest number there has been
+    uint32_t getPendingCount() const;
+    uint32_t getMaxPendingCount() const;
+
+private:
+    struct Command
+    {
+        uv_work_t *req;
+        command_work_cb work;
+        command_after_cb after;
+    };
+
+    void start();
+    void run();
+    void onCompleted();
+
+    command_discard_cb discard;
+
+    std::thread thread;
+    std::mutex commandMutex;
+    std::condition_variable commandCondition;
+    std::deque<Command> commands;   // Waiting for the executor thread
+    std::vector<Command> completed; // Waiting for the after callback in the NodeJS thread
+    std::vector<Command> completing;
+    bool stopping;
+
+    uv_async_t *asyncCompleted;
+
+    // Only used in the NodeJS thread
+    uint32_t pendingCount;
+    uint32_t maxPendingCount;
+};
+
+#endif // COMMAND_EXECUTOR_H
@@ -10,14 +10,18 @@
  *
  */
 
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <sstream>
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <unordered_map>
 
 #include "common.h"
 #include "ble_hci.h"
+#include "event_queue.h"
 
 #define RETURN_VALUE_OR_THROW_EXCEPTION(method) \
 try { \
@@ -77,7 +81,9 @@ static name_map_t sd_rpc_app_status_map = {
     NAME_MAP_ENTRY(PKT_DECODE_ERROR),
     NAME_MAP_ENTRY(IO_RESOURCES_UNAVAILABLE),
     NAME_MAP_ENTRY(RESET_PERFORMED),
-    NAME_MAP_ENTRY(CONNECTION_ACTIVE)
+    NAME_MAP_ENTRY(CONNECTION_ACTIVE),
+    NAME_MAP_ENTRY(EVENT_QUEUE_HIGH_WATERMARK_REACHED),
+    NAME_MAP_ENTRY(EVENT_QUEUE_HIGH_WATERMARK_CLEARED)
 };
 
 static name_map_t hci_status_map =
@@ -112,7 +118,11 @@ static name_map_t hci_status_map =
 
 const std::string getCurrentTimeInMilliseconds()
 {
-    auto current_time = std::chrono::system_clock::now();
+    return getTimeInMilliseconds(std::chrono::system_clock::now());
+}
+
+const std::string getTimeInMilliseconds(std::chrono::system_clock::time_point current_time)
+{
     auto time = std::chrono::system_clock::to_time_t(current_time);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(current_time.time_since_epoch());
 
@@ -148,9 +158,9 @@ uint32_t uint32_decode(const uint8_t *p_encoded_data)
             (static_cast<uint32_t>(const_cast<uint8_t *>(p_encoded_data)[3]) << 24));
 }
 
-uint16_t fromNameToValue(name_map_t names, const char *name)
+uint16_t fromNameToValue(const name_map_t &names, const char *name)
 {
-    name_map_it_t it;
+    name_map_const_it_t it;
     uint16_t key = -1;
 
     for (it = names.begin(); it != names.end(); ++it)
@@ -265,23 +275,104 @@ uint8_t *ConversionUtility::getNativePointerToUint8(v8::Local<v8::Object>js, con
 
 uint8_t *ConversionUtility::getNativePointerToUint8(v8::Local<v8::Value> js)
 {
-    if (!js->IsArray())
+    auto length = getByteLength(js);
+    auto string = static_cast<uint8_t *>(malloc(sizeof(uint8_t) * length));
+
+    assert(string != nullptr);
+
+    copyBytes(js, string);
+
+    return string;
+}
+
+uint8_t *ConversionUtility::getBorrowedPointerToUint8(v8::Local<v8::Object>js, const char *name, uint16_t length, Nan::Persistent<v8::Value> &reference)
+{
+    v8::Local<v8::Value> value = Utility::Get(js, name);
+
+    RETURN_VALUE_OR_THROW_EXCEPTION(ConversionUtility::getBorrowedPointerToUint8(value, length, reference));
+}
+
+uint8_t *ConversionUtility::getBorrowedPointerToUint8(v8::Local<v8::Value> js, uint16_t length, Nan::Persistent<v8::Value> &reference)
+{
+    auto valueLength = getByteLength(js);
+
+    if (js->IsArrayBufferView() && valueLength >= length)
+    {
+        reference.Reset(js);
+        return *Nan::TypedArrayContents<uint8_t>(js);
+    }
+
+    // Arrays, and views shorter than length, are copied to a Buffer of at least length bytes that is borrowed instead
+    auto bufferLength = std::max(valueLength, static_cast<size_t>(length));
+    auto buffer = Nan::NewBuffer(static_cast<uint32_t>(bufferLength)).ToLocalChecked();
+    auto data = reinterpret_cast<uint8_t *>(node::Buffer::Data(buffer));
+
+    memset(data, 0, bufferLength);
+    copyBytes(js, data);
+
+    reference.Reset(buffer);
+    return data;
+}
+
+uint8_t *ConversionUtility::getCopiedPointerToUint8(v8::Local<v8::Object>js, const char *name, uint16_t length, std::vector<uint8_t> &storage)
+{
+    v8::Local<v8::Value> value = Utility::Get(js, name);
+
+    RETURN_VALUE_OR_THROW_EXCEPTION(ConversionUtility::getCopiedPointerToUint8(value, length, storage));
+}
+
+uint8_t *ConversionUtility::getCopiedPointerToUint8(v8::Local<v8::Value> js, uint16_t length, std::vector<uint8_t> &storage)
+{
+    auto valueLength = getByteLength(js);
+
+    storage.assign(std::max(valueLength, static_cast<size_t>(length)), 0);
+
+    if (storage.empty())
+    {
+        return nullptr;
+    }
+
+    copyBytes(js, storage.data());
+    return storage.data();
+}
+
+size_t ConversionUtility::getByteLength(v8::Local<v8::Value> js)
+{
+    if (js->IsArrayBufferView())
     {
-        throw "array";
+        return Nan::TypedArrayContents<uint8_t>(js).length();
+    }
+
+    if (js->IsArray())
+    {
+        return v8::Local<v8::Array>::Cast(js)->Length();
+    }
+
+    throw "array or Buffer";
+}
+
+// Views are copied in one block, arrays one element at a time
+void ConversionUtility::copyBytes(v8::Local<v8::Value> js, uint8_t *destination)
+{
+    if (js->IsArrayBufferView())
+    {
+        Nan::TypedArrayContents<uint8_t> contents(js);
+
+        if (contents.length() > 0)
+        {
+            memcpy(destination, *contents, contents.length());
+        }
+
+        return;
     }
 
     v8::Local<v8::Array> jsarray = v8::Local<v8::Array>::Cast(js);
     auto length = jsarray->Length();
-    auto string = static_cast<uint8_t *>(malloc(sizeof(uint8_t) * length));
-
-    assert(string != nullptr);
 
     for (uint32_t i = 0; i < length; ++i)
     {
-        string[i] = static_cast<uint8_t>(jsarray->Get(Nan::New(i))->Uint32Value());
+        destination[i] = static_cast<uint8_t>(jsarray->Get(Nan::New(i))->Uint32Value());
     }
-
-    return string;
 }
 
 uint16_t *ConversionUtility::getNativePointerToUint16(v8::Local<v8::Object>js, const char *name)
@@ -348,9 +439,9 @@ v8::Local<v8::Object> ConversionUtility::getJsObjectOrNull(v8::Local<v8::Object>
     RETURN_VALUE_OR_THROW_EXCEPTION(ConversionUtility::getJsObjectOrNull(obj));
 }
 
-uint16_t ConversionUtility::stringToValue(name_map_t name_map, v8::Local<v8::Object> string, uint16_t defaultValue)
+uint16_t ConversionUtility::stringToValue(const name_map_t &name_map, v8::Local<v8::Object> string, uint16_t defaultValue)
 {
-    name_map_it_t it;
+    name_map_const_it_t it;
     auto key = defaultValue;
 
     auto name = reinterpret_cast<const char *>(ConversionUtility::getNativePointerToUint8(string));
@@ -467,6 +558,36 @@ v8::Handle<v8::Value> ConversionUtility::toJsValueArray(const uint8_t *nativeDat
 	return ConversionUtility::toJsValueArray(const_cast<uint8_t *>(nativeData), length);
 }
 
+void ConversionUtility::setValueBuffer(v8::Local<v8::Object> obj, const char *name, const char *bufferName, const uint8_t *nativeData, uint16_t length)
+{
+    Utility::Set(obj, bufferName, Nan::CopyBuffer(reinterpret_cast<const char *>(nativeData), length).ToLocalChecked());
+
+    // The array is created from the Buffer the first time it is read
+    Nan::SetAccessor(obj, InternedStrings::get(name), ValueArrayGetter, ValueArraySetter, InternedStrings::get(bufferName));
+}
+
+NAN_GETTER(ConversionUtility::ValueArrayGetter)
+{
+    auto buffer = Nan::Get(info.This(), info.Data()).ToLocalChecked();
+
+    if (!node::Buffer::HasInstance(buffer))
+    {
+        return;
+    }
+
+    auto length = std::min(node::Buffer::Length(buffer), static_cast<size_t>(UINT16_MAX));
+    auto valueArray = ConversionUtility::toJsValueArray(reinterpret_cast<uint8_t *>(node::Buffer::Data(buffer)), static_cast<uint16_t>(length));
+
+    // Replace the accessor with the created array, so that it is only created once
+    Nan::ForceSet(info.This(), property, valueArray);
+    info.GetReturnValue().Set(valueArray);
+}
+
+NAN_SETTER(ConversionUtility::ValueArraySetter)
+{
+    Nan::ForceSet(info.This(), property, value);
+}
+
 v8::Handle<v8::Value> ConversionUtility::toJsString(const char *cString)
 {
     return ConversionUtility::toJsString(cString, strlen(cString));
@@ -500,9 +621,9 @@ v8::Handle<v8::Value> ConversionUtility::toJsString(std::string string)
     return scope.Escape(Nan::New<v8::String>(string).ToLocalChecked());
 }
 
-const char * ConversionUtility::valueToString(uint16_t value, name_map_t name_map, const char *defaultValue)
+const char * ConversionUtility::valueToString(uint16_t value, const name_map_t &name_map, const char *defaultValue)
 {
-    name_map_it_t it = name_map.find(value);
+    name_map_const_it_t it = name_map.find(value);
 
     if (it == name_map.end())
     {
@@ -512,17 +633,17 @@ const char * ConversionUtility::valueToString(uint16_t value, name_map_t name_ma
     return it->second;
 }
 
-v8::Handle<v8::Value> ConversionUtility::valueToJsString(uint16_t value, name_map_t name_map, v8::Handle<v8::Value> defaultValue)
+v8::Handle<v8::Value> ConversionUtility::valueToJsString(uint16_t value, const name_map_t &name_map, v8::Handle<v8::Value> defaultValue)
 {
     Nan::EscapableHandleScope scope;
-    name_map_it_t it = name_map.find(value);
+    name_map_const_it_t it = name_map.find(value);
 
     if (it == name_map.end())
     {
         return defaultValue;
     }
 
-    return scope.Escape(Nan::New<v8::String>(it->second).ToLocalChecked());
+    return scope.Escape(InternedStrings::get(it->second));
 }
 
 v8::Local<v8::Function> ConversionUtility::getCallbackFunction(v8::Local<v8::Object> js, const char *name)
@@ -607,10 +728,90 @@ v8::Handle<v8::Value> ConversionUtility::encodeHex(const char *text, int length)
     return ConversionUtility::toJsString(encoded.str());
 }
 
+namespace
+{
+    struct CStringHash
+    {
+        size_t operator()(const char *string) const
+        {
+            // FNV-1a
+            size_t hash = 2166136261u;
+
+            for (; *string != '\0'; string++)
+            {
+                hash = (hash ^ static_cast<uint8_t>(*string)) * 16777619u;
+            }
+
+            return hash;
+        }
+    };
+
+    struct CStringEqual
+    {
+        bool operator()(const char *a, const char *b) const
+        {
+            return strcmp(a, b) == 0;
+        }
+    };
+
+    // The keys are copies of the strings owned by the cache
+    typedef std::unordered_map<const char *, v8::Eternal<v8::String>, CStringHash, CStringEqual> interned_strings_t;
+
+    std::mutex internedStringsMutex;
+    std::map<v8::Isolate *, interned_strings_t *> internedStringsPerIsolate;
+
+    interned_strings_t *internedStrings(v8::Isolate *isolate)
+    {
+        // Events are converted in one isolate, avoid taking the lock for every string
+        thread_local v8::Isolate *lastIsolate = nullptr;
+        thread_local interned_strings_t *lastStrings = nullptr;
+
+        if (isolate == lastIsolate)
+        {
+            return lastStrings;
+        }
+
+        std::lock_guard<std::mutex> lock(internedStringsMutex);
+        auto &strings = internedStringsPerIsolate[isolate];
+
+        if (strings == nullptr)
+        {
+            strings = new interned_strings_t();
+        }
+
+        lastIsolate = isolate;
+        lastStrings = strings;
+
+        return strings;
+    }
+}
+
+v8::Local<v8::String> InternedStrings::get(const char *string)
+{
+    auto isolate = v8::Isolate::GetCurrent();
+    auto strings = internedStrings(isolate);
+    auto it = strings->find(string);
+
+    if (it != strings->end())
+    {
+        return it->second.Get(isolate);
+    }
+
+    auto internalized = v8::String::NewFromUtf8(isolate, string, v8::NewStringType::kInternalized).ToLocalChecked();
+
+    auto length = strlen(string);
+    auto key = new char[length + 1];
+    memcpy(key, string, length + 1);
+
+    strings->emplace(key, v8::Eternal<v8::String>(isolate, internalized));
+
+    return internalized;
+}
+
 v8::Local<v8::Value> Utility::Get(v8::Local<v8::Object> jsobj, const char *name)
 {
     Nan::EscapableHandleScope scope;
-    return scope.Escape(Nan::Get(jsobj, Nan::New(name).ToLocalChecked()).ToLocalChecked());
+    return scope.Escape(Nan::Get(jsobj, InternedStrings::get(name)).ToLocalChecked());
 }
 
 v8::Local<v8::Value> Utility::Get(v8::Local<v8::Object> jsobj, const int index)
@@ -678,12 +879,12 @@ bool Utility::Set(v8::Handle<v8::Object> target, const char *name, std::string v
 
 bool Utility::Set(v8::Handle<v8::Object> target, const char *name, v8::Local<v8::Value> value)
 {
-    return Nan::Set(target, Nan::New(name).ToLocalChecked(), value).FromMaybe(false);
+    return Nan::Set(target, InternedStrings::get(name), value).FromMaybe(false);
 }
 
 bool Utility::Has(v8::Handle<v8::Object> target, const char *name)
 {
-    return target->Has(Nan::New(name).ToLocalChecked());
+    return target->Has(InternedStrings::get(name));
 }
 
 void Utility::SetReturnValue(Nan::NAN_METHOD_ARGS_TYPE info, v8::Local<v8::Object> value)
@@ -14,11 +14,14 @@
 #define SD_COMMON_H
 
 #include <nan.h>
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "sd_rpc.h"
+#include "baton_pool.h"
 
 #define NAME_MAP_ENTRY(EXP) { EXP, ""#EXP"" }
 #define ERROR_STRING_SIZE 1024
@@ -33,6 +36,7 @@
 // Typedef of name to string with enum name, covers most cases
 typedef std::map<uint16_t, const char*> name_map_t;
 typedef std::map<uint16_t, const char*>::iterator name_map_it_t;
+typedef std::map<uint16_t, const char*>::const_iterator name_map_const_it_t;
 
 extern adapter_t *connectedAdapters[];
 extern int adapterCount;
@@ -73,6 +77,15 @@ public:
     }
 };
 
+// Internalized V8 strings for property names and other constant strings, created once per isolate.
+// The strings are looked up by content, so any C string may be used, but the cache is never emptied
+// and must only be used for strings from a limited set.
+class InternedStrings
+{
+public:
+    static v8::Local<v8::String> get(const char *string);
+};
+
 class Utility
 {
 public:
@@ -104,6 +117,13 @@ public:
     static bool EnsureAsciiNumbers(uint8_t *value, const int length);
 };
 
+// Time an event was read from the serial port, sent to JavaScript as the event properties time and timestamp
+struct EventTime
+{
+    double time;      // Wall clock time, milliseconds since epoch
+    double timestamp; // Monotonic time, nanoseconds since the adapter was opened
+};
+
 template<typename EventType>
 class BleDriverEvent : public BleToJs<EventType>
 {
@@ -116,15 +136,15 @@ protected:
     }
 
     uint16_t evt_id;
-    std::string timestamp;
+    EventTime time;
     uint16_t conn_handle;
     EventType *evt;
 
 public:
-    BleDriverEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, EventType *evt)
+    BleDriverEvent(uint16_t evt_id, const EventTime &time, uint16_t conn_handle, EventType *evt)
         : BleToJs<EventType>(0),
         evt_id(evt_id),
-        timestamp(timestamp),
+        time(time),
         conn_handle(conn_handle),
         evt(evt)
     {
@@ -133,8 +153,9 @@ public:
     virtual void ToJs(v8::Local<v8::Object> obj)
     {
         Utility::Set(obj, "id", evt_id);
-        Utility::Set(obj, "name", getEventName());
-        Utility::Set(obj, "time", timestamp);
+        Utility::Set(obj, "name", static_cast<v8::Local<v8::Value>>(InternedStrings::get(getEventName())));
+        Utility::Set(obj, "time", time.time);
+        Utility::Set(obj, "timestamp", time.timestamp);
         Utility::Set(obj, "conn_handle", conn_handle);
     }
 
@@ -146,29 +167,44 @@ public:
 struct Baton {
 public:
     explicit Baton(v8::Local<v8::Function> cb) {
-        req = new uv_work_t();
+        req = &work;
         callback = new Nan::Callback(cb);
         req->data = static_cast<void*>(this);
     }
 
-    ~Baton()
+    // Virtual so that batons of commands dropped by the adapter executor are deleted as their own type
+    virtual ~Baton()
     {
         delete callback;
     }
 
+    // Batons are allocated from BatonPool
+    static void *operator new(size_t size)
+    {
+        return BatonPool::allocate(size);
+    }
+
+    static void operator delete(void *pointer)
+    {
+        BatonPool::release(pointer);
+    }
+
+    uv_work_t work;
     uv_work_t *req;
     Nan::Callback *callback;
+    std::vector<uint8_t> copied; // Data the parameters of the call point into, see getCopiedPointerToUint8
 
     int result;
     adapter_t *adapter;
 };
 
 const std::string getCurrentTimeInMilliseconds();
+const std::string getTimeInMilliseconds(std::chrono::system_clock::time_point time);
 
 uint16_t uint16_decode(const uint8_t *p_encoded_data);
 uint32_t uint32_decode(const uint8_t *p_encoded_data);
 
-uint16_t fromNameToValue(name_map_t names, const char *name);
+uint16_t fromNameToValue(const name_map_t &names, const char *name);
 
 template<typename NativeType>
 class ConvUtil
@@ -265,13 +301,22 @@ public:
     static bool         getBool(v8::Local<v8::Value>js);
     static uint8_t *    getNativePointerToUint8(v8::Local<v8::Object>js, const char *name);
     static uint8_t *    getNativePointerToUint8(v8::Local<v8::Value>js);
+    // Pointer to the bytes of a Buffer or Uint8Array of at least length bytes, without copying them. Arrays and
+    // shorter views are copied to a new Buffer. reference is set to the value pointed into, and must be kept
+    // until the pointer is no longer used.
+    static uint8_t *    getBorrowedPointerToUint8(v8::Local<v8::Object>js, const char *name, uint16_t length, Nan::Persistent<v8::Value> &reference);
+    static uint8_t *    getBorrowedPointerToUint8(v8::Local<v8::Value>js, uint16_t length, Nan::Persistent<v8::Value> &reference);
+    // Copy of the bytes of a Buffer, Uint8Array or array in storage, zero padded to at least length bytes. Views
+    // are copied in one block, so the value may be changed by the caller as soon as the call returns.
+    static uint8_t *    getCopiedPointerToUint8(v8::Local<v8::Object>js, const char *name, uint16_t length, std::vector<uint8_t> &storage);
+    static uint8_t *    getCopiedPointerToUint8(v8::Local<v8::Value>js, uint16_t length, std::vector<uint8_t> &storage);
     static uint16_t *   getNativePointerToUint16(v8::Local<v8::Object>js, const char *name);
     static uint16_t *   getNativePointerToUint16(v8::Local<v8::Value>js);
     static v8::Local<v8::Object> getJsObject(v8::Local<v8::Object>js, const char *name);
     static v8::Local<v8::Object> getJsObject(v8::Local<v8::Value>js);
     static v8::Local<v8::Object> getJsObjectOrNull(v8::Local<v8::Object>js, const char *name);
     static v8::Local<v8::Object> getJsObjectOrNull(v8::Local<v8::Value>js);
-    static uint16_t     stringToValue(name_map_t name_map, v8::Local<v8::Object> string, uint16_t defaultValue = -1);
+    static uint16_t     stringToValue(const name_map_t &name_map, v8::Local<v8::Object> string, uint16_t defaultValue = -1);
     static std::string  getNativeString(v8::Local<v8::Object>js, const char *name);
     static std::string  getNativeString(v8::Local<v8::Value> js);
 
@@ -289,12 +334,15 @@ public:
     static v8::Handle<v8::Value> toJsBool(uint8_t nativeValue);
     static v8::Handle<v8::Value> toJsValueArray(uint8_t *nativeValue, uint16_t length);
 	static v8::Handle<v8::Value> toJsValueArray(const uint8_t *nativeValue, uint16_t length);
+    // Sets bufferName to a Buffer with a copy of the bytes, and name to an Array of the bytes that is only created
+    // if it is read. Reading only the Buffer avoids creating one JavaScript number per byte.
+    static void setValueBuffer(v8::Local<v8::Object> obj, const char *name, const char *bufferName, const uint8_t *nativeValue, uint16_t length);
     static v8::Handle<v8::Value> toJsString(const char *cString);
     static v8::Handle<v8::Value> toJsString(const char *cString, uint16_t length);
     static v8::Handle<v8::Value> toJsString(uint8_t *cString, uint16_t length);
     static v8::Handle<v8::Value> toJsString(std::string string);
-    static const char *          valueToString(uint16_t value, name_map_t name_map, const char *defaultValue = "Unknown value");
-    static v8::Handle<v8::Value> valueToJsString(uint16_t, name_map_t name_map, v8::Handle<v8::Value> defaultValue = Nan::New<v8::String>("Unknown value").ToLocalChecked());
+    static const char *          valueToString(uint16_t value, const name_map_t &name_map, const char *defaultValue = "Unknown value");
+    static v8::Handle<v8::Value> valueToJsString(uint16_t, const name_map_t &name_map, v8::Handle<v8::Value> defaultValue = Nan::New<v8::String>("Unknown value").ToLocalChecked());
 
     static v8::Local<v8::Function> getCallbackFunction(v8::Local<v8::Object> js, const char *name);
     static v8::Local<v8::Function> getCallbackFunction(v8::Local<v8::Value> js);
@@ -302,6 +350,14 @@ public:
     static uint8_t extractHexHelper(char text);
     static uint8_t *extractHex(v8::Local<v8::Value> js);
     static v8::Handle<v8::Value> encodeHex(const char *text, int length);
+
+    // Number of bytes in a Buffer, Uint8Array or array of bytes, and a copy of them to destination
+    static size_t getByteLength(v8::Local<v8::Value> js);
+    static void copyBytes(v8::Local<v8::Value> js, uint8_t *destination);
+
+private:
+    static NAN_GETTER(ValueArrayGetter);
+    static NAN_SETTER(ValueArraySetter);
 };
 
 class ErrorMessage
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <iomanip>
 #include <algorithm>
 
 #include "sd_rpc.h"
@@ -25,6 +26,7 @@
 #include "driver_gattc.h"
 #include "driver_gatts.h"
 #include "driver_uecc.h"
+#include "event_batch.h"
 
 using namespace std;
 
@@ -36,9 +38,9 @@ Adapter *adapterBeingOpened = nullptr;
     case BLE_EVT_##evt_enum:                                                                                         \
     {                                                                                                                \
         ble_common_evt_t common_event = eventEntry->event->evt.common_evt;                                           \
-        std::string timestamp = eventEntry->timestamp;                                                               \
+        auto time = eventTime(eventEntry);                                                                           \
         v8::Local<v8::Value> js_event =                                                                              \
-            Common##evt_to_js##Event(timestamp, common_event.conn_handle, &(common_event.params.params_name)).ToJs();\
+            Common##evt_to_js##Event(time, common_event.conn_handle, &(common_event.params.params_name)).ToJs();     \
         Nan::Set(event_array, event_array_idx, js_event);                                                            \
         break;                                                                                                       \
     }
@@ -49,9 +51,9 @@ Adapter *adapterBeingOpened = nullptr;
     case BLE_GAP_EVT_##evt_enum:                                                                                     \
     {                                                                                                                \
         ble_gap_evt_t gap_event = eventEntry->event->evt.gap_evt;                                                    \
-        std::string timestamp = eventEntry->timestamp;                                                               \
+        auto time = eventTime(eventEntry);                                                                           \
         v8::Local<v8::Object> js_event =                                                                             \
-            Gap##evt_to_js(timestamp, gap_event.conn_handle, &(gap_event.params.params_name)).ToJs();                \
+            Gap##evt_to_js(time, gap_event.conn_handle, &(gap_event.params.params_name)).ToJs();                     \
         Nan::Set(event_array, event_array_idx, js_event);                                                            \
         break;                                                                                                       \
     }
@@ -61,9 +63,9 @@ Adapter *adapterBeingOpened = nullptr;
     case BLE_GATTC_EVT_##evt_enum:                                                                                   \
     {                                                                                                                \
         ble_gattc_evt_t *gattc_event = &(eventEntry->event->evt.gattc_evt);                                          \
-        std::string timestamp = eventEntry->timestamp;                                                               \
+        auto time = eventTime(eventEntry);                                                                           \
         v8::Local<v8::Value> js_event =                                                                              \
-            Gattc##evt_to_js##Event(timestamp, gattc_event->conn_handle, gattc_event->gatt_status, gattc_event->error_handle, &(gattc_event->params.params_name)).ToJs(); \
+            Gattc##evt_to_js##Event(time, gattc_event->conn_handle, gattc_event->gatt_status, gattc_event->error_handle, &(gattc_event->params.params_name)).ToJs(); \
         Nan::Set(event_array, event_array_idx, js_event);                                                            \
         break;                                                                                                       \
     }
@@ -73,9 +75,9 @@ Adapter *adapterBeingOpened = nullptr;
     case BLE_GATTS_EVT_##evt_enum:                                                                                   \
     {                                                                                                                \
         ble_gatts_evt_t *gatts_event = &(eventEntry->event->evt.gatts_evt);                                          \
-        std::string timestamp = eventEntry->timestamp;                                                               \
+        auto time = eventTime(eventEntry);                                                                           \
         v8::Local<v8::Value> js_event =                                                                              \
-            Gatts##evt_to_js##Event(timestamp, gatts_event->conn_handle, &(gatts_event->params.params_name)).ToJs(); \
+            Gatts##evt_to_js##Event(time, gatts_event->conn_handle, &(gatts_event->params.params_name)).ToJs();      \
         Nan::Set(event_array, event_array_idx, js_event);                                                            \
         break;                                                                                                       \
     }
@@ -158,12 +160,34 @@ void Adapter::dispatchEvents()
 
 void Adapter::eventIntervalCallback(uv_timer_t *handle)
 {
-    dispatchEvents();
+    if (eventInterval > 0)
+    {
+        dispatchEvents();
+        return;
+    }
+
+    // The latency budget of an adaptive batch has expired
+    Nan::HandleScope scope;
+    sendEventQueueStatus();
+    sendEventBatch();
+}
+
+static uint64_t steadyClockNanoseconds()
+{
+    auto now = chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(now).count());
+}
+
+static uint64_t latencySince(uint64_t startTime)
+{
+    auto now = steadyClockNanoseconds();
+    return now > startTime ? now - startTime : 0;
 }
 
 static void sd_rpc_on_event(adapter_t *adapter, ble_evt_t *event)
 {
-    // The lifecycle for the event is controlled by the driver. We must not free any memory related to the incoming event.
+    // The lifecycle for the event is controlled by the driver. We must not free any memory related to the incoming event,
+    // events kept after this callback are retained with sd_rpc_evt_retain and released with sd_rpc_evt_release.
 
     if (event == nullptr)
     {
@@ -185,6 +209,16 @@ static void sd_rpc_on_event(adapter_t *adapter, ble_evt_t *event)
 
 void Adapter::appendEvent(ble_evt_t *event)
 {
+    // Credits of application packets are returned without waiting for the NodeJS thread
+    txCredits.onEvent(event);
+    notificationStreams.onEvent(event);
+
+    // The responses of a native discovery continue it from this thread and are not passed on
+    if (gattDiscovery.onEvent(event))
+    {
+        return;
+    }
+
     eventCallbackCount += 1;
     eventCallbackBatchEventCounter += 1;
 
@@ -193,21 +227,46 @@ void Adapter::appendEvent(ble_evt_t *event)
         eventCallbackMaxCount = eventCallbackBatchEventCounter;
     }
 
-    // Allocate memory to store decoded event including an unkown quantity of padding, use the same size as serialization_transport.cpp
-    const int size = 512;
+    // The entry may be taken by the NodeJS thread as soon as it is queued, so the read time is kept here
+    uint64_t readTime;
+
+    if (sd_rpc_evt_read_time(adapter, event, &readTime) != NRF_SUCCESS)
+    {
+        readTime = steadyClockNanoseconds();
+    }
 
-    auto evt = malloc(size);
-    memset(evt, 0, size);
-    memcpy(evt, event, size);
+    // Advertising reports rejected by the scan filter are left to the driver to release
+    if (event->header.evt_id == BLE_GAP_EVT_ADV_REPORT && !advReportFilter.accept(event->evt.gap_evt.params.adv_report, readTime))
+    {
+        return;
+    }
+
+    // Take ownership of the event decoded by the driver instead of copying it. It is released when converted to JavaScript.
+    if (sd_rpc_evt_retain(adapter, event) != NRF_SUCCESS)
+    {
+        std::cerr << "Not able to retain event " << event->header.evt_id << ", event is dropped." << std::endl;
+        return;
+    }
 
     auto eventEntry = new EventEntry();
-    eventEntry->event = static_cast<ble_evt_t*>(evt);
-    eventEntry->timestamp = getCurrentTimeInMilliseconds();
+    eventEntry->event = event;
+    eventEntry->readTime = readTime;
 
-    eventQueue.push(eventEntry);
+    uint32_t count;
 
-    // If the event interval is not set, send the events to NodeJS as soon as possible.
-    if (eventInterval == 0)
+    if (!eventQueue.push(eventEntry, count))
+    {
+        // The drop is counted by the queue and reported by getStats
+        sd_rpc_evt_release(event);
+        delete eventEntry;
+        return;
+    }
+
+    sd_rpc_latency_record(adapter, SD_RPC_LATENCY_EVENT_QUEUED, latencySince(readTime));
+
+    // If the event interval is not set, wake up the NodeJS thread for the first event of a batch and when the batch is full,
+    // it decides in deferEventBatch when to send the batch. Without a latency budget the events are sent as soon as possible.
+    if (eventInterval == 0 && (eventBatchMaxLatency == 0 || count == 1 || count >= eventBatchMaxCount))
     {
         dispatchEvents();
     }
@@ -218,126 +277,318 @@ void Adapter::onRpcEvent(uv_async_t *handle)
 {
     Nan::HandleScope scope;
 
+    sendEventQueueStatus();
+
+    if (deferEventBatch())
+    {
+        return;
+    }
+
+    sendEventBatch();
+}
+
+// Events are sent as soon as possible when the adapter is quiet, that is when the previous batch was sent longer ago
+// than the latency budget. Under load the events are held back until eventBatchMaxCount events are queued or the
+// oldest of them has waited for eventBatchMaxLatency ms, so that more events are sent with each callback.
+bool Adapter::deferEventBatch()
+{
+    if (eventInterval > 0 || eventBatchMaxLatency == 0)
+    {
+        return false;
+    }
+
+    uint32_t count;
+    uint64_t oldestReadTime;
+
+    if (!eventQueue.getBacklog(count, oldestReadTime) || count >= eventBatchMaxCount)
+    {
+        return false;
+    }
+
+    auto now = steadyClockNanoseconds();
+    auto budget = static_cast<uint64_t>(eventBatchMaxLatency) * 1000000;
+    auto age = now > oldestReadTime ? now - oldestReadTime : 0;
+
+    if (now - lastEventBatchTime >= budget || age >= budget)
+    {
+        return false;
+    }
+
+    // Rounded up to whole ms so that the timer does not expire before the budget
+    return startEventBatchTimer((budget - age + 999999) / 1000000);
+}
+
+// Now we are in the NodeJS thread. Sends all queued events to JavaScript.
+void Adapter::sendEventBatch()
+{
+    if (eventInterval == 0 && eventIntervalTimer != nullptr)
+    {
+        uv_timer_stop(eventIntervalTimer);
+    }
+
     if (eventQueue.wasEmpty())
     {
         return;
     }
 
-    auto array = Nan::New<v8::Array>();
-    auto arrayIndex = 0;
+    v8::Local<v8::Value> callback_value[2];
+    auto callback_value_count = 1;
+
+    if (eventFormat == EVENT_FORMAT_BINARY)
+    {
+        auto objects = Nan::New<v8::Array>();
+        callback_value[0] = createEventBatch(objects);
+        callback_value[1] = objects;
+        callback_value_count = 2;
+    }
+    else
+    {
+        callback_value[0] = createEventArray();
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+
+    if (eventCallback != nullptr)
+    {
+        eventCallback->Call(callback_value_count, callback_value);
+    }
+    else
+    {
+        std::cerr << "BLE event received, but no callback is registered." << std::endl;
+    }
+
+    auto end = chrono::high_resolution_clock::now();
+
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+    addEventBatchStatistics(duration);
+
+    lastEventBatchTime = steadyClockNanoseconds();
+}
+
+// Pairs the monotonic clock used for event read times with the wall clock
+void Adapter::setClockAnchor()
+{
+    clockAnchorReadTime = steadyClockNanoseconds();
+    clockAnchorTime = chrono::duration<double, std::milli>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+EventTime Adapter::eventTime(const EventEntry *eventEntry) const
+{
+    auto sinceAnchor = static_cast<double>(static_cast<int64_t>(eventEntry->readTime - clockAnchorReadTime));
+    return EventTime{ clockAnchorTime + sinceAnchor / 1e6, sinceAnchor };
+}
+
+// Tells the application when events are received faster than they are handled, so that it can throttle
+// for instance scanning before events are dropped. Called in the NodeJS thread before each event batch.
+void Adapter::sendEventQueueStatus()
+{
+    bool highWatermarkReached;
+    uint32_t count;
 
-    while (!eventQueue.wasEmpty())
+    if (!eventQueue.updateHighWatermark(highWatermarkReached, count) || statusCallback == nullptr)
     {
-        EventEntry *eventEntry = nullptr;
-        eventQueue.pop(eventEntry);
+        return;
+    }
+
+    std::stringstream message;
+    message << count << " events are waiting to be processed";
 
+    v8::Local<v8::Value> argv[1];
+    auto id = highWatermarkReached ? EVENT_QUEUE_HIGH_WATERMARK_REACHED : EVENT_QUEUE_HIGH_WATERMARK_CLEARED;
+    argv[0] = StatusMessage::getStatus(id, message.str(), getCurrentTimeInMilliseconds());
+    statusCallback->Call(1, argv);
+}
+
+// Takes all queued events at once, so that events received while the batch is converted are left for the next batch
+static void takeEventEntries(EventQueue &eventQueue, std::vector<EventEntry *> &eventEntries)
+{
+    eventEntries.clear();
+    eventQueue.takeAll(eventEntries);
+
+    for (auto eventEntry : eventEntries)
+    {
         if (eventEntry == nullptr) {
             std::cerr << "eventEntry from queue is null. Illegal state, terminating." << std::endl;
             std::terminate();
         }
 
-        auto event = eventEntry->event;
-        if (eventEntry == nullptr) {
+        if (eventEntry->event == nullptr) {
             std::cerr << "event from eventEntry is null. Illegal state, terminating." << std::endl;
             std::terminate();
         }
+    }
+}
 
-        if (eventCallback != nullptr)
-        {
-            switch (event->header.evt_id)
-            {
-                COMMON_EVT_CASE(TX_COMPLETE,      TXComplete, tx_complete,      array, arrayIndex, eventEntry);
-                COMMON_EVT_CASE(USER_MEM_REQUEST, MemRequest, user_mem_request, array, arrayIndex, eventEntry);
-                COMMON_EVT_CASE(USER_MEM_RELEASE, MemRelease, user_mem_release, array, arrayIndex, eventEntry);
-
-                GAP_EVT_CASE(CONNECTED,                 Connected,              connected,                  array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(DISCONNECTED,              Disconnected,           disconnected,               array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONN_PARAM_UPDATE,         ConnParamUpdate,        conn_param_update,          array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SEC_PARAMS_REQUEST,        SecParamsRequest,       sec_params_request,         array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SEC_INFO_REQUEST,          SecInfoRequest,         sec_info_request,           array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(PASSKEY_DISPLAY,           PasskeyDisplay,         passkey_display,            array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(KEY_PRESSED,               KeyPressed,             key_pressed,                array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(AUTH_KEY_REQUEST,          AuthKeyRequest,         auth_key_request,           array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(LESC_DHKEY_REQUEST,        LESCDHKeyRequest,       lesc_dhkey_request,         array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(AUTH_STATUS,               AuthStatus,             auth_status,                array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONN_SEC_UPDATE,           ConnSecUpdate,          conn_sec_update,            array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(TIMEOUT,                   Timeout,                timeout,                    array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(RSSI_CHANGED,              RssiChanged,            rssi_changed,               array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(ADV_REPORT,                AdvReport,              adv_report,                 array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SEC_REQUEST,               SecRequest,             sec_request,                array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONN_PARAM_UPDATE_REQUEST, ConnParamUpdateRequest, conn_param_update_request,  array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SCAN_REQ_REPORT,           ScanReqReport,          scan_req_report,            array, arrayIndex, eventEntry);
-
-                GATTC_EVT_CASE(PRIM_SRVC_DISC_RSP,          PrimaryServiceDiscovery,       prim_srvc_disc_rsp,         array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(REL_DISC_RSP,                RelationshipDiscovery,         rel_disc_rsp,               array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(CHAR_DISC_RSP,               CharacteristicDiscovery,       char_disc_rsp,              array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(DESC_DISC_RSP,               DescriptorDiscovery,           desc_disc_rsp,              array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(CHAR_VAL_BY_UUID_READ_RSP,   CharacteristicValueReadByUUID, char_val_by_uuid_read_rsp,  array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(READ_RSP,                    Read,                          read_rsp,                   array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(CHAR_VALS_READ_RSP,          CharacteristicValueRead,       char_vals_read_rsp,         array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(WRITE_RSP,                   Write,                         write_rsp,                  array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(HVX,                         HandleValueNotification,       hvx,                        array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(TIMEOUT,                     Timeout,                       timeout,                    array, arrayIndex, eventEntry);
-
-                GATTS_EVT_CASE(WRITE,                   Write,                  write,              array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(RW_AUTHORIZE_REQUEST,    RWAuthorizeRequest,     authorize_request,  array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(SYS_ATTR_MISSING,        SystemAttributeMissing, sys_attr_missing,   array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(HVC,                     HVC,                    hvc,                array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(TIMEOUT,                 Timeout,                timeout,            array, arrayIndex, eventEntry);
-
-                // Handled special as there is no parameter for this in the event struct.
-                GATTS_EVT_CASE(SC_CONFIRM, SCConfirm, timeout, array, arrayIndex, eventEntry);
-
-            default:
-                std::cerr << "Event " << event->header.evt_id << " unknown to me." << std::endl;
-                break;
-            }
+// The events of a batch are passed to JavaScript together, the delivery time is taken once per batch
+void Adapter::recordDeliveredLatency(const std::vector<EventEntry *> &eventEntries)
+{
+    auto now = steadyClockNanoseconds();
 
-            //Special extra handling of some events:
-            if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
-            {
-                auto keyset = getSecurityKey(event->evt.gap_evt.conn_handle);
+    for (auto eventEntry : eventEntries)
+    {
+        auto latency = now > eventEntry->readTime ? now - eventEntry->readTime : 0;
+        sd_rpc_latency_record(adapter, SD_RPC_LATENCY_EVENT_DELIVERED, latency);
+    }
+}
 
-                v8::Local<v8::Object> obj = Utility::Get(array, arrayIndex)->ToObject();
+// Converts all queued events to one JavaScript object each
+v8::Local<v8::Array> Adapter::createEventArray()
+{
+    Nan::EscapableHandleScope scope;
 
-                if (keyset != 0)
-                {
-                    Utility::Set(obj, "keyset", static_cast<v8::Handle<v8::Value>>(GapSecKeyset(keyset)));
-                }
-                else
-                {
-                    Utility::Set(obj, "keyset", Nan::Null());
-                }
+    auto array = Nan::New<v8::Array>();
+    auto arrayIndex = 0;
 
-                destroySecurityKeyStorage(event->evt.gap_evt.conn_handle);
-            }
+    takeEventEntries(eventQueue, eventBatch);
+    recordDeliveredLatency(eventBatch);
+
+    for (auto eventEntry : eventBatch)
+    {
+        if (eventCallback != nullptr)
+        {
+            eventToJs(eventEntry, array, arrayIndex);
         }
 
         arrayIndex++;
 
         // Free memory for current entry
-        free(eventEntry->event);
+        sd_rpc_evt_release(eventEntry->event);
         delete eventEntry;
     }
 
-    v8::Local<v8::Value> callback_value[1];
-    callback_value[0] = array;
+    eventBatch.clear();
 
-    auto start = chrono::high_resolution_clock::now();
+    return scope.Escape(array);
+}
 
-    if (eventCallback != nullptr)
+// Packs all queued events into one batch with the layout described in event_batch.h.
+// Events without a packed layout are converted to JavaScript objects and added to objects.
+v8::Local<v8::ArrayBuffer> Adapter::createEventBatch(v8::Local<v8::Array> objects)
+{
+    Nan::EscapableHandleScope scope;
+
+    auto batchLength = EventBatch::HEADER_LENGTH;
+
+    takeEventEntries(eventQueue, eventBatch);
+    recordDeliveredLatency(eventBatch);
+
+    for (auto eventEntry : eventBatch)
     {
-        eventCallback->Call(1, callback_value);
+        batchLength += EventBatch::recordLength(eventEntry->event);
     }
-    else
+
+    auto batch = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), batchLength);
+    auto data = static_cast<uint8_t *>(batch->GetContents().Data());
+    auto offset = EventBatch::HEADER_LENGTH;
+    auto objectIndex = 0;
+
+    EventBatch::writeHeader(data, static_cast<uint32_t>(eventBatch.size()));
+
+    for (auto eventEntry : eventBatch)
     {
-        std::cerr << "BLE event received, but no callback is registered." << std::endl;
+        auto event = eventEntry->event;
+        offset += EventBatch::writeRecord(data + offset, event, eventTime(eventEntry).time);
+
+        if (!EventBatch::isPacked(event->header.evt_id))
+        {
+            if (eventCallback != nullptr)
+            {
+                eventToJs(eventEntry, objects, objectIndex);
+            }
+
+            objectIndex++;
+        }
+
+        sd_rpc_evt_release(event);
+        delete eventEntry;
     }
 
-    auto end = chrono::high_resolution_clock::now();
+    eventBatch.clear();
 
-    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    addEventBatchStatistics(duration);
+    return scope.Escape(batch);
+}
+
+void Adapter::eventToJs(EventEntry *eventEntry, v8::Local<v8::Array> array, const uint32_t arrayIndex)
+{
+    auto event = eventEntry->event;
+
+    switch (event->header.evt_id)
+    {
+        COMMON_EVT_CASE(TX_COMPLETE,      TXComplete, tx_complete,      array, arrayIndex, eventEntry);
+        COMMON_EVT_CASE(USER_MEM_REQUEST, MemRequest, user_mem_request, array, arrayIndex, eventEntry);
+        COMMON_EVT_CASE(USER_MEM_RELEASE, MemRelease, user_mem_release, array, arrayIndex, eventEntry);
+
+        GAP_EVT_CASE(CONNECTED,                 Connected,              connected,                  array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(DISCONNECTED,              Disconnected,           disconnected,               array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(CONN_PARAM_UPDATE,         ConnParamUpdate,        conn_param_update,          array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(SEC_PARAMS_REQUEST,        SecParamsRequest,       sec_params_request,         array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(SEC_INFO_REQUEST,          SecInfoRequest,         sec_info_request,           array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(PASSKEY_DISPLAY,           PasskeyDisplay,         passkey_display,            array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(KEY_PRESSED,               KeyPressed,             key_pressed,                array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(AUTH_KEY_REQUEST,          AuthKeyRequest,         auth_key_request,           array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(LESC_DHKEY_REQUEST,        LESCDHKeyRequest,       lesc_dhkey_request,         array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(AUTH_STATUS,               AuthStatus,             auth_status,                array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(CONN_SEC_UPDATE,           ConnSecUpdate,          conn_sec_update,            array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(TIMEOUT,                   Timeout,                timeout,                    array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(RSSI_CHANGED,              RssiChanged,            rssi_changed,               array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(ADV_REPORT,                AdvReport,              adv_report,                 array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(SEC_REQUEST,               SecRequest,             sec_request,                array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(CONN_PARAM_UPDATE_REQUEST, ConnParamUpdateRequest, conn_param_update_request,  array, arrayIndex, eventEntry);
+        GAP_EVT_CASE(SCAN_REQ_REPORT,           ScanReqReport,          scan_req_report,            array, arrayIndex, eventEntry);
+
+        GATTC_EVT_CASE(PRIM_SRVC_DISC_RSP,          PrimaryServiceDiscovery,       prim_srvc_disc_rsp,         array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(REL_DISC_RSP,                RelationshipDiscovery,         rel_disc_rsp,               array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(CHAR_DISC_RSP,               CharacteristicDiscovery,       char_disc_rsp,              array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(DESC_DISC_RSP,               DescriptorDiscovery,           desc_disc_rsp,              array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(CHAR_VAL_BY_UUID_READ_RSP,   CharacteristicValueReadByUUID, char_val_by_uuid_read_rsp,  array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(READ_RSP,                    Read,                          read_rsp,                   array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(CHAR_VALS_READ_RSP,          CharacteristicValueRead,       char_vals_read_rsp,         array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(WRITE_RSP,                   Write,                         write_rsp,                  array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(HVX,                         HandleValueNotification,       hvx,                        array, arrayIndex, eventEntry);
+        GATTC_EVT_CASE(TIMEOUT,                     Timeout,                       timeout,                    array, arrayIndex, eventEntry);
+
+        GATTS_EVT_CASE(WRITE,                   Write,                  write,              array, arrayIndex, eventEntry);
+        GATTS_EVT_CASE(RW_AUTHORIZE_REQUEST,    RWAuthorizeRequest,     authorize_request,  array, arrayIndex, eventEntry);
+        GATTS_EVT_CASE(SYS_ATTR_MISSING,        SystemAttributeMissing, sys_attr_missing,   array, arrayIndex, eventEntry);
+        GATTS_EVT_CASE(HVC,                     HVC,                    hvc,                array, arrayIndex, eventEntry);
+        GATTS_EVT_CASE(TIMEOUT,                 Timeout,                timeout,            array, arrayIndex, eventEntry);
+
+        // Handled special as there is no parameter for this in the event struct.
+        GATTS_EVT_CASE(SC_CONFIRM, SCConfirm, timeout, array, arrayIndex, eventEntry);
+
+    default:
+        std::cerr << "Event " << event->header.evt_id << " unknown to me." << std::endl;
+        break;
+    }
+
+    //Special extra handling of some events:
+    if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
+    {
+        auto keyset = getSecurityKey(event->evt.gap_evt.conn_handle);
+
+        v8::Local<v8::Object> obj = Utility::Get(array, arrayIndex)->ToObject();
+
+        if (keyset != 0)
+        {
+            Utility::Set(obj, "keyset", static_cast<v8::Handle<v8::Value>>(GapSecKeyset(keyset)));
+        }
+        else
+        {
+            Utility::Set(obj, "keyset", Nan::Null());
+        }
+
+        destroySecurityKeyStorage(event->evt.gap_evt.conn_handle);
+    }
+    else if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        // Keys of a pairing that did not complete
+        destroySecurityKeyStorage(event->evt.gap_evt.conn_handle);
+    }
+    else if (event->header.evt_id == BLE_EVT_USER_MEM_RELEASE)
+    {
+        // The mem_block of the event has been converted from the memory, it can be collected now
+        releaseUserMemory(event->evt.common_evt.conn_handle);
+    }
 }
 
 static void sd_rpc_on_status(adapter_t *adapter, sd_rpc_app_status_t id, const char * message)
@@ -495,7 +746,7 @@ NAN_METHOD(Adapter::EnableBLE)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, EnableBLE, reinterpret_cast<uv_after_work_cb>(AfterEnableBLE));
+    obj->commandExecutor.queue(baton->req, EnableBLE, AfterEnableBLE);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -527,7 +778,6 @@ void Adapter::AfterEnableBLE(uv_work_t *req)
     }
 
     baton->callback->Call(3, argv);
-    delete baton->enable_params;
     delete baton;
 }
 
@@ -575,12 +825,19 @@ NAN_METHOD(Adapter::Open)
         baton->retransmission_interval = ConversionUtility::getNativeUint32(options, "retransmissionInterval"); parameter++;
         baton->response_timeout = ConversionUtility::getNativeUint32(options, "responseTimeout"); parameter++;
         baton->enable_ble = ConversionUtility::getBool(options, "enableBLE"); parameter++;
+        baton->transmit_window_size = ConversionUtility::getNativeUint8(options, "transmitWindowSize"); parameter++;
+        baton->event_format = ToEventFormatEnum(Utility::Get(options, "eventFormat")->ToString()); parameter++;
+        baton->event_queue_memory_limit = ConversionUtility::getNativeUint32(options, "eventQueueMemoryLimit"); parameter++;
+        baton->event_queue_high_watermark = ConversionUtility::getNativeUint32(options, "eventQueueHighWatermark"); parameter++;
+        baton->event_batch_max_count = ConversionUtility::getNativeUint32(options, "eventBatchMaxCount"); parameter++;
+        baton->event_batch_max_latency = ConversionUtility::getNativeUint32(options, "eventBatchMaxLatency"); parameter++;
+        baton->event_coalescing = ConversionUtility::getBool(options, "eventCoalescing"); parameter++;
     }
     catch (std::string error)
     {
         std::stringstream errormessage;
         errormessage << "A setup option was wrong. Option: ";
-        const char *_options[] = { "baudrate", "parity", "flowcontrol", "eventInterval", "logLevel", "retransmissionInterval", "responseTimeout", "enableBLE" };
+        const char *_options[] = { "baudrate", "parity", "flowcontrol", "eventInterval", "logLevel", "retransmissionInterval", "responseTimeout", "enableBLE", "transmitWindowSize", "eventFormat", "eventQueueMemoryLimit", "eventQueueHighWatermark", "eventBatchMaxCount", "eventBatchMaxLatency", "eventCoalescing" };
         errormessage << _options[parameter] << ". Reason: " << error;
         Nan::ThrowTypeError(errormessage.str().c_str());
         return;
@@ -619,7 +876,7 @@ NAN_METHOD(Adapter::Open)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, Open, reinterpret_cast<uv_after_work_cb>(AfterOpen));
+    obj->commandExecutor.queue(baton->req, Open, AfterOpen);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -633,7 +890,8 @@ void Adapter::Open(uv_work_t *req)
     baton->mainObject->asyncLog = new uv_async_t();
     baton->mainObject->asyncStatus = new uv_async_t();
 
-    baton->mainObject->initEventHandling(baton->event_callback, baton->evt_interval);
+    baton->mainObject->initEventHandling(baton->event_callback, baton->evt_interval, baton->event_format, baton->event_queue_memory_limit, baton->event_queue_high_watermark,
+                                         baton->event_batch_max_count, baton->event_batch_max_latency, baton->event_coalescing);
     baton->mainObject->initLogHandling(baton->log_callback);
     baton->mainObject->initStatusHandling(baton->status_callback);
 
@@ -644,13 +902,16 @@ void Adapter::Open(uv_work_t *req)
     auto path = baton->path.c_str();
 
     auto uart = sd_rpc_physical_layer_create_uart(path, baton->baud_rate, baton->flow_control, baton->parity);
-    auto h5 = sd_rpc_data_link_layer_create_bt_three_wire(uart, baton->retransmission_interval);
+    auto h5 = sd_rpc_data_link_layer_create_bt_three_wire_windowed(uart, baton->retransmission_interval, baton->transmit_window_size);
     auto serialization = sd_rpc_transport_layer_create(h5, baton->response_timeout);
     auto adapter = sd_rpc_adapter_create(serialization);
 
     baton->adapter = adapter;
     baton->mainObject->adapter = adapter;
 
+    // Messages below the log level are dropped by the driver before they are formatted
+    sd_rpc_log_handler_severity_filter_set(adapter, baton->log_level);
+
     // Clear the statistics
     baton->mainObject->eventCallbackCount = 0;
 
@@ -660,6 +921,8 @@ void Adapter::Open(uv_work_t *req)
     baton->mainObject->eventCallbackBatchEventTotalCount = 0;
     baton->mainObject->eventCallbackBatchNumber = 0;
 
+    baton->mainObject->setClockAnchor();
+
     auto error_code = sd_rpc_open(adapter, sd_rpc_on_status, sd_rpc_on_event, sd_rpc_on_log_event);
 
     // Let the normal log handling handle the rest of the log calls
@@ -741,7 +1004,7 @@ NAN_METHOD(Adapter::Close)
     baton->adapter = obj->adapter;
     baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, Close, reinterpret_cast<uv_after_work_cb>(AfterClose));
+    obj->commandExecutor.queue(baton->req, Close, AfterClose);
 }
 
 void Adapter::Close(uv_work_t *req)
@@ -757,6 +1020,9 @@ void Adapter::AfterClose(uv_work_t *req)
 
     baton->mainObject->cleanUpV8Resources();
 
+    // The discoveries get no more responses, their callbacks are called with the error
+    baton->mainObject->gattDiscovery.failAll(NRF_ERROR_INVALID_STATE);
+
     if (baton->callback != nullptr)
     {
         v8::Local<v8::Value> argv[1];
@@ -803,7 +1069,7 @@ NAN_METHOD(Adapter::AddVendorSpecificUUID)
     baton->p_vs_uuid = BleUUID128(uuid);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, AddVendorSpecificUUID, reinterpret_cast<uv_after_work_cb>(AfterAddVendorSpecificUUID));
+    obj->commandExecutor.queue(baton->req, AddVendorSpecificUUID, AfterAddVendorSpecificUUID);
 }
 
 void Adapter::AddVendorSpecificUUID(uv_work_t *req)
@@ -894,6 +1160,22 @@ NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const v8::Handle<v8::String>&
     return log_severity;
 }
 
+NAN_INLINE event_format_t ToEventFormatEnum(const v8::Handle<v8::String>& v8str)
+{
+    event_format_t event_format = EVENT_FORMAT_OBJECT;
+
+    if (v8str->Equals(Nan::New("object").ToLocalChecked()))
+    {
+        event_format = EVENT_FORMAT_OBJECT;
+    }
+    else if (v8str->Equals(Nan::New("binary").ToLocalChecked()))
+    {
+        event_format = EVENT_FORMAT_BINARY;
+    }
+
+    return event_format;
+}
+
 NAN_METHOD(Adapter::GetVersion)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
@@ -917,7 +1199,7 @@ NAN_METHOD(Adapter::GetVersion)
     baton->version = version;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GetVersion, reinterpret_cast<uv_after_work_cb>(AfterGetVersion));
+    obj->commandExecutor.queue(baton->req, GetVersion, AfterGetVersion);
 
     return;
 }
@@ -947,7 +1229,6 @@ void Adapter::AfterGetVersion(uv_work_t *req)
     }
 
     baton->callback->Call(2, argv);
-    delete baton->version;
     delete baton;
 }
 
@@ -990,7 +1271,7 @@ NAN_METHOD(Adapter::EncodeUUID)
     baton->uuid_le = new uint8_t[16];
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, EncodeUUID, reinterpret_cast<uv_after_work_cb>(AfterEncodeUUID));
+    obj->commandExecutor.queue(baton->req, EncodeUUID, AfterEncodeUUID);
 
     return;
 }
@@ -1024,7 +1305,6 @@ void Adapter::AfterEncodeUUID(uv_work_t *req)
     }
 
     baton->callback->Call(4, argv);
-    delete baton->uuid_le;
     delete baton;
 }
 
@@ -1060,7 +1340,7 @@ NAN_METHOD(Adapter::DecodeUUID)
     baton->p_uuid = new ble_uuid_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, DecodeUUID, reinterpret_cast<uv_after_work_cb>(AfterDecodeUUID));
+    obj->commandExecutor.queue(baton->req, DecodeUUID, AfterDecodeUUID);
 
     return;
 }
@@ -1090,20 +1370,133 @@ void Adapter::AfterDecodeUUID(uv_work_t *req)
     }
 
     baton->callback->Call(2, argv);
-    delete baton->p_uuid;
-    delete baton->uuid_le;
     delete baton;
 }
 
+static const char *eventName(uint16_t evt_id)
+{
+    if (evt_id >= BLE_GATTS_EVT_BASE && evt_id < BLE_L2CAP_EVT_BASE)
+    {
+        return ConversionUtility::valueToString(evt_id, gatts_event_name_map, "Unknown Gatts Event");
+    }
+    else if (evt_id >= BLE_GATTC_EVT_BASE && evt_id < BLE_GATTS_EVT_BASE)
+    {
+        return ConversionUtility::valueToString(evt_id, gattc_event_name_map, "Unknown Gattc Event");
+    }
+    else if (evt_id >= BLE_GAP_EVT_BASE && evt_id < BLE_GATTC_EVT_BASE)
+    {
+        return ConversionUtility::valueToString(evt_id, gap_event_name_map, "Unknown Gap Event");
+    }
+
+    return ConversionUtility::valueToString(evt_id, common_event_name_map, "Unknown Common Event");
+}
+
+static v8::Local<v8::Object> latencyToJs(const sd_rpc_latency_t &latency)
+{
+    auto obj = Nan::New<v8::Object>();
+
+    Utility::Set(obj, "count", static_cast<double>(latency.count));
+    Utility::Set(obj, "min", static_cast<double>(latency.min));
+    Utility::Set(obj, "max", static_cast<double>(latency.max));
+    Utility::Set(obj, "p50", static_cast<double>(latency.p50));
+    Utility::Set(obj, "p99", static_cast<double>(latency.p99));
+    Utility::Set(obj, "p999", static_cast<double>(latency.p999));
+
+    return obj;
+}
+
+// Latencies in nanoseconds of each stage of the event pipeline, and round trip times of the commands keyed by op code
+v8::Local<v8::Object> Adapter::createLatencyHistograms()
+{
+    static const char *stageNames[SD_RPC_LATENCY_STAGE_COUNT] = {
+        "uartRead", "frameComplete", "ackSent", "eventDecoded", "eventQueued", "eventDelivered"
+    };
+
+    auto histograms = Nan::New<v8::Object>();
+    sd_rpc_latency_t latency;
+
+    for (auto stage = 0; stage < SD_RPC_LATENCY_STAGE_COUNT; stage++)
+    {
+        if (sd_rpc_latency_get(adapter, static_cast<sd_rpc_latency_stage_t>(stage), &latency) == NRF_SUCCESS)
+        {
+            Utility::Set(histograms, stageNames[stage], static_cast<v8::Local<v8::Value>>(latencyToJs(latency)));
+        }
+    }
+
+    auto commands = Nan::New<v8::Object>();
+
+    for (auto opCode = 0; opCode <= UINT8_MAX; opCode++)
+    {
+        if (sd_rpc_command_latency_get(adapter, static_cast<uint8_t>(opCode), &latency) != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        std::stringstream name;
+        name << "0x" << std::hex << std::setfill('0') << std::setw(2) << opCode;
+        Utility::Set(commands, name.str().c_str(), static_cast<v8::Local<v8::Value>>(latencyToJs(latency)));
+    }
+
+    Utility::Set(histograms, "commands", static_cast<v8::Local<v8::Value>>(commands));
+
+    return histograms;
+}
+
 NAN_METHOD(Adapter::GetStats)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto stats = Nan::New<v8::Object>();
+    auto histograms = false;
+
+    try
+    {
+        if (info.Length() > 0 && info[0]->IsObject())
+        {
+            auto options = ConversionUtility::getJsObject(info[0]);
+
+            if (Utility::Has(options, "histograms"))
+            {
+                histograms = ConversionUtility::getBool(options, "histograms");
+            }
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
 
     Utility::Set(stats, "eventCallbackTotalTime", obj->getEventCallbackTotalTime());
     Utility::Set(stats, "eventCallbackTotalCount", obj->getEventCallbackCount());
     Utility::Set(stats, "eventCallbackBatchMaxCount", obj->getEventCallbackMaxCount());
     Utility::Set(stats, "eventCallbackBatchAvgCount", obj->getAverageCallbackBatchCount());
+    Utility::Set(stats, "eventQueueMaxCount", obj->eventQueue.getMaxCount());
+    Utility::Set(stats, "eventQueueMaxMemory", static_cast<uint32_t>(obj->eventQueue.getMaxMemory()));
+
+    auto dropCounts = Nan::New<v8::Object>();
+    uint32_t dropTotalCount = 0;
+
+    for (auto &dropCount : obj->eventQueue.getDropCounts())
+    {
+        Utility::Set(dropCounts, eventName(dropCount.first), dropCount.second);
+        dropTotalCount += dropCount.second;
+    }
+
+    Utility::Set(stats, "eventDropCount", static_cast<v8::Local<v8::Value>>(dropCounts));
+    Utility::Set(stats, "eventDropTotalCount", dropTotalCount);
+    Utility::Set(stats, "eventCoalescedCount", obj->eventQueue.getCoalescedCount());
+    Utility::Set(stats, "advReportFilteredCount", obj->advReportFilter.getDroppedCount());
+    Utility::Set(stats, "commandQueueCount", obj->commandExecutor.getPendingCount());
+    Utility::Set(stats, "commandQueueMaxCount", obj->commandExecutor.getMaxPendingCount());
+    Utility::Set(stats, "notificationStreamCount", obj->notificationStreams.getStreamCount());
+    Utility::Set(stats, "gattDiscoveryCount", obj->gattDiscovery.getDiscoveryCount());
+    Utility::Set(stats, "gattCacheEntryCount", obj->gattDiscovery.getCache().getEntryCount());
+
+    if (histograms && obj->adapter != nullptr)
+    {
+        Utility::Set(stats, "histograms", static_cast<v8::Local<v8::Value>>(obj->createLatencyHistograms()));
+    }
 
     Utility::SetReturnValue(info, stats);
 }
@@ -1137,10 +1530,11 @@ NAN_METHOD(Adapter::ReplyUserMemory)
     auto baton = new BleUserMemReplyBaton(callback);
     baton->conn_handle = conn_handle;
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
 
     try
     {
-        baton->p_block = UserMemBlock(mem_block);
+        baton->p_block = UserMemBlock(mem_block, baton->borrowed);
     }
     catch (std::string error)
     {
@@ -1149,7 +1543,7 @@ NAN_METHOD(Adapter::ReplyUserMemory)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, ReplyUserMemory, reinterpret_cast<uv_after_work_cb>(AfterReplyUserMemory));
+    obj->commandExecutor.queue(baton->req, ReplyUserMemory, AfterReplyUserMemory);
 }
 
 void Adapter::ReplyUserMemory(uv_work_t *req)
@@ -1172,10 +1566,15 @@ void Adapter::AfterReplyUserMemory(uv_work_t *req)
     else
     {
         argv[0] = Nan::Undefined();
+
+        if (baton->p_block != nullptr)
+        {
+            // The SoftDevice writes the queued writes to the block until BLE_EVT_USER_MEM_RELEASE
+            baton->mainObject->borrowUserMemory(baton->conn_handle, baton->borrowed);
+        }
     }
 
     baton->callback->Call(1, argv);
-    delete baton->p_block;
     delete baton;
 }
 
@@ -1344,8 +1743,8 @@ ble_user_mem_block_t *UserMemBlock::ToNative()
 
     auto uuid = new ble_user_mem_block_t();
 
-    uuid->p_mem = ConversionUtility::getNativePointerToUint8(jsobj, "mem");
     uuid->len = ConversionUtility::getNativeUint16(jsobj, "len");
+    uuid->p_mem = ConversionUtility::getBorrowedPointerToUint8(jsobj, "mem", uuid->len, *borrowed);
 
     return uuid;
 }
@@ -1761,6 +2160,8 @@ extern "C" {
         NODE_DEFINE_CONSTANT(target, IO_RESOURCES_UNAVAILABLE);
         NODE_DEFINE_CONSTANT(target, RESET_PERFORMED);
         NODE_DEFINE_CONSTANT(target, CONNECTION_ACTIVE);
+        NODE_DEFINE_CONSTANT(target, EVENT_QUEUE_HIGH_WATERMARK_REACHED);
+        NODE_DEFINE_CONSTANT(target, EVENT_QUEUE_HIGH_WATERMARK_CLEARED);
     }
 }
 
@@ -32,6 +32,7 @@ static name_map_t common_event_name_map = {
 NAN_INLINE sd_rpc_parity_t ToParityEnum(const v8::Handle<v8::String>& str);
 NAN_INLINE sd_rpc_flow_control_t ToFlowControlEnum(const v8::Handle<v8::String>& str);
 NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const v8::Handle<v8::String>& str);
+NAN_INLINE event_format_t ToEventFormatEnum(const v8::Handle<v8::String>& str);
 
 class BandwidthCountParameters : public BleToJs<ble_conn_bw_count_t>
 {
@@ -93,11 +94,14 @@ class UserMemBlock : public BleToJs<ble_user_mem_block_t>
 {
 public:
     explicit UserMemBlock(ble_user_mem_block_t *user_mem_block) : BleToJs<ble_user_mem_block_t>(user_mem_block) {}
-    explicit UserMemBlock(v8::Local<v8::Object> js) : BleToJs<ble_user_mem_block_t>(js) {}
+    UserMemBlock(v8::Local<v8::Object> js, Nan::Persistent<v8::Value> &borrowed) : BleToJs<ble_user_mem_block_t>(js), borrowed(&borrowed) {}
     virtual ~UserMemBlock() {}
 
     v8::Local<v8::Object> ToJs() override;
     ble_user_mem_block_t *ToNative() override;
+
+private:
+    Nan::Persistent<v8::Value> *borrowed = nullptr; // Keeps the memory the queued writes are stored in
 };
 
 class BleUUID : public BleToJs<ble_uuid_t>
@@ -129,8 +133,8 @@ private:
     BleDriverCommonEvent() {}
 
 public:
-    BleDriverCommonEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, EventType *evt)
-        : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt)
+    BleDriverCommonEvent(uint16_t evt_id, const EventTime &time, uint16_t conn_handle, EventType *evt)
+        : BleDriverEvent<EventType>(evt_id, time, conn_handle, evt)
     {
     }
 
@@ -150,8 +154,8 @@ public:
 class CommonTXCompleteEvent : BleDriverCommonEvent<ble_evt_tx_complete_t>
 {
 public:
-    CommonTXCompleteEvent(std::string timestamp, uint16_t conn_handle, ble_evt_tx_complete_t *evt)
-        : BleDriverCommonEvent<ble_evt_tx_complete_t>(BLE_EVT_TX_COMPLETE, timestamp, conn_handle, evt) {}
+    CommonTXCompleteEvent(const EventTime &time, uint16_t conn_handle, ble_evt_tx_complete_t *evt)
+        : BleDriverCommonEvent<ble_evt_tx_complete_t>(BLE_EVT_TX_COMPLETE, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs() override;
 };
@@ -159,8 +163,8 @@ public:
 class CommonMemRequestEvent : BleDriverCommonEvent<ble_evt_user_mem_request_t>
 {
 public:
-    CommonMemRequestEvent(std::string timestamp, uint16_t conn_handle, ble_evt_user_mem_request_t *evt)
-        : BleDriverCommonEvent<ble_evt_user_mem_request_t>(BLE_EVT_USER_MEM_REQUEST, timestamp, conn_handle, evt) {}
+    CommonMemRequestEvent(const EventTime &time, uint16_t conn_handle, ble_evt_user_mem_request_t *evt)
+        : BleDriverCommonEvent<ble_evt_user_mem_request_t>(BLE_EVT_USER_MEM_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -168,8 +172,8 @@ public:
 class CommonMemReleaseEvent : BleDriverCommonEvent<ble_evt_user_mem_release_t>
 {
 public:
-    CommonMemReleaseEvent(std::string timestamp, uint16_t conn_handle, ble_evt_user_mem_release_t *evt)
-        : BleDriverCommonEvent<ble_evt_user_mem_release_t>(BLE_EVT_USER_MEM_RELEASE, timestamp, conn_handle, evt) {}
+    CommonMemReleaseEvent(const EventTime &time, uint16_t conn_handle, ble_evt_user_mem_release_t *evt)
+        : BleDriverCommonEvent<ble_evt_user_mem_release_t>(BLE_EVT_USER_MEM_RELEASE, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -195,8 +199,15 @@ public:
     sd_rpc_parity_t parity;
 
     uint32_t evt_interval; // The interval in ms that the event queue is sent to NodeJS
+    event_format_t event_format; // Format of the events sent to NodeJS
+    uint32_t event_queue_memory_limit; // Max number of bytes used by events waiting to be sent to NodeJS
+    uint32_t event_queue_high_watermark; // Number of events waiting to be sent to NodeJS that raises EVENT_QUEUE_HIGH_WATERMARK_REACHED
+    uint32_t event_batch_max_count; // Max number of events sent to NodeJS in one adaptive batch
+    uint32_t event_batch_max_latency; // Max time in ms an event is held back to fill an adaptive batch, 0 sends events immediately
+    bool event_coalescing; // Replace queued events that are superseded by newer events
     uint32_t retransmission_interval; // The interval between each retransmission of packet to target
     uint32_t response_timeout; // Duration to wait for reply on reliable packet sent to target
+    uint8_t transmit_window_size; // Max number of reliable packets sent to target without being acknowledged
 
     bool enable_ble; // Enable BLE or not when connecting, if not the developer must enable the the BLE when state is active
 
@@ -212,6 +223,7 @@ public:
 struct EnableBLEBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(EnableBLEBaton)
+    BATON_DESTRUCTOR(EnableBLEBaton) { delete enable_params; }
     ble_enable_params_t *enable_params;
     uint32_t app_ram_base;
 };
@@ -220,6 +232,7 @@ public:
 struct GetVersionBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GetVersionBaton);
+    BATON_DESTRUCTOR(GetVersionBaton) { delete version; }
     ble_version_t *version;
 
 };
@@ -234,6 +247,7 @@ public:
 class BleUUIDEncodeBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(BleUUIDEncodeBaton);
+    BATON_DESTRUCTOR(BleUUIDEncodeBaton) { delete uuid_le; }
     ble_uuid_t *p_uuid;
     uint8_t uuid_le_len;
     uint8_t *uuid_le;
@@ -242,6 +256,7 @@ public:
 class BleUUIDDecodeBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(BleUUIDDecodeBaton);
+    BATON_DESTRUCTOR(BleUUIDDecodeBaton) { delete p_uuid; delete uuid_le; }
     uint8_t uuid_le_len;
     ble_uuid_t *p_uuid;
     uint8_t *uuid_le;
@@ -250,8 +265,11 @@ public:
 class BleUserMemReplyBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(BleUserMemReplyBaton);
+    BATON_DESTRUCTOR(BleUserMemReplyBaton) { delete p_block; borrowed.Reset(); }
     uint16_t conn_handle;
     ble_user_mem_block_t *p_block;
+    Nan::Persistent<v8::Value> borrowed; // Buffer the block points into, see getBorrowedPointerToUint8
+    Adapter *mainObject;
 };
 
 ///// End Batons ////////////////////////////////////////
@@ -13,6 +13,7 @@
 #include "common.h"
 #include "driver_gap.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <mutex>
@@ -22,15 +23,11 @@
 #include <iostream>
 
 #include "adapter.h"
+#include "ad_structures.h"
 
 extern adapter_t *connectedAdapters[];
 extern int adapterCount;
 
-#define UUID_16_BIT_STR_SIZE 4
-#define UUID_128_BIT_STR_SIZE 36
-#define UUID_16_BIT_SPRINTF "%04X"
-#define UUID_128_BIT_SPRINTF "%04X%04X-0000-1000-8000-00805F9B34FB"
-#define UUID_128_BIT_COMPLETE_SPRINTF "%04X%04X-%04X-%04X-%04X-%04X%04X%04X"
 
 #pragma region Name Map entries to enable constants (value and name) from C in JavaScript
 
@@ -105,6 +102,7 @@ static name_map_t gap_ad_type_map =
     NAME_MAP_ENTRY(BLE_GAP_AD_TYPE_SIMPLE_PAIRING_RANDOMIZER_R256),
     NAME_MAP_ENTRY(BLE_GAP_AD_TYPE_SERVICE_DATA_32BIT_UUID),
     NAME_MAP_ENTRY(BLE_GAP_AD_TYPE_SERVICE_DATA_128BIT_UUID),
+    NAME_MAP_ENTRY(BLE_GAP_AD_TYPE_URI),
     NAME_MAP_ENTRY(BLE_GAP_AD_TYPE_3D_INFORMATION_DATA),
     NAME_MAP_ENTRY(BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA)
 };
@@ -218,7 +216,7 @@ v8::Local<v8::Object> GapAddr::ToJs()
     sprintf(addr, "%02X:%02X:%02X:%02X:%02X:%02X", ptr[5], ptr[4], ptr[3], ptr[2], ptr[1], ptr[0]);
 
     Utility::Set(obj, "address", addr);
-    Utility::Set(obj, "type", gap_addr_type_map[native->addr_type]);
+    Utility::Set(obj, "type", static_cast<v8::Local<v8::Value>>(InternedStrings::get(gap_addr_type_map[native->addr_type])));
 
     free(addr);
 
@@ -487,6 +485,132 @@ ble_gap_scan_params_t *GapScanParams::ToNative()
 
 #pragma endregion GapScanParams
 
+#pragma region GapScanFilter
+
+// Reads an optional array of strings
+static std::vector<std::string> getStringArray(v8::Local<v8::Object> js, const char *name)
+{
+    std::vector<std::string> strings;
+
+    if (!Utility::Has(js, name))
+    {
+        return strings;
+    }
+
+    auto value = Utility::Get(js, name);
+
+    if (!value->IsArray())
+    {
+        throw std::string("Failed to get property ") + name + ": array";
+    }
+
+    auto array = v8::Local<v8::Array>::Cast(value);
+
+    for (uint32_t i = 0; i < array->Length(); i++)
+    {
+        auto element = array->Get(Nan::New(i));
+
+        if (!element->IsString())
+        {
+            throw std::string("Failed to get property ") + name + ": array of strings";
+        }
+
+        strings.push_back(std::string(*Nan::Utf8String(element)));
+    }
+
+    return strings;
+}
+
+AdvReportFilterSettings *GapScanFilter::ToNative()
+{
+    if (Utility::IsNull(jsobj))
+    {
+        return nullptr;
+    }
+
+    AdvReportFilterSettings settings;
+    uint64_t address;
+    adv_uuid_t uuid;
+
+    for (auto &text : getStringArray(jsobj, "addresses"))
+    {
+        if (!AdvReportFilter::parseAddress(text, address))
+        {
+            throw std::string("Invalid address in addresses: ") + text;
+        }
+
+        settings.allowedAddresses.insert(address);
+    }
+
+    for (auto &text : getStringArray(jsobj, "excludeAddresses"))
+    {
+        if (!AdvReportFilter::parseAddress(text, address))
+        {
+            throw std::string("Invalid address in excludeAddresses: ") + text;
+        }
+
+        settings.deniedAddresses.insert(address);
+    }
+
+    for (auto &text : getStringArray(jsobj, "serviceUuids"))
+    {
+        if (!AdvReportFilter::parseUuid(text, uuid))
+        {
+            throw std::string("Invalid UUID in serviceUuids: ") + text;
+        }
+
+        settings.serviceUuids.push_back(uuid);
+    }
+
+    if (Utility::Has(jsobj, "manufacturerIds"))
+    {
+        auto value = Utility::Get(jsobj, "manufacturerIds");
+
+        if (!value->IsArray())
+        {
+            throw std::string("Failed to get property manufacturerIds: array");
+        }
+
+        auto array = v8::Local<v8::Array>::Cast(value);
+
+        for (uint32_t i = 0; i < array->Length(); i++)
+        {
+            auto element = array->Get(Nan::New(i));
+
+            if (!element->IsNumber())
+            {
+                throw std::string("Failed to get property manufacturerIds: array of numbers");
+            }
+
+            settings.manufacturerIds.insert(static_cast<uint16_t>(element->Uint32Value()));
+        }
+    }
+
+    if (Utility::Has(jsobj, "namePrefix"))
+    {
+        settings.namePrefix = ConversionUtility::getNativeString(jsobj, "namePrefix");
+    }
+
+    if (Utility::Has(jsobj, "minRssi"))
+    {
+        settings.minRssi = static_cast<int16_t>(ConversionUtility::getNativeInt32(jsobj, "minRssi"));
+    }
+
+    if (Utility::Has(jsobj, "deduplicate"))
+    {
+        settings.deduplicate = ConversionUtility::getBool(jsobj, "deduplicate");
+    }
+
+    if (Utility::Has(jsobj, "refreshPeriod"))
+    {
+        settings.refreshPeriod = ConversionUtility::getNativeUint32(jsobj, "refreshPeriod");
+    }
+
+    return new AdvReportFilterSettings(settings);
+}
+
+#pragma endregion GapScanFilter
+
 #pragma region GapSecKdist
 
 v8::Local<v8::Object> GapSecKdist::ToJs()
@@ -1190,160 +1314,116 @@ v8::Local<v8::Object> GapAdvReport::ToJs()
 
     if (this->evt->scan_rsp != 1)
     {
-        Utility::Set(obj, "adv_type", gap_adv_type_map[this->evt->type]); // TODO: add support for non defined adv types
+        Utility::Set(obj, "adv_type", static_cast<v8::Local<v8::Value>>(InternedStrings::get(gap_adv_type_map[this->evt->type]))); // TODO: add support for non defined adv types
     }
 
     uint8_t dlen = this->evt->dlen;
+    Utility::Set(obj, "raw", Nan::CopyBuffer(reinterpret_cast<char *>(evt->data), dlen).ToLocalChecked());
 
     if (dlen != 0)
     {
-        // Attach a scan_rsp object to the adv_report
-        v8::Local<v8::Object> data_obj = Nan::New<v8::Object>();
-        Utility::Set(obj, "data", data_obj);
+        // The data object is created from raw the first time it is read
+        Nan::SetAccessor(obj, InternedStrings::get("data"), DataGetter, DataSetter);
+    }
 
-        auto data = evt->data;
+    return scope.Escape(obj);
+}
 
-        // TODO: Evaluate if buffer is the correct datatype for advertisement data
-        //Utility::Set(data_obj, "raw", ConversionUtility::toJsValueArray(data, dlen));
+NAN_GETTER(GapAdvReport::DataGetter)
+{
+    auto raw = Utility::Get(info.This(), "raw");
 
-        uint8_t pos = 0;  // Position in packet
-        uint8_t ad_len;   // AD Type length
-        uint8_t ad_type;  // AD Type
+    if (!node::Buffer::HasInstance(raw))
+    {
+        return;
+    }
 
-        // Parse the adv/scan_rsp data (31 octets)
-        while (pos < dlen)
-        {
-            ad_len = data[pos]; // Advertisement Type length
-            pos++; // Move position to AD Type
+    auto length = std::min(node::Buffer::Length(raw), static_cast<size_t>(UINT8_MAX));
+    auto data_obj = DataToJs(reinterpret_cast<uint8_t *>(node::Buffer::Data(raw)), static_cast<uint8_t>(length));
 
-            if (pos + ad_len > dlen) break; // If length of AD Type is larger than packet, something is wrong, return silently for now.
-            if (ad_len == 0) break; // If length of AD Type is zero, something is wrong, return silently for now.
+    // Replace the accessor with the created object, so that it is only created once
+    Nan::ForceSet(info.This(), property, data_obj);
+    info.GetReturnValue().Set(data_obj);
+}
 
-            ad_type = data[pos]; // Advertisement Type type
+NAN_SETTER(GapAdvReport::DataSetter)
+{
+    Nan::ForceSet(info.This(), property, value);
+}
 
-            if (ad_type == BLE_GAP_AD_TYPE_FLAGS)
-            {
-                v8::Local<v8::Array> flags_array = Nan::New<v8::Array>();
-                auto flags_array_idx = 0;
-                auto flags = data[pos + 1];
+v8::Local<v8::Object> GapAdvReport::DataToJs(const uint8_t *data, uint8_t dlen)
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> data_obj = Nan::New<v8::Object>();
 
-                for (auto iterator = gap_adv_flags_map.begin(); iterator != gap_adv_flags_map.end(); iterator++)
-                {
-                    if ((flags & iterator->first) != 0)
-                    {
-                        Nan::Set(flags_array, Nan::New<v8::Integer>(flags_array_idx), Nan::New(iterator->second).ToLocalChecked());
-                        flags_array_idx++;
-                    }
-                }
+    AdStructures structures(data, dlen);
+    char uuid_as_text[AD_UUID_STR_SIZE + 1];
 
-                Utility::Set(data_obj, gap_ad_type_map[ad_type], flags_array);
-            }
-            else if (ad_type == BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME || ad_type == BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME)
-            {
-                uint8_t name_len = ad_len - 1;
-                uint8_t offset = pos + 1;
-                Utility::Set(data_obj, gap_ad_type_map[ad_type], ConversionUtility::toJsString(reinterpret_cast<char *>(&data[offset]), name_len));
-            }
-            else if (ad_type == BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE || ad_type == BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE)
-            {
-                v8::Local<v8::Array> uuid_array = Nan::New<v8::Array>();
-                uint8_t array_pos = 0;
-                uint8_t sub_pos = pos + 1;
+    for (auto &field : structures)
+    {
+        auto value = structures.value(field);
+        auto ad_type = field.type;
+        v8::Local<v8::Value> field_value;
 
-                // Fetch 16 bit UUIDS and put them into the array
-                for (auto i = 0; i < ad_len - 1; i += 2)
-                {
-                    auto uuid_as_text = static_cast<char*>(malloc(UUID_16_BIT_STR_SIZE + 1));
-                    assert(uuid_as_text != nullptr);
-                    sprintf(uuid_as_text, UUID_16_BIT_SPRINTF, uint16_decode(static_cast<uint8_t*>(data) + sub_pos + i));
-                    Nan::Set(uuid_array, Nan::New<v8::Integer>(array_pos), ConversionUtility::toJsString(uuid_as_text));
-                    free(uuid_as_text);
-                    array_pos++;
-                }
+        if (ad_type == BLE_GAP_AD_TYPE_FLAGS)
+        {
+            v8::Local<v8::Array> flags_array = Nan::New<v8::Array>();
+            auto flags_array_idx = 0;
+            auto flags = value[0];
 
-                Utility::Set(data_obj, gap_ad_type_map[ad_type], uuid_array);
-            }
-            else if (ad_type == BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_MORE_AVAILABLE || ad_type == BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_COMPLETE)
+            for (auto iterator = gap_adv_flags_map.begin(); iterator != gap_adv_flags_map.end(); iterator++)
             {
-                v8::Local<v8::Array> uuid_array = Nan::New<v8::Array>();
-                uint8_t array_pos = 0;
-                uint8_t sub_pos = pos + 1;
-
-                // Fetch 32 bit UUIDS and put them into the array
-                for (auto i = 0; i < ad_len - 1; i += 4)
+                if ((flags & iterator->first) != 0)
                 {
-                    auto uuid_as_text = static_cast<char*>(malloc(UUID_128_BIT_STR_SIZE + 1));
-                    assert(uuid_as_text != nullptr);
-
-                    sprintf(uuid_as_text, UUID_128_BIT_SPRINTF,
-                            uint16_decode(static_cast<uint8_t*>(data) + sub_pos + 2 + i),
-                            uint16_decode(static_cast<uint8_t*>(data) + sub_pos + 0 + i));
-                    Nan::Set(uuid_array, Nan::New<v8::Integer>(array_pos), ConversionUtility::toJsString(uuid_as_text));
-                    free(uuid_as_text);
-                    array_pos++;
+                    Nan::Set(flags_array, Nan::New<v8::Integer>(flags_array_idx), InternedStrings::get(iterator->second));
+                    flags_array_idx++;
                 }
-
-                Utility::Set(data_obj, gap_ad_type_map[ad_type], uuid_array);
             }
-            else if (ad_type == BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE || ad_type == BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE)
-            {
-                v8::Local<v8::Array> uuid_array = Nan::New<v8::Array>();
-                uint8_t array_pos = 0;
-                uint8_t sub_pos = pos + 1;
 
-                // Fetch 128 bit UUIDS and put them into the array
-                for (auto i = 0; i < ad_len - 1; i += 16)
-                {
-                    auto uuid_as_text = static_cast<char*>(malloc(UUID_128_BIT_STR_SIZE + 1));
-                    assert(uuid_as_text != NULL);
-
-                    sprintf(
-                        uuid_as_text,
-                        UUID_128_BIT_COMPLETE_SPRINTF,
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 14)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 12)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 10)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 8)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 6)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 4)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 2)),
-                        uint16_decode(static_cast<uint8_t*>(data) + (sub_pos + i + 0))
-                        );
-                    Nan::Set(uuid_array, Nan::New<v8::Integer>(array_pos), ConversionUtility::toJsString(uuid_as_text));
-                    free(uuid_as_text);
-                    array_pos++;
-                }
+            field_value = flags_array;
+        }
+        else if (ad_type == BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME || ad_type == BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME)
+        {
+            field_value = ConversionUtility::toJsString(reinterpret_cast<const char *>(value), field.length);
+        }
+        else if (AdStructures::isServiceUuidList(ad_type))
+        {
+            auto uuid_len = AdStructures::elementLength(ad_type);
+            auto uuid_count = AdStructures::elementCount(field);
+            v8::Local<v8::Array> uuid_array = Nan::New<v8::Array>(uuid_count);
 
-                Utility::Set(data_obj, gap_ad_type_map[ad_type], uuid_array);
-            }
-            // else if (ad_type == BLE_GAP_AD_TYPE_SERVICE_DATA)
-            // {
-            //     Utility::Set(data_obj, gap_ad_type_map[ad_type], Nan::New<v8::Integer>((data[pos + 1] << 8) + data[pos + 2]));
-            // }
-            else if (ad_type == BLE_GAP_AD_TYPE_TX_POWER_LEVEL)
+            for (auto i = 0; i < uuid_count; i++)
             {
-                if(ad_len - 1 == 1)
-                {
-                    Utility::Set(data_obj, gap_ad_type_map[ad_type], Nan::New<v8::Integer>(data[pos + 1]));
-                } else {
-                    std::cerr << "Wrong length of AD_TYPE :" << gap_ad_type_map[ad_type] << std::endl;
-                }
-            }
-            else if ( gap_ad_type_map.find(ad_type) != gap_ad_type_map.end())
-            {
-                // For other AD types, pass data as array without parsing
-                Utility::Set(data_obj, gap_ad_type_map[ad_type], ConversionUtility::toJsValueArray(data + pos + 1, ad_len - 1));
-            }
-            else
-            {
-                Utility::Set(data_obj, std::to_string(ad_type).c_str(), ConversionUtility::toJsValueArray(data + pos + 1, ad_len - 1));
+                auto text_len = AdStructures::formatUuid(value + i * uuid_len, uuid_len, uuid_as_text);
+                Nan::Set(uuid_array, i, Nan::New<v8::String>(uuid_as_text, static_cast<int>(text_len)).ToLocalChecked());
             }
 
-            pos += ad_len; // Jump to the next AD Type
+            field_value = uuid_array;
+        }
+        else if (ad_type == BLE_GAP_AD_TYPE_TX_POWER_LEVEL)
+        {
+            field_value = Nan::New<v8::Integer>(value[0]);
+        }
+        else
+        {
+            // For other AD types, pass data as array without parsing
+            field_value = ConversionUtility::toJsValueArray(value, field.length);
+        }
+
+        auto name = gap_ad_type_map.find(ad_type);
+
+        if (name != gap_ad_type_map.end())
+        {
+            Utility::Set(data_obj, name->second, field_value);
+        }
+        else
+        {
+            // AD types without a name are set with the type as key
+            Nan::Set(data_obj, ad_type, field_value);
         }
     }
 
-    return scope.Escape(obj);
+    return scope.Escape(data_obj);
 }
 
 #pragma endregion GapAdvReport
@@ -1436,7 +1516,7 @@ NAN_METHOD(Adapter::GapSetAddress)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapSetAddress));
+    obj->commandExecutor.queue(baton->req, GapSetAddress, AfterGapSetAddress);
 }
 
 void Adapter::GapSetAddress(uv_work_t *req)
@@ -1495,7 +1575,7 @@ NAN_METHOD(Adapter::GapGetAddress)
     baton->address = address;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapGetAddress));
+    obj->commandExecutor.queue(baton->req, GapGetAddress, AfterGapGetAddress);
 
     return;
 }
@@ -1575,7 +1655,7 @@ NAN_METHOD(Adapter::GapUpdateConnectionParameters)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapUpdateConnectionParameters, reinterpret_cast<uv_after_work_cb>(AfterGapUpdateConnectionParameters));
+    obj->commandExecutor.queue(baton->req, GapUpdateConnectionParameters, AfterGapUpdateConnectionParameters);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1643,7 +1723,7 @@ NAN_METHOD(Adapter::GapDisconnect)
     baton->hci_status_code = hci_status_code;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapDisconnect, reinterpret_cast<uv_after_work_cb>(AfterGapDisconnect));
+    obj->commandExecutor.queue(baton->req, GapDisconnect, AfterGapDisconnect);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1705,7 +1785,7 @@ NAN_METHOD(Adapter::GapSetTXPower)
     baton->tx_power = tx_power;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetTXPower, reinterpret_cast<uv_after_work_cb>(AfterGapSetTXPower));
+    obj->commandExecutor.queue(baton->req, GapSetTXPower, AfterGapSetTXPower);
 
 }
 
@@ -1786,7 +1866,7 @@ NAN_METHOD(Adapter::GapSetDeviceName)
     baton->length = length;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapSetDeviceName));
+    obj->commandExecutor.queue(baton->req, GapSetDeviceName, AfterGapSetDeviceName);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1815,7 +1895,6 @@ void Adapter::AfterGapSetDeviceName(uv_work_t *req)
     }
 
     baton->callback->Call(1, argv);
-    free(baton->dev_name);
     delete baton;
 }
 
@@ -1847,7 +1926,7 @@ NAN_METHOD(Adapter::GapGetDeviceName)
     baton->dev_name = static_cast<uint8_t*>(malloc(baton->length));
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapGetDeviceName));
+    obj->commandExecutor.queue(baton->req, GapGetDeviceName, AfterGapGetDeviceName);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1882,7 +1961,6 @@ void Adapter::AfterGapGetDeviceName(uv_work_t *req)
     }
 
     baton->callback->Call(2, argv);
-    free(baton->dev_name);
     delete baton;
 }
 
@@ -1926,7 +2004,7 @@ NAN_METHOD(Adapter::GapStartRSSI)
     baton->skip_count = skip_count;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStartRSSI));
+    obj->commandExecutor.queue(baton->req, GapStartRSSI, AfterGapStartRSSI);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1987,7 +2065,7 @@ NAN_METHOD(Adapter::GapStopRSSI)
     baton->conn_handle = conn_handle;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStopRSSI));
+    obj->commandExecutor.queue(baton->req, GapStopRSSI, AfterGapStopRSSI);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2046,11 +2124,39 @@ NAN_METHOD(Adapter::GapStartScan)
 
     ble_gap_scan_params_t *params = GapScanParams(options);
 
+    // Reports are filtered from the first report of the scan, so the filter is set before the scan is started
+    try
+    {
+        AdvReportFilterSettings *filter = nullptr;
+
+        if (Utility::Has(options, "filter") && !Utility::Get(options, "filter")->IsUndefined())
+        {
+            filter = GapScanFilter(ConversionUtility::getJsObjectOrNull(options, "filter")).ToNative();
+        }
+
+        if (filter != nullptr)
+        {
+            obj->advReportFilter.setSettings(*filter);
+            delete filter;
+        }
+        else
+        {
+            obj->advReportFilter.disable();
+        }
+    }
+    catch (std::string error)
+    {
+        delete params;
+        auto message = ErrorMessage::getStructErrorMessage("filter", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
     auto baton = new StartScanBaton(callback);
     baton->scan_params = params;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartScan, reinterpret_cast<uv_after_work_cb>(AfterGapStartScan));
+    obj->commandExecutor.queue(baton->req, GapStartScan, AfterGapStartScan);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2106,7 +2212,7 @@ NAN_METHOD(Adapter::GapStopScan)
     auto baton = new StopScanBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopScan, reinterpret_cast<uv_after_work_cb>(AfterGapStopScan));
+    obj->commandExecutor.queue(baton->req, GapStopScan, AfterGapStopScan);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2208,7 +2314,7 @@ NAN_METHOD(Adapter::GapConnect)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapConnect, reinterpret_cast<uv_after_work_cb>(AfterGapConnect));
+    obj->commandExecutor.queue(baton->req, GapConnect, AfterGapConnect);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2264,7 +2370,7 @@ NAN_METHOD(Adapter::GapCancelConnect)
     auto baton = new GapConnectCancelBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapCancelConnect, reinterpret_cast<uv_after_work_cb>(AfterGapCancelConnect));
+    obj->commandExecutor.queue(baton->req, GapCancelConnect, AfterGapCancelConnect);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2325,7 +2431,7 @@ NAN_METHOD(Adapter::GapGetRSSI)
     baton->rssi = 0;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapGetRSSI));
+    obj->commandExecutor.queue(baton->req, GapGetRSSI, AfterGapGetRSSI);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2401,7 +2507,7 @@ NAN_METHOD(Adapter::GapStartAdvertising)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStartAdvertising));
+    obj->commandExecutor.queue(baton->req, GapStartAdvertising, AfterGapStartAdvertising);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2458,7 +2564,7 @@ NAN_METHOD(Adapter::GapStopAdvertising)
     auto baton = new GapStopAdvertisingBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStopAdvertising));
+    obj->commandExecutor.queue(baton->req, GapStopAdvertising, AfterGapStopAdvertising);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2520,7 +2626,7 @@ NAN_METHOD(Adapter::GapGetConnectionSecurity)
     baton->conn_sec = new ble_gap_conn_sec_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetConnectionSecurity, reinterpret_cast<uv_after_work_cb>(AfterGapGetConnectionSecurity));
+    obj->commandExecutor.queue(baton->req, GapGetConnectionSecurity, AfterGapGetConnectionSecurity);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2550,7 +2656,6 @@ void Adapter::AfterGapGetConnectionSecurity(uv_work_t *req)
     }
 
     baton->callback->Call(2, argv);
-    delete baton->conn_sec;
     delete baton;
 }
 
@@ -2614,7 +2719,7 @@ NAN_METHOD(Adapter::GapEncrypt)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapEncrypt, reinterpret_cast<uv_after_work_cb>(AfterGapEncrypt));
+    obj->commandExecutor.queue(baton->req, GapEncrypt, AfterGapEncrypt);
 }
 
 void Adapter::GapEncrypt(uv_work_t *req)
@@ -2698,45 +2803,8 @@ NAN_METHOD(Adapter::GapReplySecurityParameters)
     {
         ble_gap_sec_keyset_t *keyset = GapSecKeyset(sec_keyset_object);
 
-        if (keyset == nullptr)
-        {
-            keyset = new ble_gap_sec_keyset_t();
-
-            keyset->keys_own.p_enc_key = nullptr;
-            keyset->keys_own.p_id_key = nullptr;
-            keyset->keys_own.p_sign_key = nullptr;
-            keyset->keys_own.p_pk = nullptr;
-        }
-
-        if (keyset->keys_own.p_enc_key == nullptr)
-        {
-            keyset->keys_own.p_enc_key = new ble_gap_enc_key_t();
-        }
-
-        if (keyset->keys_own.p_id_key == nullptr)
-        {
-            keyset->keys_own.p_id_key = new ble_gap_id_key_t();
-        }
-
-        if (keyset->keys_own.p_sign_key == nullptr)
-        {
-            keyset->keys_own.p_sign_key = new ble_gap_sign_info_t();
-        }
-
-        if (keyset->keys_own.p_pk == nullptr)
-        {
-            keyset->keys_own.p_pk = new ble_gap_lesc_p256_pk_t();
-        }
-
-
-        keyset->keys_peer.p_enc_key = new ble_gap_enc_key_t();
-        keyset->keys_peer.p_id_key = new ble_gap_id_key_t();
-        keyset->keys_peer.p_sign_key = new ble_gap_sign_info_t();
-        keyset->keys_peer.p_pk = new ble_gap_lesc_p256_pk_t();
-
-        baton->sec_keyset = keyset;
-
-        obj->createSecurityKeyStorage(conn_handle, keyset);
+        // The keys received from the peer are stored in the key storage of the connection
+        baton->sec_keyset = obj->createSecurityKeyStorage(conn_handle, keyset);
     }
     catch (char const *)
     {
@@ -2744,9 +2812,15 @@ NAN_METHOD(Adapter::GapReplySecurityParameters)
         return;
     }
 
+    if (baton->sec_keyset == nullptr)
+    {
+        Nan::ThrowTypeError("The connection handle is out of range for storing security keys.");
+        return;
+    }
+
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplySecurityParameters, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityParameters));
+    obj->commandExecutor.queue(baton->req, GapReplySecurityParameters, AfterGapReplySecurityParameters);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2867,7 +2941,7 @@ NAN_METHOD(Adapter::GapReplySecurityInfo)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplySecurityInfo, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityInfo));
+    obj->commandExecutor.queue(baton->req, GapReplySecurityInfo, AfterGapReplySecurityInfo);
 }
 
 void Adapter::GapReplySecurityInfo(uv_work_t *req)
@@ -2941,7 +3015,7 @@ NAN_METHOD(Adapter::GapAuthenticate)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapAuthenticate, reinterpret_cast<uv_after_work_cb>(AfterGapAuthenticate));
+    obj->commandExecutor.queue(baton->req, GapAuthenticate, AfterGapAuthenticate);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3033,7 +3107,7 @@ NAN_METHOD(Adapter::GapSetAdvertisingData)
     baton->srdlen = scan_response_length;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAdvertisingData, reinterpret_cast<uv_after_work_cb>(AfterGapSetAdvertisingData));
+    obj->commandExecutor.queue(baton->req, GapSetAdvertisingData, AfterGapSetAdvertisingData);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3104,7 +3178,7 @@ NAN_METHOD(Adapter::GapSetPPCP)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapSetPPCP));
+    obj->commandExecutor.queue(baton->req, GapSetPPCP, AfterGapSetPPCP);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3132,7 +3206,6 @@ void Adapter::AfterGapSetPPCP(uv_work_t *req)
     }
 
     baton->callback->Call(1, argv);
-    delete baton->p_conn_params;
     delete baton;
 }
 
@@ -3162,7 +3235,7 @@ NAN_METHOD(Adapter::GapGetPPCP)
     baton->p_conn_params = new ble_gap_conn_params_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapGetPPCP));
+    obj->commandExecutor.queue(baton->req, GapGetPPCP, AfterGapGetPPCP);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3192,7 +3265,6 @@ void Adapter::AfterGapGetPPCP(uv_work_t *req)
     }
 
     baton->callback->Call(2, argv);
-    delete baton->p_conn_params;
     delete baton;
 }
 
@@ -3226,7 +3298,7 @@ NAN_METHOD(Adapter::GapSetAppearance)
     baton->appearance = appearance;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapSetAppearance));
+    obj->commandExecutor.queue(baton->req, GapSetAppearance, AfterGapSetAppearance);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3280,7 +3352,7 @@ NAN_METHOD(Adapter::GapGetAppearance)
     auto baton = new GapGetAppearanceBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapGetAppearance));
+    obj->commandExecutor.queue(baton->req, GapGetAppearance, AfterGapGetAppearance);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3369,7 +3441,7 @@ NAN_METHOD(Adapter::GapReplyAuthKey)
     baton->key_type = key_type;
     baton->key = key;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplyAuthKey, reinterpret_cast<uv_after_work_cb>(AfterGapReplyAuthKey));
+    obj->commandExecutor.queue(baton->req, GapReplyAuthKey, AfterGapReplyAuthKey);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3438,7 +3510,7 @@ NAN_METHOD(Adapter::GapReplyDHKeyLESC)
     baton->dhkey = dhkey;
     delete key;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplyDHKeyLESC, reinterpret_cast<uv_after_work_cb>(AfterGapReplyDHKeyLESC));
+    obj->commandExecutor.queue(baton->req, GapReplyDHKeyLESC, AfterGapReplyDHKeyLESC);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3466,7 +3538,6 @@ void Adapter::AfterGapReplyDHKeyLESC(uv_work_t *req)
     }
 
     baton->callback->Call(1, argv);
-    delete baton->dhkey;
     delete baton;
 }
 #pragma endregion GapReplyDHKeyLESC
@@ -3504,7 +3575,7 @@ NAN_METHOD(Adapter::GapNotifyKeypress)
     baton->conn_handle = conn_handle;
     baton->kp_not = kp_not;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapNotifyKeypress, reinterpret_cast<uv_after_work_cb>(AfterGapNotifyKeypress));
+    obj->commandExecutor.queue(baton->req, GapNotifyKeypress, AfterGapNotifyKeypress);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3574,7 +3645,7 @@ NAN_METHOD(Adapter::GapGetLESCOOBData)
     baton->p_pk_own = p_pk_own;
     baton->p_oobd_own = new ble_gap_lesc_oob_data_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapGetLESCOOBData));
+    obj->commandExecutor.queue(baton->req, GapGetLESCOOBData, AfterGapGetLESCOOBData);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3605,8 +3676,6 @@ void Adapter::AfterGapGetLESCOOBData(uv_work_t *req)
 
     baton->callback->Call(2, argv);
 
-    delete baton->p_pk_own;
-    delete baton->p_oobd_own;
     delete baton;
 }
 #pragma endregion GapGetLESCOOBData
@@ -3669,7 +3738,7 @@ NAN_METHOD(Adapter::GapSetLESCOOBData)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapSetLESCOOBData));
+    obj->commandExecutor.queue(baton->req, GapSetLESCOOBData, AfterGapSetLESCOOBData);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3698,8 +3767,6 @@ void Adapter::AfterGapSetLESCOOBData(uv_work_t *req)
 
     baton->callback->Call(1, argv);
 
-    delete baton->p_oobd_own;
-    delete baton->p_oobd_peer;
     delete baton;
 }
 #pragma endregion GapSetLESCOOBData
@@ -3798,6 +3865,7 @@ extern "C" {
         NODE_DEFINE_CONSTANT(target, BLE_GAP_AD_TYPE_SIMPLE_PAIRING_RANDOMIZER_R256); //Simple Pairing Randomizer R-256.
         NODE_DEFINE_CONSTANT(target, BLE_GAP_AD_TYPE_SERVICE_DATA_32BIT_UUID); //Service Data - 32-bit UUID.
         NODE_DEFINE_CONSTANT(target, BLE_GAP_AD_TYPE_SERVICE_DATA_128BIT_UUID); //Service Data - 128-bit UUID.
+        NODE_DEFINE_CONSTANT(target, BLE_GAP_AD_TYPE_URI); //URI.
         NODE_DEFINE_CONSTANT(target, BLE_GAP_AD_TYPE_3D_INFORMATION_DATA); //3D Information Data.
         NODE_DEFINE_CONSTANT(target, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA); //Manufacturer Specific Data.
 
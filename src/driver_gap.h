@@ -16,6 +16,7 @@
 #include "ble.h"
 #include "ble_hci.h"
 #include "common.h"
+#include "adv_report_filter.h"
 
 #include <string>
 
@@ -49,8 +50,8 @@ private:
     BleDriverGapEvent() {}
 
 public:
-    BleDriverGapEvent(uint16_t evt_id, const std::string timestamp, uint16_t conn_handle, EventType *evt)
-        : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt)
+    BleDriverGapEvent(uint16_t evt_id, const EventTime &time, uint16_t conn_handle, EventType *evt)
+        : BleDriverEvent<EventType>(evt_id, time, conn_handle, evt)
     {
     }
 
@@ -68,17 +69,24 @@ public:
 class GapAdvReport : public BleDriverGapEvent<ble_gap_evt_adv_report_t>
 {
 public:
-    GapAdvReport(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_adv_report_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_adv_report_t>(BLE_GAP_EVT_ADV_REPORT, timestamp, conn_handle, evt) {}
+    GapAdvReport(const EventTime &time, uint16_t conn_handle, ble_gap_evt_adv_report_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_adv_report_t>(BLE_GAP_EVT_ADV_REPORT, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
+
+    // Object with the AD structures of the advertising data, keyed by AD type name
+    static v8::Local<v8::Object> DataToJs(const uint8_t *data, uint8_t dlen);
+
+private:
+    static NAN_GETTER(DataGetter);
+    static NAN_SETTER(DataSetter);
 };
 
 class GapScanReqReport : public BleDriverGapEvent<ble_gap_evt_scan_req_report_t>
 {
 public:
-    GapScanReqReport(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_scan_req_report_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_scan_req_report_t>(BLE_GAP_EVT_SCAN_REQ_REPORT, timestamp, conn_handle, evt) {}
+    GapScanReqReport(const EventTime &time, uint16_t conn_handle, ble_gap_evt_scan_req_report_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_scan_req_report_t>(BLE_GAP_EVT_SCAN_REQ_REPORT, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -86,16 +94,16 @@ public:
 class GapConnected : public BleDriverGapEvent<ble_gap_evt_connected_t>
 {
 public:
-    GapConnected(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_connected_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_connected_t>(BLE_GAP_EVT_CONNECTED, timestamp, conn_handle, evt) {}
+    GapConnected(const EventTime &time, uint16_t conn_handle, ble_gap_evt_connected_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_connected_t>(BLE_GAP_EVT_CONNECTED, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
 
 class GapDisconnected : public BleDriverGapEvent<ble_gap_evt_disconnected_t>
 {public:
-    GapDisconnected(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_disconnected_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_disconnected_t>(BLE_GAP_EVT_DISCONNECTED, timestamp, conn_handle, evt) {}
+    GapDisconnected(const EventTime &time, uint16_t conn_handle, ble_gap_evt_disconnected_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_disconnected_t>(BLE_GAP_EVT_DISCONNECTED, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -104,8 +112,8 @@ class GapDisconnected : public BleDriverGapEvent<ble_gap_evt_disconnected_t>
 class GapTimeout : public BleDriverGapEvent<ble_gap_evt_timeout_t>
 {
 public:
-    GapTimeout(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_timeout_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_timeout_t>(BLE_GAP_EVT_TIMEOUT, timestamp, conn_handle, evt) {}
+    GapTimeout(const EventTime &time, uint16_t conn_handle, ble_gap_evt_timeout_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_timeout_t>(BLE_GAP_EVT_TIMEOUT, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -114,8 +122,8 @@ public:
 class GapRssiChanged : public BleDriverGapEvent<ble_gap_evt_rssi_changed_t>
 {
 public:
-    GapRssiChanged(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_rssi_changed_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_rssi_changed_t>(BLE_GAP_EVT_RSSI_CHANGED, timestamp, conn_handle, evt) {}
+    GapRssiChanged(const EventTime &time, uint16_t conn_handle, ble_gap_evt_rssi_changed_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_rssi_changed_t>(BLE_GAP_EVT_RSSI_CHANGED, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -123,8 +131,8 @@ public:
 class GapConnParamUpdate : public BleDriverGapEvent<ble_gap_evt_conn_param_update_t>
 {
 public:
-    GapConnParamUpdate(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_conn_param_update_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_conn_param_update_t>(BLE_GAP_EVT_CONN_PARAM_UPDATE, timestamp, conn_handle, evt) {}
+    GapConnParamUpdate(const EventTime &time, uint16_t conn_handle, ble_gap_evt_conn_param_update_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_conn_param_update_t>(BLE_GAP_EVT_CONN_PARAM_UPDATE, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -132,8 +140,8 @@ public:
 class GapConnParamUpdateRequest : public BleDriverGapEvent<ble_gap_evt_conn_param_update_request_t>
 {
 public:
-    GapConnParamUpdateRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_conn_param_update_request_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_conn_param_update_request_t>(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, timestamp, conn_handle, evt) {}
+    GapConnParamUpdateRequest(const EventTime &time, uint16_t conn_handle, ble_gap_evt_conn_param_update_request_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_conn_param_update_request_t>(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -141,8 +149,8 @@ public:
 class GapSecParamsRequest : public BleDriverGapEvent<ble_gap_evt_sec_params_request_t>
 {
 public:
-    GapSecParamsRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_sec_params_request_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_sec_params_request_t>(BLE_GAP_EVT_SEC_PARAMS_REQUEST, timestamp, conn_handle, evt) {}
+    GapSecParamsRequest(const EventTime &time, uint16_t conn_handle, ble_gap_evt_sec_params_request_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_sec_params_request_t>(BLE_GAP_EVT_SEC_PARAMS_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -150,8 +158,8 @@ public:
 class GapAuthStatus : public BleDriverGapEvent<ble_gap_evt_auth_status_t>
 {
 public:
-    GapAuthStatus(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_auth_status_t *evt) 
-        : BleDriverGapEvent<ble_gap_evt_auth_status_t>(BLE_GAP_EVT_AUTH_STATUS, timestamp, conn_handle, evt) {}
+    GapAuthStatus(const EventTime &time, uint16_t conn_handle, ble_gap_evt_auth_status_t *evt) 
+        : BleDriverGapEvent<ble_gap_evt_auth_status_t>(BLE_GAP_EVT_AUTH_STATUS, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -159,8 +167,8 @@ public:
 class GapConnSecUpdate : public BleDriverGapEvent<ble_gap_evt_conn_sec_update_t>
 {
 public:
-    GapConnSecUpdate(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_conn_sec_update_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_conn_sec_update_t>(BLE_GAP_EVT_CONN_SEC_UPDATE, timestamp, conn_handle, evt) {}
+    GapConnSecUpdate(const EventTime &time, uint16_t conn_handle, ble_gap_evt_conn_sec_update_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_conn_sec_update_t>(BLE_GAP_EVT_CONN_SEC_UPDATE, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -168,8 +176,8 @@ public:
 class GapSecInfoRequest : public BleDriverGapEvent<ble_gap_evt_sec_info_request_t>
 {
 public:
-    GapSecInfoRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_sec_info_request_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_sec_info_request_t>(BLE_GAP_EVT_SEC_INFO_REQUEST, timestamp, conn_handle, evt) {}
+    GapSecInfoRequest(const EventTime &time, uint16_t conn_handle, ble_gap_evt_sec_info_request_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_sec_info_request_t>(BLE_GAP_EVT_SEC_INFO_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -177,8 +185,8 @@ public:
 class GapSecRequest : public BleDriverGapEvent<ble_gap_evt_sec_request_t>
 {
 public:
-    GapSecRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_sec_request_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_sec_request_t>(BLE_GAP_EVT_SEC_REQUEST, timestamp, conn_handle, evt) {}
+    GapSecRequest(const EventTime &time, uint16_t conn_handle, ble_gap_evt_sec_request_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_sec_request_t>(BLE_GAP_EVT_SEC_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -186,8 +194,8 @@ public:
 class GapPasskeyDisplay : public BleDriverGapEvent<ble_gap_evt_passkey_display_t>
 {
 public:
-    GapPasskeyDisplay(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_passkey_display_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_passkey_display_t>(BLE_GAP_EVT_PASSKEY_DISPLAY, timestamp, conn_handle, evt) {}
+    GapPasskeyDisplay(const EventTime &time, uint16_t conn_handle, ble_gap_evt_passkey_display_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_passkey_display_t>(BLE_GAP_EVT_PASSKEY_DISPLAY, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -195,8 +203,8 @@ public:
 class GapKeyPressed : public BleDriverGapEvent<ble_gap_evt_key_pressed_t>
 {
 public:
-    GapKeyPressed(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_key_pressed_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_key_pressed_t>(BLE_GAP_EVT_KEY_PRESSED, timestamp, conn_handle, evt) {}
+    GapKeyPressed(const EventTime &time, uint16_t conn_handle, ble_gap_evt_key_pressed_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_key_pressed_t>(BLE_GAP_EVT_KEY_PRESSED, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -204,8 +212,8 @@ public:
 class GapAuthKeyRequest : public BleDriverGapEvent<ble_gap_evt_auth_key_request_t>
 {
 public:
-    GapAuthKeyRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_auth_key_request_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_auth_key_request_t>(BLE_GAP_EVT_AUTH_KEY_REQUEST, timestamp, conn_handle, evt) {}
+    GapAuthKeyRequest(const EventTime &time, uint16_t conn_handle, ble_gap_evt_auth_key_request_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_auth_key_request_t>(BLE_GAP_EVT_AUTH_KEY_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -213,8 +221,8 @@ public:
 class GapLESCDHKeyRequest : public BleDriverGapEvent<ble_gap_evt_lesc_dhkey_request_t>
 {
 public:
-    GapLESCDHKeyRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_lesc_dhkey_request_t *evt)
-        : BleDriverGapEvent<ble_gap_evt_lesc_dhkey_request_t>(BLE_GAP_EVT_LESC_DHKEY_REQUEST, timestamp, conn_handle, evt) {}
+    GapLESCDHKeyRequest(const EventTime &time, uint16_t conn_handle, ble_gap_evt_lesc_dhkey_request_t *evt)
+        : BleDriverGapEvent<ble_gap_evt_lesc_dhkey_request_t>(BLE_GAP_EVT_LESC_DHKEY_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -271,6 +279,14 @@ public:
     ble_gap_scan_params_t *ToNative();
 };
 
+// Filter applied to advertising reports, from the filter property of the scan options. See adv_report_filter.h.
+class GapScanFilter : public BleToJs<AdvReportFilterSettings>
+{
+public:
+    GapScanFilter(v8::Local<v8::Object> js) : BleToJs<AdvReportFilterSettings>(js) {}
+    AdvReportFilterSettings *ToNative();
+};
+
 class GapAdvChannelMask : public BleToJs<ble_gap_adv_ch_mask_t>
 {
 public:
@@ -465,6 +481,7 @@ public:
 struct GapSetDeviceNameBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GapSetDeviceNameBaton);
+    BATON_DESTRUCTOR(GapSetDeviceNameBaton) { free(dev_name); }
     ble_gap_conn_sec_mode_t *conn_sec_mode;
     uint8_t *dev_name;
     uint16_t length;
@@ -473,6 +490,7 @@ public:
 struct GapGetDeviceNameBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GapGetDeviceNameBaton);
+    BATON_DESTRUCTOR(GapGetDeviceNameBaton) { free(dev_name); }
     uint8_t *dev_name;
     uint16_t length;
 };
@@ -549,6 +567,7 @@ public:
 struct GapConnSecGetBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GapConnSecGetBaton);
+    BATON_DESTRUCTOR(GapConnSecGetBaton) { delete conn_sec; }
     uint16_t conn_handle;
     ble_gap_conn_sec_t *conn_sec;
 };
@@ -589,12 +608,14 @@ public:
 struct GapSetPPCPBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GapSetPPCPBaton);
+    BATON_DESTRUCTOR(GapSetPPCPBaton) { delete p_conn_params; }
     ble_gap_conn_params_t *p_conn_params;
 };
 
 struct GapGetPPCPBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GapGetPPCPBaton);
+    BATON_DESTRUCTOR(GapGetPPCPBaton) { delete p_conn_params; }
     ble_gap_conn_params_t *p_conn_params;
 };
 
@@ -621,6 +642,7 @@ public:
 struct GapReplyDHKeyLESCBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GapReplyDHKeyLESCBaton);
+    BATON_DESTRUCTOR(GapReplyDHKeyLESCBaton) { delete dhkey; }
     uint16_t conn_handle;
     ble_gap_lesc_dhkey_t *dhkey;
 };
@@ -637,6 +659,7 @@ struct GapGetLESCOOBDataBaton : public Baton
 {
 public:
     BATON_CONSTRUCTOR(GapGetLESCOOBDataBaton);
+    BATON_DESTRUCTOR(GapGetLESCOOBDataBaton) { delete p_pk_own; delete p_oobd_own; }
     uint16_t conn_handle;
     ble_gap_lesc_p256_pk_t *p_pk_own;
     ble_gap_lesc_oob_data_t *p_oobd_own;
@@ -646,6 +669,7 @@ struct GapSetLESCOOBDataBaton : public Baton
 {
 public:
     BATON_CONSTRUCTOR(GapSetLESCOOBDataBaton);
+    BATON_DESTRUCTOR(GapSetLESCOOBDataBaton) { delete p_oobd_own; delete p_oobd_peer; }
     uint16_t conn_handle;
     ble_gap_lesc_oob_data_t *p_oobd_own;
     ble_gap_lesc_oob_data_t *p_oobd_peer;
@@ -16,6 +16,9 @@
 #include "driver.h"
 #include "driver_gatt.h"
 
+#include <algorithm>
+#include <sstream>
+
 static name_map_t gattc_svcs_type_map = {
     NAME_MAP_ENTRY(SD_BLE_GATTC_PRIMARY_SERVICES_DISCOVER),
     NAME_MAP_ENTRY(SD_BLE_GATTC_RELATIONSHIPS_DISCOVER),
@@ -167,7 +170,7 @@ ble_gattc_write_params_t *GattcWriteParameters::ToNative()
     writeparams->handle = ConversionUtility::getNativeUint16(jsobj, "handle");
     writeparams->offset = ConversionUtility::getNativeUint16(jsobj, "offset");
     writeparams->len = ConversionUtility::getNativeUint16(jsobj, "len");
-    writeparams->p_value = ConversionUtility::getNativePointerToUint8(jsobj, "value");
+    writeparams->p_value = ConversionUtility::getCopiedPointerToUint8(jsobj, "value", writeparams->len, *copied);
 
     return writeparams;
 }
@@ -310,7 +313,7 @@ v8::Local<v8::Object> GattcReadEvent::ToJs()
     Utility::Set(obj, "handle", evt->handle);
     Utility::Set(obj, "offset", evt->offset);
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    ConversionUtility::setValueBuffer(obj, "data", "raw", evt->data, evt->len);
 
     return scope.Escape(obj);
 }
@@ -337,7 +340,7 @@ v8::Local<v8::Object> GattcWriteEvent::ToJs()
     Utility::Set(obj, "write_op", evt->write_op);
     Utility::Set(obj, "offset", evt->offset);
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    ConversionUtility::setValueBuffer(obj, "data", "raw", evt->data, evt->len);
 
     return scope.Escape(obj);
 }
@@ -351,7 +354,7 @@ v8::Local<v8::Object> GattcHandleValueNotificationEvent::ToJs()
     Utility::Set(obj, "handle", evt->handle);
     Utility::Set(obj, "type", evt->type);
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    ConversionUtility::setValueBuffer(obj, "data", "raw", evt->data, evt->len);
 
     return scope.Escape(obj);
 }
@@ -413,7 +416,7 @@ NAN_METHOD(Adapter::GattcDiscoverPrimaryServices)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverPrimaryServices, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverPrimaryServices));
+    obj->commandExecutor.queue(baton->req, GattcDiscoverPrimaryServices, AfterGattcDiscoverPrimaryServices);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -487,7 +490,7 @@ NAN_METHOD(Adapter::GattcDiscoverRelationship)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverRelationship, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverRelationship));
+    obj->commandExecutor.queue(baton->req, GattcDiscoverRelationship, AfterGattcDiscoverRelationship);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -560,7 +563,7 @@ NAN_METHOD(Adapter::GattcDiscoverCharacteristics)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverCharacteristics, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverCharacteristics));
+    obj->commandExecutor.queue(baton->req, GattcDiscoverCharacteristics, AfterGattcDiscoverCharacteristics);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -633,7 +636,7 @@ NAN_METHOD(Adapter::GattcDiscoverDescriptors)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverDescriptors, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverDescriptors));
+    obj->commandExecutor.queue(baton->req, GattcDiscoverDescriptors, AfterGattcDiscoverDescriptors);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -721,7 +724,7 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValueByUUID)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcReadCharacteristicValueByUUID, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValueByUUID));
+    obj->commandExecutor.queue(baton->req, GattcReadCharacteristicValueByUUID, AfterGattcReadCharacteristicValueByUUID);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -789,7 +792,7 @@ NAN_METHOD(Adapter::GattcRead)
     baton->handle = handle;
     baton->offset = offset;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcRead, reinterpret_cast<uv_after_work_cb>(AfterGattcRead));
+    obj->commandExecutor.queue(baton->req, GattcRead, AfterGattcRead);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -872,7 +875,7 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValues)
     baton->p_handles = p_handles;
     baton->handle_count = handle_count;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcReadCharacteristicValues, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValues));
+    obj->commandExecutor.queue(baton->req, GattcReadCharacteristicValues, AfterGattcReadCharacteristicValues);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -880,7 +883,6 @@ void Adapter::GattcReadCharacteristicValues(uv_work_t *req)
 {
     auto baton = static_cast<GattcReadCharacteristicValuesBaton *>(req->data);
     baton->result = sd_ble_gattc_char_values_read(baton->adapter, baton->conn_handle, baton->p_handles, baton->handle_count);
-    free(baton->p_handles);
 }
 
 // This runs in Main Thread
@@ -937,7 +939,7 @@ NAN_METHOD(Adapter::GattcWrite)
 
     try
     {
-        baton->p_write_params = GattcWriteParameters(p_write_params);
+        baton->p_write_params = GattcWriteParameters(p_write_params, baton->copied);
     }
     catch (std::string error)
     {
@@ -946,7 +948,7 @@ NAN_METHOD(Adapter::GattcWrite)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcWrite, reinterpret_cast<uv_after_work_cb>(AfterGattcWrite));
+    obj->commandExecutor.queue(baton->req, GattcWrite, AfterGattcWrite);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -974,6 +976,240 @@ void Adapter::AfterGattcWrite(uv_work_t *req)
     }
 
     baton->callback->Call(1, argv);
+
+    delete baton;
+}
+
+// Time to wait for BLE_EVT_TX_COMPLETE before the credits are read again
+static const std::chrono::milliseconds WRITE_BATCH_TX_COMPLETE_TIMEOUT(500);
+
+static void addWriteBatchItem(GattcWriteBatchBaton *baton, uint16_t handle, size_t offset, size_t length)
+{
+    if (length > UINT16_MAX)
+    {
+        throw "value of at most 65535 bytes";
+    }
+
+    ble_gattc_write_params_t write = {};
+    write.write_op = BLE_GATT_OP_WRITE_CMD;
+    write.handle = handle;
+    write.len = static_cast<uint16_t>(length);
+
+    baton->writes.push_back(write);
+    baton->offsets.push_back(offset);
+}
+
+// [{ handle, value }, ...], the values are copied back to back into one block
+static void getWriteBatchFromArray(GattcWriteBatchBaton *baton, v8::Local<v8::Array> writes)
+{
+    std::vector<v8::Local<v8::Value>> values;
+    size_t length = 0;
+
+    for (uint32_t i = 0; i < writes->Length(); ++i)
+    {
+        auto write = ConversionUtility::getJsObject(writes->Get(Nan::New(i)));
+        auto handle = ConversionUtility::getNativeUint16(write, "handle");
+        auto value = Utility::Get(write, "value");
+        auto valueLength = ConversionUtility::getByteLength(value);
+
+        addWriteBatchItem(baton, handle, length, valueLength);
+        values.push_back(value);
+        length += valueLength;
+    }
+
+    baton->data.resize(length);
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        ConversionUtility::copyBytes(values[i], baton->data.data() + baton->offsets[i]);
+    }
+
+    baton->p_data = baton->data.data();
+}
+
+// { handle, value, len }, the value is split into writes of len bytes to the same handle
+static void getWriteBatchFromBuffer(GattcWriteBatchBaton *baton, v8::Local<v8::Object> writes)
+{
+    auto handle = ConversionUtility::getNativeUint16(writes, "handle");
+    auto writeLength = ConversionUtility::getNativeUint16(writes, "len");
+    auto length = ConversionUtility::getByteLength(Utility::Get(writes, "value"));
+
+    if (writeLength == 0)
+    {
+        throw "len larger than 0";
+    }
+
+    baton->p_data = ConversionUtility::getCopiedPointerToUint8(writes, "value", 0, baton->data);
+
+    for (size_t offset = 0; offset < length; offset += writeLength)
+    {
+        addWriteBatchItem(baton, handle, offset, std::min(length - offset, static_cast<size_t>(writeLength)));
+    }
+}
+
+NAN_METHOD(Adapter::GattcWriteBatch)
+{
+    uint16_t conn_handle;
+    v8::Local<v8::Object> writes;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        writes = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcWriteBatchBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->conn_handle = conn_handle;
+    baton->tx_credits = &obj->txCredits;
+    baton->p_data = nullptr;
+
+    try
+    {
+        if (writes->IsArray())
+        {
+            getWriteBatchFromArray(baton, v8::Local<v8::Array>::Cast(writes));
+        }
+        else
+        {
+            getWriteBatchFromBuffer(baton, writes);
+        }
+    }
+    catch (char const *error)
+    {
+        Nan::ThrowTypeError(ErrorMessage::getStructErrorMessage("writes", error));
+        delete baton;
+        return;
+    }
+    catch (std::string error)
+    {
+        Nan::ThrowTypeError(ErrorMessage::getStructErrorMessage("writes", error));
+        delete baton;
+        return;
+    }
+
+    baton->results.resize(baton->writes.size(), NRF_SUCCESS);
+
+    obj->commandExecutor.queue(baton->req, GattcWriteBatch, AfterGattcWriteBatch);
+}
+
+// Errors that only concern one write of a batch, the writes after it are still made
+static bool isWriteBatchItemError(uint32_t result)
+{
+    return result == NRF_ERROR_INVALID_PARAM
+        || result == NRF_ERROR_INVALID_ADDR
+        || result == NRF_ERROR_DATA_SIZE;
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcWriteBatch(uv_work_t *req)
+{
+    auto baton = static_cast<GattcWriteBatchBaton *>(req->data);
+    baton->result = NRF_SUCCESS;
+
+    for (size_t i = 0; i < baton->writes.size(); ++i)
+    {
+        auto &write = baton->writes[i];
+        write.p_value = baton->p_data + baton->offsets[i];
+
+        uint32_t result;
+
+        // The SoftDevice takes write commands while it has application packets, and returns them with BLE_EVT_TX_COMPLETE
+        while (true)
+        {
+            uint32_t returnCount;
+            result = baton->tx_credits->take(baton->adapter, baton->conn_handle, &returnCount);
+
+            if (result == NRF_SUCCESS)
+            {
+                result = sd_ble_gattc_write(baton->adapter, baton->conn_handle, &write);
+
+                if (result == BLE_ERROR_NO_TX_PACKETS)
+                {
+                    baton->tx_credits->noTxPackets(baton->conn_handle, returnCount);
+                }
+                else if (result != NRF_SUCCESS)
+                {
+                    baton->tx_credits->giveBack(baton->conn_handle);
+                }
+            }
+
+            if (result != BLE_ERROR_NO_TX_PACKETS)
+            {
+                break;
+            }
+
+            // Stopped when the adapter is destroyed, the rest of the batch is not written
+            if (!baton->tx_credits->wait(baton->conn_handle, WRITE_BATCH_TX_COMPLETE_TIMEOUT))
+            {
+                result = NRF_ERROR_INVALID_STATE;
+                break;
+            }
+        }
+
+        baton->results[i] = result;
+
+        if (result == NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        if (baton->result == NRF_SUCCESS)
+        {
+            baton->result = result;
+        }
+
+        // The writes that are not made, for instance after a disconnect, get the error that stopped the batch
+        if (!isWriteBatchItemError(result))
+        {
+            std::fill(baton->results.begin() + i + 1, baton->results.end(), result);
+            break;
+        }
+    }
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcWriteBatch(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattcWriteBatchBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "writing batch");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    auto results = Nan::New<v8::Array>(static_cast<int>(baton->results.size()));
+
+    for (uint32_t i = 0; i < baton->results.size(); ++i)
+    {
+        results->Set(i, ConversionUtility::toJsNumber(baton->results[i]));
+    }
+
+    argv[1] = results;
+
+    baton->callback->Call(2, argv);
     delete baton;
 }
 
@@ -1008,7 +1244,7 @@ NAN_METHOD(Adapter::GattcConfirmHandleValue)
     baton->conn_handle = conn_handle;
     baton->handle = handle;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcConfirmHandleValue, reinterpret_cast<uv_after_work_cb>(AfterGattcConfirmHandleValue));
+    obj->commandExecutor.queue(baton->req, GattcConfirmHandleValue, AfterGattcConfirmHandleValue);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1039,6 +1275,323 @@ void Adapter::AfterGattcConfirmHandleValue(uv_work_t *req)
     delete baton;
 }
 
+// Peer identity of the cache, an address or an IRK, of at most 255 bytes so that it fits the cache file
+static gatt_cache_key_t getGattCacheKey(v8::Local<v8::Value> js)
+{
+    auto length = ConversionUtility::getByteLength(js);
+
+    if (length == 0 || length > UINT8_MAX)
+    {
+        throw "array or Buffer of 1 to 255 bytes";
+    }
+
+    gatt_cache_key_t key(length);
+    ConversionUtility::copyBytes(js, key.data());
+    return key;
+}
+
+NAN_METHOD(Adapter::GattcDiscoverAttributes)
+{
+    uint16_t conn_handle;
+    gatt_cache_key_t cache_key;
+    bool validate_hash = false;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        // Options are optional: { cacheKey, validateHash }
+        if (info[argumentcount]->IsObject() && !info[argumentcount]->IsFunction())
+        {
+            auto options = ConversionUtility::getJsObject(info[argumentcount]);
+
+            if (Utility::Has(options, "cacheKey"))
+            {
+                cache_key = getGattCacheKey(Utility::Get(options, "cacheKey"));
+            }
+
+            if (Utility::Has(options, "validateHash"))
+            {
+                validate_hash = ConversionUtility::getBool(options, "validateHash");
+            }
+
+            argumentcount++;
+        }
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (char const *error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcDiscoverAttributesBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->conn_handle = conn_handle;
+    baton->gatt_discovery = &obj->gattDiscovery;
+    baton->result = obj->gattDiscovery.add(conn_handle, cache_key, validate_hash);
+
+    // The callback is called with the attribute table when the discovery is done, see onGattDiscoveryReport
+    if (baton->result == NRF_SUCCESS)
+    {
+        obj->gattDiscoveryCallbacks[conn_handle] = new Nan::Callback(callback);
+    }
+
+    obj->commandExecutor.queue(baton->req, GattcDiscoverAttributes, AfterGattcDiscoverAttributes);
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcDiscoverAttributes(uv_work_t *req)
+{
+    auto baton = static_cast<GattcDiscoverAttributesBaton *>(req->data);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        baton->gatt_discovery->start(baton->adapter, baton->conn_handle);
+    }
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcDiscoverAttributes(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattcDiscoverAttributesBaton *>(req->data);
+
+    // Only a discovery that could not be added is reported here, a failed discovery call is reported as a result
+    if (baton->result != NRF_SUCCESS)
+    {
+        v8::Local<v8::Value> argv[1];
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "discovering attributes");
+        baton->callback->Call(1, argv);
+    }
+
+    delete baton;
+}
+
+// This runs in Main Thread
+void Adapter::onGattDiscoveryReport(void *context, GattDiscoveryResult &result)
+{
+    Nan::HandleScope scope;
+
+    auto obj = static_cast<Adapter *>(context);
+    auto it = obj->gattDiscoveryCallbacks.find(result.connHandle);
+
+    if (it == obj->gattDiscoveryCallbacks.end())
+    {
+        return;
+    }
+
+    auto callback = it->second;
+    obj->gattDiscoveryCallbacks.erase(it);
+
+    v8::Local<v8::Value> argv[3];
+    argv[2] = ConversionUtility::toJsBool(result.cached);
+
+    if (result.error != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(result.error, "discovering attributes");
+        argv[1] = Nan::Undefined();
+    }
+    else if (result.gattStatus != BLE_GATT_STATUS_SUCCESS)
+    {
+        std::ostringstream message;
+        message << "Error occured when discovering attributes. GATT status: "
+                << ConversionUtility::valueToString(result.gattStatus, gatt_status_map);
+        argv[0] = Nan::Error(message.str().c_str());
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        auto services = Nan::New<v8::Array>(static_cast<int>(result.services.size()));
+
+        for (uint32_t i = 0; i < result.services.size(); ++i)
+        {
+            auto &service = result.services[i];
+            auto serviceObj = GattcService(&service.service).ToJs();
+            auto characteristics = Nan::New<v8::Array>(static_cast<int>(service.characteristics.size()));
+
+            for (uint32_t j = 0; j < service.characteristics.size(); ++j)
+            {
+                auto &characteristic = service.characteristics[j];
+                auto characteristicObj = GattcCharacteristic(&characteristic.characteristic).ToJs();
+                auto descriptors = Nan::New<v8::Array>(static_cast<int>(characteristic.descriptors.size()));
+
+                for (uint32_t k = 0; k < characteristic.descriptors.size(); ++k)
+                {
+                    descriptors->Set(k, GattcDescriptor(&characteristic.descriptors[k]).ToJs());
+                }
+
+                Utility::Set(characteristicObj, "descriptors", static_cast<v8::Local<v8::Value>>(descriptors));
+                characteristics->Set(j, characteristicObj);
+            }
+
+            Utility::Set(serviceObj, "characteristics", static_cast<v8::Local<v8::Value>>(characteristics));
+            services->Set(i, serviceObj);
+        }
+
+        argv[0] = Nan::Undefined();
+        argv[1] = services;
+    }
+
+    callback->Call(3, argv);
+    delete callback;
+}
+
+// The cache file is read and written in the executor thread, in order with the discoveries.
+// Throws a TypeError and returns false if the arguments are not a path and a callback.
+static bool getGattCacheFileArguments(Nan::NAN_METHOD_ARGS_TYPE info, std::string &path, v8::Local<v8::Function> &callback)
+{
+    auto argumentcount = 0;
+
+    try
+    {
+        path = ConversionUtility::getNativeString(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (char const *error)
+    {
+        Nan::ThrowTypeError(ErrorMessage::getTypeErrorMessage(argumentcount, error));
+        return false;
+    }
+
+    return true;
+}
+
+NAN_METHOD(Adapter::GattcCacheLoad)
+{
+    std::string path;
+    v8::Local<v8::Function> callback;
+
+    if (!getGattCacheFileArguments(info, path, callback))
+    {
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcCacheFileBaton(callback);
+    baton->cache = &obj->gattDiscovery.getCache();
+    baton->path = path;
+
+    obj->commandExecutor.queue(baton->req, GattcCacheLoad, AfterGattcCacheLoad);
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcCacheLoad(uv_work_t *req)
+{
+    auto baton = static_cast<GattcCacheFileBaton *>(req->data);
+    baton->result = baton->cache->load(baton->path);
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcCacheLoad(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattcCacheFileBaton *>(req->data);
+    v8::Local<v8::Value> argv[1];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "loading GATT cache");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    baton->callback->Call(1, argv);
+    delete baton;
+}
+
+NAN_METHOD(Adapter::GattcCacheSave)
+{
+    std::string path;
+    v8::Local<v8::Function> callback;
+
+    if (!getGattCacheFileArguments(info, path, callback))
+    {
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcCacheFileBaton(callback);
+    baton->cache = &obj->gattDiscovery.getCache();
+    baton->path = path;
+
+    obj->commandExecutor.queue(baton->req, GattcCacheSave, AfterGattcCacheSave);
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcCacheSave(uv_work_t *req)
+{
+    auto baton = static_cast<GattcCacheFileBaton *>(req->data);
+    baton->result = baton->cache->save(baton->path);
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcCacheSave(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattcCacheFileBaton *>(req->data);
+    v8::Local<v8::Value> argv[1];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "saving GATT cache");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    baton->callback->Call(1, argv);
+    delete baton;
+}
+
+NAN_METHOD(Adapter::GattcCacheRemove)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    gatt_cache_key_t cache_key;
+
+    try
+    {
+        cache_key = getGattCacheKey(info[0]);
+    }
+    catch (char const *error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto removed = obj->gattDiscovery.getCache().remove(cache_key);
+    info.GetReturnValue().Set(ConversionUtility::toJsBool(removed));
+}
+
+NAN_METHOD(Adapter::GattcCacheClear)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    obj->gattDiscovery.getCache().clear();
+}
+
 extern "C" {
     void init_gattc(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
     {
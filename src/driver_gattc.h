@@ -15,6 +15,10 @@
 
 #include "common.h"
 #include "ble_gattc.h"
+#include "gatt_discovery.h"
+#include "tx_credits.h"
+
+#include <vector>
 
 extern name_map_t gatt_status_map;
 
@@ -77,9 +81,12 @@ class GattcWriteParameters : public BleToJs<ble_gattc_write_params_t>
 {
 public:
     GattcWriteParameters(ble_gattc_write_params_t *writeparameters) : BleToJs<ble_gattc_write_params_t>(writeparameters) {}
-    GattcWriteParameters(v8::Local<v8::Object> js) : BleToJs<ble_gattc_write_params_t>(js) {}
+    GattcWriteParameters(v8::Local<v8::Object> js, std::vector<uint8_t> &copied) : BleToJs<ble_gattc_write_params_t>(js), copied(&copied) {}
     ble_gattc_write_params_t *ToNative();
     v8::Local<v8::Object> ToJs();
+
+private:
+    std::vector<uint8_t> *copied = nullptr; // Holds the value pointed into
 };
 
 template<typename EventType>
@@ -92,8 +99,8 @@ private:
     uint16_t error_handle;
 
 public:
-    BleDriverGattcEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, EventType *evt)
-        : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt),
+    BleDriverGattcEvent(uint16_t evt_id, const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, EventType *evt)
+        : BleDriverEvent<EventType>(evt_id, time, conn_handle, evt),
         gatt_status(gatt_status),
         error_handle(error_handle)
     {
@@ -116,8 +123,8 @@ public:
 class GattcPrimaryServiceDiscoveryEvent : BleDriverGattcEvent<ble_gattc_evt_prim_srvc_disc_rsp_t>
 {
 public:
-    GattcPrimaryServiceDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_prim_srvc_disc_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_prim_srvc_disc_rsp_t>(BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcPrimaryServiceDiscoveryEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_prim_srvc_disc_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_prim_srvc_disc_rsp_t>(BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -125,8 +132,8 @@ public:
 class GattcRelationshipDiscoveryEvent : BleDriverGattcEvent < ble_gattc_evt_rel_disc_rsp_t >
 {
 public:
-    GattcRelationshipDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_rel_disc_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_rel_disc_rsp_t>(BLE_GATTC_EVT_REL_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcRelationshipDiscoveryEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_rel_disc_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_rel_disc_rsp_t>(BLE_GATTC_EVT_REL_DISC_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -134,8 +141,8 @@ public:
 class GattcCharacteristicDiscoveryEvent : BleDriverGattcEvent < ble_gattc_evt_char_disc_rsp_t >
 {
 public:
-    GattcCharacteristicDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_disc_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_char_disc_rsp_t>(BLE_GATTC_EVT_CHAR_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcCharacteristicDiscoveryEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_disc_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_char_disc_rsp_t>(BLE_GATTC_EVT_CHAR_DISC_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -143,8 +150,8 @@ public:
 class GattcDescriptorDiscoveryEvent : BleDriverGattcEvent < ble_gattc_evt_desc_disc_rsp_t >
 {
 public:
-    GattcDescriptorDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_desc_disc_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_desc_disc_rsp_t>(BLE_GATTC_EVT_DESC_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcDescriptorDiscoveryEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_desc_disc_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_desc_disc_rsp_t>(BLE_GATTC_EVT_DESC_DISC_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -162,8 +169,8 @@ public:
 class GattcCharacteristicValueReadByUUIDEvent : BleDriverGattcEvent < ble_gattc_evt_char_val_by_uuid_read_rsp_t >
 {
 public:
-    GattcCharacteristicValueReadByUUIDEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_val_by_uuid_read_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_char_val_by_uuid_read_rsp_t>(BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcCharacteristicValueReadByUUIDEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_val_by_uuid_read_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_char_val_by_uuid_read_rsp_t>(BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -171,8 +178,8 @@ public:
 class GattcReadEvent : BleDriverGattcEvent < ble_gattc_evt_read_rsp_t >
 {
 public:
-    GattcReadEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_read_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_read_rsp_t>(BLE_GATTC_EVT_READ_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcReadEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_read_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_read_rsp_t>(BLE_GATTC_EVT_READ_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -180,8 +187,8 @@ public:
 class GattcCharacteristicValueReadEvent : BleDriverGattcEvent < ble_gattc_evt_char_vals_read_rsp_t >
 {
 public:
-    GattcCharacteristicValueReadEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_vals_read_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_char_vals_read_rsp_t>(BLE_GATTC_EVT_CHAR_VALS_READ_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcCharacteristicValueReadEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_vals_read_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_char_vals_read_rsp_t>(BLE_GATTC_EVT_CHAR_VALS_READ_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -189,8 +196,8 @@ public:
 class GattcWriteEvent : BleDriverGattcEvent < ble_gattc_evt_write_rsp_t >
 {
 public:
-    GattcWriteEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_write_rsp_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_write_rsp_t>(BLE_GATTC_EVT_WRITE_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcWriteEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_write_rsp_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_write_rsp_t>(BLE_GATTC_EVT_WRITE_RSP, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -198,8 +205,8 @@ public:
 class GattcHandleValueNotificationEvent : BleDriverGattcEvent < ble_gattc_evt_hvx_t >
 {
 public:
-    GattcHandleValueNotificationEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_hvx_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_hvx_t>(BLE_GATTC_EVT_HVX, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcHandleValueNotificationEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_hvx_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_hvx_t>(BLE_GATTC_EVT_HVX, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -207,8 +214,8 @@ public:
 class GattcTimeoutEvent : BleDriverGattcEvent < ble_gattc_evt_timeout_t >
 {
 public:
-    GattcTimeoutEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_timeout_t *evt)
-        : BleDriverGattcEvent<ble_gattc_evt_timeout_t>(BLE_GATTC_EVT_TIMEOUT, timestamp, conn_handle, gatt_status, error_handle, evt) {}
+    GattcTimeoutEvent(const EventTime &time, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_timeout_t *evt)
+        : BleDriverGattcEvent<ble_gattc_evt_timeout_t>(BLE_GATTC_EVT_TIMEOUT, time, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -263,6 +270,7 @@ public:
 struct GattcReadCharacteristicValuesBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattcReadCharacteristicValuesBaton);
+    BATON_DESTRUCTOR(GattcReadCharacteristicValuesBaton) { free(p_handles); }
     uint16_t conn_handle;
     uint16_t *p_handles;
     uint16_t handle_count;
@@ -271,10 +279,23 @@ public:
 struct GattcWriteBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattcWriteBaton);
+    BATON_DESTRUCTOR(GattcWriteBaton) { delete p_write_params; }
     uint16_t conn_handle;
     ble_gattc_write_params_t *p_write_params;
 };
 
+struct GattcWriteBatchBaton : public Baton {
+public:
+    BATON_CONSTRUCTOR(GattcWriteBatchBaton);
+    uint16_t conn_handle;
+    TxCredits *tx_credits;
+    uint8_t *p_data;                                  // Values of all the writes, back to back
+    std::vector<uint8_t> data;                        // Holds p_data when the values are copied
+    std::vector<ble_gattc_write_params_t> writes;     // p_value is set from p_data when the writes are made
+    std::vector<size_t> offsets;                      // Offset of the value of each write in p_data
+    std::vector<uint32_t> results;
+};
+
 struct GattcConfirmHandleValueBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattcConfirmHandleValueBaton);
@@ -282,6 +303,20 @@ public:
     uint16_t handle;
 };
 
+struct GattcDiscoverAttributesBaton : public Baton {
+public:
+    BATON_CONSTRUCTOR(GattcDiscoverAttributesBaton);
+    uint16_t conn_handle;
+    GattDiscovery *gatt_discovery;
+};
+
+struct GattcCacheFileBaton : public Baton {
+public:
+    BATON_CONSTRUCTOR(GattcCacheFileBaton);
+    GattCache *cache;
+    std::string path;
+};
+
 ///// End GATTC Batons //////////////////////////////////////////////////////////////////////////////////
 
 extern "C" {
@@ -160,7 +160,7 @@ ble_gatts_hvx_params_t *GattsHVXParams::ToNative()
     hvxparams->type = ConversionUtility::getNativeUint8(jsobj, "type");
     hvxparams->offset = ConversionUtility::getNativeUint16(jsobj, "offset");
     *(hvxparams->p_len) = ConversionUtility::getNativeUint16(jsobj, "len");
-    hvxparams->p_data = ConversionUtility::getNativePointerToUint8(jsobj, "data");
+    hvxparams->p_data = ConversionUtility::getCopiedPointerToUint8(jsobj, "data", *(hvxparams->p_len), *copied);
 
     return hvxparams;
 }
@@ -176,7 +176,7 @@ ble_gatts_value_t *GattsValue::ToNative()
 
     value->len = ConversionUtility::getNativeUint16(jsobj, "len");
     value->offset = ConversionUtility::getNativeUint16(jsobj, "offset");
-    value->p_value = ConversionUtility::getNativePointerToUint8(jsobj, "value");
+    value->p_value = ConversionUtility::getCopiedPointerToUint8(jsobj, "value", value->len, *copied);
 
     return value;
 }
@@ -188,7 +188,7 @@ v8::Local<v8::Object> GattsValue::ToJs()
 
     Utility::Set(obj, "len", ConversionUtility::toJsNumber(native->len));
     Utility::Set(obj, "offset", ConversionUtility::toJsNumber(native->offset));
-    Utility::Set(obj, "value", ConversionUtility::toJsValueArray(native->p_value, native->len));
+    ConversionUtility::setValueBuffer(obj, "value", "raw", native->p_value, native->len);
 
     return scope.Escape(obj);
 }
@@ -261,7 +261,7 @@ v8::Local<v8::Object> GattsWriteEvent::ToJs()
     Utility::Set(obj, "uuid", BleUUID(&evt->uuid).ToJs());
     Utility::Set(obj, "offset", ConversionUtility::toJsNumber(evt->offset));
     Utility::Set(obj, "len", ConversionUtility::toJsNumber(evt->len));
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    ConversionUtility::setValueBuffer(obj, "data", "raw", evt->data, evt->len);
 
     return scope.Escape(obj);
 }
@@ -294,7 +294,7 @@ v8::Local<v8::Object> GattsRWAuthorizeRequestEvent::ToJs()
     else if (evt->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
     {
         Utility::Set(obj, "read", ConversionUtility::toJsNumber(0));
-        Utility::Set(obj, "write", GattsWriteEvent(timestamp, conn_handle, &evt->request.write).ToJs());
+        Utility::Set(obj, "write", GattsWriteEvent(time, conn_handle, &evt->request.write).ToJs());
     }
     else
     {
@@ -389,7 +389,7 @@ NAN_METHOD(Adapter::GattsAddService)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddService, reinterpret_cast<uv_after_work_cb>(AfterGattsAddService));
+    obj->commandExecutor.queue(baton->req, GattsAddService, AfterGattsAddService);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -478,7 +478,7 @@ NAN_METHOD(Adapter::GattsAddCharacteristic)
 
     baton->p_handles = new ble_gatts_char_handles_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddCharacteristic, reinterpret_cast<uv_after_work_cb>(AfterGattsAddCharacteristic));
+    obj->commandExecutor.queue(baton->req, GattsAddCharacteristic, AfterGattsAddCharacteristic);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -509,7 +509,6 @@ void Adapter::AfterGattsAddCharacteristic(uv_work_t *req)
 
     baton->callback->Call(2, argv);
 
-    delete baton->p_handles;
     delete baton;
 }
 
@@ -554,7 +553,7 @@ NAN_METHOD(Adapter::GattsAddDescriptor)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddDescriptor, reinterpret_cast<uv_after_work_cb>(AfterGattsAddDescriptor));
+    obj->commandExecutor.queue(baton->req, GattsAddDescriptor, AfterGattsAddDescriptor);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -585,7 +584,6 @@ void Adapter::AfterGattsAddDescriptor(uv_work_t *req)
 
     baton->callback->Call(2, argv);
 
-    delete baton->p_attr;
     delete baton;
 }
 
@@ -621,7 +619,7 @@ NAN_METHOD(Adapter::GattsHVX)
 
     try
     {
-        baton->p_hvx_params = GattsHVXParams(hvx_params);
+        baton->p_hvx_params = GattsHVXParams(hvx_params, baton->copied);
     }
     catch (std::string error)
     {
@@ -630,7 +628,7 @@ NAN_METHOD(Adapter::GattsHVX)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsHVX, reinterpret_cast<uv_after_work_cb>(AfterGattsHVX));
+    obj->commandExecutor.queue(baton->req, GattsHVX, AfterGattsHVX);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -661,8 +659,6 @@ void Adapter::AfterGattsHVX(uv_work_t *req)
 
     baton->callback->Call(1, argv);
 
-    delete baton->p_hvx_params->p_len;
-    delete baton->p_hvx_params;
     delete baton;
 }
 
@@ -724,7 +720,7 @@ NAN_METHOD(Adapter::GattsSystemAttributeSet)
     baton->len = len;
     baton->flags = flags;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsSystemAttributeSet, reinterpret_cast<uv_after_work_cb>(AfterGattsSystemAttributeSet));
+    obj->commandExecutor.queue(baton->req, GattsSystemAttributeSet, AfterGattsSystemAttributeSet);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -753,7 +749,6 @@ void Adapter::AfterGattsSystemAttributeSet(uv_work_t *req)
 
     baton->callback->Call(1, argv);
 
-    delete baton->p_sys_attr_data;
     delete baton;
 }
 
@@ -794,7 +789,7 @@ NAN_METHOD(Adapter::GattsSetValue)
 
     try
     {
-        baton->p_value = GattsValue(value);
+        baton->p_value = GattsValue(value, baton->copied);
     }
     catch (std::string error)
     {
@@ -803,7 +798,7 @@ NAN_METHOD(Adapter::GattsSetValue)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsSetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsSetValue));
+    obj->commandExecutor.queue(baton->req, GattsSetValue, AfterGattsSetValue);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -834,7 +829,6 @@ void Adapter::AfterGattsSetValue(uv_work_t *req)
 
     baton->callback->Call(2, argv);
 
-    delete baton->p_value;
     delete baton;
 }
 
@@ -875,7 +869,7 @@ NAN_METHOD(Adapter::GattsGetValue)
 
     try
     {
-        baton->p_value = GattsValue(value);
+        baton->p_value = GattsValue(value, baton->copied);
     }
     catch (std::string error)
     {
@@ -884,7 +878,7 @@ NAN_METHOD(Adapter::GattsGetValue)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsGetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsGetValue));
+    obj->commandExecutor.queue(baton->req, GattsGetValue, AfterGattsGetValue);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -915,7 +909,6 @@ void Adapter::AfterGattsGetValue(uv_work_t *req)
 
     baton->callback->Call(2, argv);
 
-    delete baton->p_value;
     delete baton;
 }
 
@@ -960,7 +953,7 @@ NAN_METHOD(Adapter::GattsReplyReadWriteAuthorize)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsReplyReadWriteAuthorize, reinterpret_cast<uv_after_work_cb>(AfterGattsReplyReadWriteAuthorize));
+    obj->commandExecutor.queue(baton->req, GattsReplyReadWriteAuthorize, AfterGattsReplyReadWriteAuthorize);
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -989,11 +982,183 @@ void Adapter::AfterGattsReplyReadWriteAuthorize(uv_work_t *req)
 
     baton->callback->Call(1, argv);
 
-    delete baton->p_rw_authorize_reply_params;
     delete baton;
 }
 
 
+NAN_METHOD(Adapter::GattsOpenNotificationStream)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint16_t conn_handle;
+    uint16_t handle;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    uint32_t id;
+    auto result = obj->notificationStreams.open(obj->adapter, conn_handle, handle, &id);
+
+    if (result != NRF_SUCCESS)
+    {
+        Nan::ThrowException(ErrorMessage::getErrorMessage(result, "opening notification stream"));
+        return;
+    }
+
+    obj->notificationStreamCallbacks[id] = new Nan::Callback(callback);
+
+    info.GetReturnValue().Set(ConversionUtility::toJsNumber(id));
+}
+
+NAN_METHOD(Adapter::GattsWriteNotificationStream)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint32_t id;
+    v8::Local<v8::Value> data;
+    auto argumentcount = 0;
+
+    try
+    {
+        id = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+
+        if (!info[argumentcount]->IsArrayBufferView() && !info[argumentcount]->IsArray())
+        {
+            throw "array or Buffer";
+        }
+
+        data = info[argumentcount];
+        argumentcount++;
+    }
+    catch (char const *error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    uint32_t result;
+
+    if (data->IsArrayBufferView())
+    {
+        // The data is copied into the stream, so the contents of a Buffer are used as they are
+        Nan::TypedArrayContents<uint8_t> contents(data);
+        result = obj->notificationStreams.write(id, *contents, contents.length());
+    }
+    else
+    {
+        auto length = v8::Local<v8::Array>::Cast(data)->Length();
+        auto bytes = ConversionUtility::getNativePointerToUint8(data);
+        result = obj->notificationStreams.write(id, bytes, length);
+        free(bytes);
+    }
+
+    if (result != NRF_SUCCESS)
+    {
+        Nan::ThrowException(ErrorMessage::getErrorMessage(result, "writing to notification stream"));
+    }
+}
+
+NAN_METHOD(Adapter::GattsCloseNotificationStream)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint32_t id;
+    auto argumentcount = 0;
+
+    try
+    {
+        id = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto result = obj->notificationStreams.close(id);
+
+    if (result != NRF_SUCCESS)
+    {
+        Nan::ThrowException(ErrorMessage::getErrorMessage(result, "closing notification stream"));
+    }
+}
+
+// This runs in Main Thread, once for all the progress made on the streams since the last call
+void Adapter::onNotificationStreamReports(void *context, const std::vector<NotificationStreamProgress> &reports)
+{
+    Nan::HandleScope scope;
+
+    auto obj = static_cast<Adapter *>(context);
+
+    for (auto &report : reports)
+    {
+        auto it = obj->notificationStreamCallbacks.find(report.id);
+
+        if (it == obj->notificationStreamCallbacks.end())
+        {
+            continue;
+        }
+
+        auto callback = it->second;
+
+        if (report.finished)
+        {
+            obj->notificationStreamCallbacks.erase(it);
+        }
+
+        v8::Local<v8::Value> argv[2];
+
+        if (report.error != NRF_SUCCESS)
+        {
+            argv[0] = ErrorMessage::getErrorMessage(report.error, "streaming notifications");
+        }
+        else
+        {
+            argv[0] = Nan::Undefined();
+        }
+
+        auto progress = Nan::New<v8::Object>();
+        Utility::Set(progress, "id", report.id);
+        Utility::Set(progress, "bytesQueued", report.bytesQueued);
+        Utility::Set(progress, "bytesSent", static_cast<double>(report.bytesSent));
+        Utility::Set(progress, "packetsSent", static_cast<double>(report.packetsSent));
+        Utility::Set(progress, "finished", report.finished);
+        argv[1] = progress;
+
+        callback->Call(2, argv);
+
+        if (report.finished)
+        {
+            delete callback;
+        }
+    }
+}
+
+
 extern "C" {
     void init_gatts(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
     {
@@ -79,17 +79,23 @@ class GattsHVXParams : public BleToJs<ble_gatts_hvx_params_t>
 {
 public:
     GattsHVXParams(ble_gatts_hvx_params_t *hvx_params) : BleToJs<ble_gatts_hvx_params_t>(hvx_params) {}
-    GattsHVXParams(v8::Local<v8::Object> js) : BleToJs<ble_gatts_hvx_params_t>(js) {}
+    GattsHVXParams(v8::Local<v8::Object> js, std::vector<uint8_t> &copied) : BleToJs<ble_gatts_hvx_params_t>(js), copied(&copied) {}
     ble_gatts_hvx_params_t *ToNative() override;
+
+private:
+    std::vector<uint8_t> *copied = nullptr; // Holds the data pointed into
 };
 
 class GattsValue : public BleToJs<ble_gatts_value_t>
 {
 public:
     GattsValue(ble_gatts_value_t *value) : BleToJs<ble_gatts_value_t>(value) {}
-    GattsValue(v8::Local<v8::Object> js) : BleToJs<ble_gatts_value_t>(js) {}
+    GattsValue(v8::Local<v8::Object> js, std::vector<uint8_t> &copied) : BleToJs<ble_gatts_value_t>(js), copied(&copied) {}
     v8::Local<v8::Object> ToJs() override;
     ble_gatts_value_t *ToNative() override;
+
+private:
+    std::vector<uint8_t> *copied = nullptr; // Holds the value pointed into
 };
 
 class GattGattsReplyReadWriteAuthorizeParams : public BleToJs<ble_gatts_rw_authorize_reply_params_t>
@@ -116,8 +122,8 @@ private:
     BleDriverGattsEvent() {}
 
 public:
-    BleDriverGattsEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, EventType *evt)
-        : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt)
+    BleDriverGattsEvent(uint16_t evt_id, const EventTime &time, uint16_t conn_handle, EventType *evt)
+        : BleDriverEvent<EventType>(evt_id, time, conn_handle, evt)
     {
     }
 
@@ -135,8 +141,8 @@ public:
 class GattsWriteEvent : BleDriverGattsEvent<ble_gatts_evt_write_t>
 {
 public:
-    GattsWriteEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_write_t *evt)
-        : BleDriverGattsEvent<ble_gatts_evt_write_t>(BLE_GATTS_EVT_WRITE, timestamp, conn_handle, evt) {}
+    GattsWriteEvent(const EventTime &time, uint16_t conn_handle, ble_gatts_evt_write_t *evt)
+        : BleDriverGattsEvent<ble_gatts_evt_write_t>(BLE_GATTS_EVT_WRITE, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -152,8 +158,8 @@ public:
 class GattsRWAuthorizeRequestEvent : BleDriverGattsEvent<ble_gatts_evt_rw_authorize_request_t>
 {
 public:
-    GattsRWAuthorizeRequestEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_rw_authorize_request_t *evt)
-        : BleDriverGattsEvent<ble_gatts_evt_rw_authorize_request_t>(BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST, timestamp, conn_handle, evt) {}
+    GattsRWAuthorizeRequestEvent(const EventTime &time, uint16_t conn_handle, ble_gatts_evt_rw_authorize_request_t *evt)
+        : BleDriverGattsEvent<ble_gatts_evt_rw_authorize_request_t>(BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -161,8 +167,8 @@ public:
 class GattsSystemAttributeMissingEvent : BleDriverGattsEvent<ble_gatts_evt_sys_attr_missing_t>
 {
 public:
-    GattsSystemAttributeMissingEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_sys_attr_missing_t *evt)
-        : BleDriverGattsEvent<ble_gatts_evt_sys_attr_missing_t>(BLE_GATTS_EVT_SYS_ATTR_MISSING, timestamp, conn_handle, evt) {}
+    GattsSystemAttributeMissingEvent(const EventTime &time, uint16_t conn_handle, ble_gatts_evt_sys_attr_missing_t *evt)
+        : BleDriverGattsEvent<ble_gatts_evt_sys_attr_missing_t>(BLE_GATTS_EVT_SYS_ATTR_MISSING, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -170,8 +176,8 @@ public:
 class GattsHVCEvent : BleDriverGattsEvent<ble_gatts_evt_hvc_t>
 {
 public:
-    GattsHVCEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_hvc_t *evt)
-        : BleDriverGattsEvent<ble_gatts_evt_hvc_t>(BLE_GATTS_EVT_HVC, timestamp, conn_handle, evt) {}
+    GattsHVCEvent(const EventTime &time, uint16_t conn_handle, ble_gatts_evt_hvc_t *evt)
+        : BleDriverGattsEvent<ble_gatts_evt_hvc_t>(BLE_GATTS_EVT_HVC, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -179,8 +185,8 @@ public:
 class GattsSCConfirmEvent : BleDriverGattsEvent<ble_gatts_evt_timeout_t>
 {
 public:
-    GattsSCConfirmEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
-        : BleDriverGattsEvent<ble_gatts_evt_timeout_t>(BLE_GATTS_EVT_SC_CONFIRM, timestamp, conn_handle, evt) {}
+    GattsSCConfirmEvent(const EventTime &time, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
+        : BleDriverGattsEvent<ble_gatts_evt_timeout_t>(BLE_GATTS_EVT_SC_CONFIRM, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -188,8 +194,8 @@ public:
 class GattsTimeoutEvent : BleDriverGattsEvent<ble_gatts_evt_timeout_t>
 {
 public:
-    GattsTimeoutEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
-        : BleDriverGattsEvent<ble_gatts_evt_timeout_t>(BLE_GATTS_EVT_TIMEOUT, timestamp, conn_handle, evt) {}
+    GattsTimeoutEvent(const EventTime &time, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
+        : BleDriverGattsEvent<ble_gatts_evt_timeout_t>(BLE_GATTS_EVT_TIMEOUT, time, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
 };
@@ -205,6 +211,7 @@ public:
 struct GattsAddCharacteristicBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsAddCharacteristicBaton);
+    BATON_DESTRUCTOR(GattsAddCharacteristicBaton) { delete p_handles; }
     uint16_t service_handle;
     ble_gatts_char_md_t *p_char_md;
     ble_gatts_attr_t *p_attr_char_value;
@@ -214,6 +221,7 @@ public:
 struct GattsAddDescriptorBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsAddDescriptorBaton);
+    BATON_DESTRUCTOR(GattsAddDescriptorBaton) { delete p_attr; }
     uint16_t char_handle;
     ble_gatts_attr_t *p_attr;
     uint16_t p_handle;
@@ -222,6 +230,7 @@ public:
 struct GattsHVXBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsHVXBaton);
+    BATON_DESTRUCTOR(GattsHVXBaton) { delete p_hvx_params->p_len; delete p_hvx_params; }
     uint16_t conn_handle;
     ble_gatts_hvx_params_t *p_hvx_params;
 };
@@ -229,6 +238,7 @@ public:
 struct GattsSystemAttributeSetBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsSystemAttributeSetBaton);
+    BATON_DESTRUCTOR(GattsSystemAttributeSetBaton) { delete p_sys_attr_data; }
     uint16_t conn_handle;
     uint8_t *p_sys_attr_data;
     uint16_t len;
@@ -238,6 +248,7 @@ public:
 struct GattsSetValueBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsSetValueBaton);
+    BATON_DESTRUCTOR(GattsSetValueBaton) { delete p_value; }
     uint16_t conn_handle;
     uint16_t handle;
     ble_gatts_value_t *p_value;
@@ -246,6 +257,7 @@ public:
 struct GattsGetValueBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsGetValueBaton);
+    BATON_DESTRUCTOR(GattsGetValueBaton) { delete p_value; }
     uint16_t conn_handle;
     uint16_t handle;
     ble_gatts_value_t *p_value;
@@ -254,6 +266,7 @@ public:
 struct GattsReplyReadWriteAuthorizeBaton : public Baton {
 public:
     BATON_CONSTRUCTOR(GattsReplyReadWriteAuthorizeBaton);
+    BATON_DESTRUCTOR(GattsReplyReadWriteAuthorizeBaton) { delete p_rw_authorize_reply_params; }
     uint16_t conn_handle;
     ble_gatts_rw_authorize_reply_params_t *p_rw_authorize_reply_params;
 };
@@ -0,0 +1,187 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "event_batch.h"
+
+#include <cstring>
+
+namespace
+{
+    const size_t RECORD_ALIGNMENT = 8;
+
+    const size_t ADV_REPORT_HEADER_LENGTH = 10;
+    const size_t HVX_HEADER_LENGTH = 10;
+
+    void encodeUint16(uint8_t *destination, uint16_t value)
+    {
+        destination[0] = static_cast<uint8_t>(value & 0xFF);
+        destination[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void encodeUint32(uint8_t *destination, uint32_t value)
+    {
+        encodeUint16(destination, static_cast<uint16_t>(value & 0xFFFF));
+        encodeUint16(destination + 2, static_cast<uint16_t>(value >> 16));
+    }
+
+    // All platforms supported by the driver are little endian, the double is therefore copied as is
+    void encodeDouble(uint8_t *destination, double value)
+    {
+        std::memcpy(destination, &value, sizeof(value));
+    }
+
+    size_t alignRecordLength(size_t length)
+    {
+        return (length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+    }
+}
+
+bool EventBatch::isPacked(uint16_t evt_id)
+{
+    switch (evt_id)
+    {
+        case BLE_EVT_TX_COMPLETE:
+        case BLE_GAP_EVT_RSSI_CHANGED:
+        case BLE_GAP_EVT_ADV_REPORT:
+        case BLE_GATTC_EVT_HVX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t EventBatch::recordLength(const ble_evt_t *event)
+{
+    return alignRecordLength(RECORD_HEADER_LENGTH + payloadLength(event));
+}
+
+void EventBatch::writeHeader(uint8_t *batch, uint32_t eventCount)
+{
+    encodeUint16(batch, VERSION);
+    encodeUint16(batch + 2, 0);
+    encodeUint32(batch + 4, eventCount);
+}
+
+size_t EventBatch::writeRecord(uint8_t *record, const ble_evt_t *event, double time)
+{
+    auto length = recordLength(event);
+    auto packed = isPacked(event->header.evt_id);
+
+    std::memset(record, 0, length);
+
+    encodeUint16(record, static_cast<uint16_t>(length));
+    encodeUint16(record + 2, event->header.evt_id);
+    encodeUint16(record + 4, connectionHandle(event));
+    record[6] = packed ? RECORD_PACKED : RECORD_OBJECT;
+    encodeDouble(record + 8, time);
+
+    auto payload = record + RECORD_HEADER_LENGTH;
+
+    switch (event->header.evt_id)
+    {
+        case BLE_EVT_TX_COMPLETE:
+            payload[0] = event->evt.common_evt.params.tx_complete.count;
+            break;
+
+        case BLE_GAP_EVT_RSSI_CHANGED:
+            payload[0] = static_cast<uint8_t>(event->evt.gap_evt.params.rssi_changed.rssi);
+            break;
+
+        case BLE_GAP_EVT_ADV_REPORT:
+        {
+            auto report = &(event->evt.gap_evt.params.adv_report);
+            payload[0] = report->peer_addr.addr_type;
+            std::memcpy(payload + 1, report->peer_addr.addr, BLE_GAP_ADDR_LEN);
+            payload[7] = static_cast<uint8_t>(report->rssi);
+            payload[8] = static_cast<uint8_t>(report->scan_rsp | (report->type << 1));
+            payload[9] = report->dlen;
+            std::memcpy(payload + ADV_REPORT_HEADER_LENGTH, report->data, report->dlen);
+            break;
+        }
+
+        case BLE_GATTC_EVT_HVX:
+        {
+            auto gattc_event = &(event->evt.gattc_evt);
+            auto hvx = &(gattc_event->params.hvx);
+            auto dataLength = hvxDataLength(event);
+            encodeUint16(payload, gattc_event->gatt_status);
+            encodeUint16(payload + 2, gattc_event->error_handle);
+            encodeUint16(payload + 4, hvx->handle);
+            payload[6] = hvx->type;
+            encodeUint16(payload + 8, dataLength);
+            std::memcpy(payload + HVX_HEADER_LENGTH, hvx->data, dataLength);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return length;
+}
+
+size_t EventBatch::payloadLength(const ble_evt_t *event)
+{
+    switch (event->header.evt_id)
+    {
+        case BLE_EVT_TX_COMPLETE:
+        case BLE_GAP_EVT_RSSI_CHANGED:
+            return 1;
+        case BLE_GAP_EVT_ADV_REPORT:
+            return ADV_REPORT_HEADER_LENGTH + event->evt.gap_evt.params.adv_report.dlen;
+        case BLE_GATTC_EVT_HVX:
+            return HVX_HEADER_LENGTH + hvxDataLength(event);
+        default:
+            return 0;
+    }
+}
+
+// The HVX data is a variable length array, only the part that fits in the decoded event is used.
+// The event length reported by the driver does not include the event header.
+uint16_t EventBatch::hvxDataLength(const ble_evt_t *event)
+{
+    auto dataOffset = offsetof(ble_evt_t, evt.gattc_evt.params.hvx.data) - offsetof(ble_evt_t, evt);
+    auto length = event->evt.gattc_evt.params.hvx.len;
+
+    if (event->header.evt_len <= dataOffset)
+    {
+        return 0;
+    }
+
+    if (length > event->header.evt_len - dataOffset)
+    {
+        return static_cast<uint16_t>(event->header.evt_len - dataOffset);
+    }
+
+    return length;
+}
+
+// The connection handle is the first member of all the event groups
+uint16_t EventBatch::connectionHandle(const ble_evt_t *event)
+{
+    auto evt_id = event->header.evt_id;
+
+    if (evt_id >= BLE_GATTS_EVT_BASE && evt_id < BLE_L2CAP_EVT_BASE)
+    {
+        return event->evt.gatts_evt.conn_handle;
+    }
+    else if (evt_id >= BLE_GATTC_EVT_BASE && evt_id < BLE_GATTS_EVT_BASE)
+    {
+        return event->evt.gattc_evt.conn_handle;
+    }
+    else if (evt_id >= BLE_GAP_EVT_BASE && evt_id < BLE_GATTC_EVT_BASE)
+    {
+        return event->evt.gap_evt.conn_handle;
+    }
+
+    return event->evt.common_evt.conn_handle;
+}
@@ -0,0 +1,90 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef EVENT_BATCH_H
+#define EVENT_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sd_rpc.h"
+
+/*
+ * Layout of the event batches sent to JavaScript when the adapter is opened with eventFormat 'binary'.
+ * The batch is one ArrayBuffer, all values are little endian. api/util/eventBatch.js reads this layout.
+ *
+ * Batch header, 8 bytes:
+ *   0   uint16   format version, EventBatch::VERSION
+ *   2   uint16   reserved
+ *   4   uint32   number of event records
+ *
+ * Event record, starts at an 8 byte boundary:
+ *   0   uint16   record length, including header and padding
+ *   2   uint16   event id
+ *   4   uint16   connection handle
+ *   6   uint8    encoding, EventBatch::RECORD_OBJECT or EventBatch::RECORD_PACKED
+ *   7   uint8    reserved
+ *   8   float64  time the event was read from the serial port, milliseconds since epoch
+ *   16  payload, only present for RECORD_PACKED
+ *
+ * A RECORD_OBJECT event is converted to a JavaScript object as in the object format, and is
+ * the next unread entry of the object array that is passed together with the batch.
+ *
+ * RECORD_PACKED payloads:
+ *   BLE_EVT_TX_COMPLETE
+ *     0   uint8    count
+ *   BLE_GAP_EVT_RSSI_CHANGED
+ *     0   int8     rssi
+ *   BLE_GAP_EVT_ADV_REPORT
+ *     0   uint8    peer address type
+ *     1   uint8[6] peer address, least significant byte first
+ *     7   int8     rssi
+ *     8   uint8    bit 0: scan_rsp, bit 1-2: advertising type
+ *     9   uint8    data length
+ *     10  uint8[]  advertising or scan response data
+ *   BLE_GATTC_EVT_HVX
+ *     0   uint16   gatt status
+ *     2   uint16   error handle
+ *     4   uint16   attribute handle
+ *     6   uint8    type, notification or indication
+ *     7   uint8    reserved
+ *     8   uint16   data length
+ *     10  uint8[]  attribute data
+ */
+class EventBatch
+{
+public:
+    static const uint16_t VERSION = 1;
+    static const size_t HEADER_LENGTH = 8;
+    static const size_t RECORD_HEADER_LENGTH = 16;
+
+    static const uint8_t RECORD_OBJECT = 0;
+    static const uint8_t RECORD_PACKED = 1;
+
+    // Returns true if the event is packed into the batch, false if it is delivered as a JavaScript object
+    static bool isPacked(uint16_t evt_id);
+
+    // Number of bytes the event occupies in the batch, including padding
+    static size_t recordLength(const ble_evt_t *event);
+
+    static void writeHeader(uint8_t *batch, uint32_t eventCount);
+
+    // Writes the event record at record and returns the number of bytes written
+    static size_t writeRecord(uint8_t *record, const ble_evt_t *event, double time);
+
+private:
+    static size_t payloadLength(const ble_evt_t *event);
+    static uint16_t hvxDataLength(const ble_evt_t *event);
+    static uint16_t connectionHandle(const ble_evt_t *event);
+};
+
+#endif // EVENT_BATCH_H
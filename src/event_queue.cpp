@@ -0,0 +1,222 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "event_queue.h"
+
+#include <algorithm>
+
+EventQueue::EventQueue() :
+    memoryLimit(DEFAULT_MEMORY_LIMIT),
+    highWatermark(DEFAULT_HIGH_WATERMARK),
+    highWatermarkReached(false),
+    coalescing(false),
+    coalescedCount(0),
+    oldestReadTime(0),
+    memory(0),
+    maxMemory(0),
+    maxCount(0)
+{}
+
+EventQueue::~EventQueue()
+{
+    for (auto eventEntry : entries)
+    {
+        sd_rpc_evt_release(eventEntry->event);
+        delete eventEntry;
+    }
+}
+
+void EventQueue::setLimits(size_t memory_limit, uint32_t high_watermark)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    memoryLimit = memory_limit;
+    highWatermark = high_watermark;
+}
+
+void EventQueue::setCoalescing(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    coalescing = enabled;
+}
+
+bool EventQueue::push(EventEntry *eventEntry, uint32_t &count)
+{
+    auto size = entrySize(eventEntry);
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    coalescing_key_t key;
+    auto coalescable = coalescing && coalescingKey(eventEntry->event, key);
+
+    if (coalescable)
+    {
+        auto superseded = coalescingEntries.find(key);
+
+        if (superseded != coalescingEntries.end())
+        {
+            // Keep the position of the superseded event in the queue, but with the content of the new event
+            auto queuedEntry = superseded->second;
+            memory = memory - entrySize(queuedEntry) + size;
+            maxMemory = std::max(maxMemory, memory);
+
+            sd_rpc_evt_release(queuedEntry->event);
+            *queuedEntry = *eventEntry;
+            delete eventEntry;
+
+            coalescedCount++;
+            count = static_cast<uint32_t>(entries.size());
+            return true;
+        }
+    }
+
+    if (memory + size > memoryLimit)
+    {
+        dropCounts[eventEntry->event->header.evt_id]++;
+        return false;
+    }
+
+    if (entries.empty())
+    {
+        oldestReadTime = eventEntry->readTime;
+    }
+
+    entries.push_back(eventEntry);
+    memory += size;
+
+    if (coalescable)
+    {
+        coalescingEntries[key] = eventEntry;
+    }
+
+    count = static_cast<uint32_t>(entries.size());
+
+    maxMemory = std::max(maxMemory, memory);
+    maxCount = std::max(maxCount, static_cast<uint32_t>(entries.size()));
+
+    return true;
+}
+
+void EventQueue::takeAll(std::vector<EventEntry *> &eventEntries)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    eventEntries.insert(eventEntries.end(), entries.begin(), entries.end());
+    entries.clear();
+    coalescingEntries.clear();
+    memory = 0;
+}
+
+bool EventQueue::wasEmpty() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return entries.empty();
+}
+
+bool EventQueue::getBacklog(uint32_t &count, uint64_t &readTime) const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    if (entries.empty())
+    {
+        return false;
+    }
+
+    count = static_cast<uint32_t>(entries.size());
+    readTime = oldestReadTime;
+    return true;
+}
+
+bool EventQueue::updateHighWatermark(bool &reached, uint32_t &count)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    count = static_cast<uint32_t>(entries.size());
+
+    if (!highWatermarkReached && count >= highWatermark)
+    {
+        highWatermarkReached = true;
+    }
+    else if (highWatermarkReached && count <= highWatermark / 2)
+    {
+        highWatermarkReached = false;
+    }
+    else
+    {
+        return false;
+    }
+
+    reached = highWatermarkReached;
+    return true;
+}
+
+uint32_t EventQueue::getMaxCount() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return maxCount;
+}
+
+size_t EventQueue::getMaxMemory() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return maxMemory;
+}
+
+std::map<uint16_t, uint32_t> EventQueue::getDropCounts() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return dropCounts;
+}
+
+uint32_t EventQueue::getCoalescedCount() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return coalescedCount;
+}
+
+// Events are allocated with their decoded size, but never smaller than ble_evt_t
+size_t EventQueue::entrySize(const EventEntry *eventEntry)
+{
+    auto eventSize = sizeof(ble_evt_hdr_t) + eventEntry->event->header.evt_len;
+    return sizeof(EventEntry) + std::max(eventSize, sizeof(ble_evt_t));
+}
+
+bool EventQueue::coalescingKey(const ble_evt_t *event, coalescing_key_t &key)
+{
+    auto evt_id = event->header.evt_id;
+
+    if (evt_id == BLE_GAP_EVT_RSSI_CHANGED)
+    {
+        key = coalescing_key_t(evt_id, event->evt.gap_evt.conn_handle);
+        return true;
+    }
+
+    if (evt_id == BLE_GAP_EVT_ADV_REPORT)
+    {
+        // Advertisements and scan responses of a peer do not supersede each other
+        auto &report = event->evt.gap_evt.params.adv_report;
+        uint64_t address = 0;
+
+        for (auto i = BLE_GAP_ADDR_LEN; i > 0; i--)
+        {
+            address = (address << 8) | report.peer_addr.addr[i - 1];
+        }
+
+        address |= static_cast<uint64_t>(report.peer_addr.addr_type) << 48;
+        address |= static_cast<uint64_t>(report.scan_rsp) << 56;
+        address |= static_cast<uint64_t>(report.type) << 57;
+
+        key = coalescing_key_t(evt_id, address);
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sd_rpc.h"
+
+// Status codes of the addon, reported to the status callback like the driver status codes in sd_rpc_app_status_t.
+// Numbered apart from the driver status codes so that they do not collide with codes added to the driver.
+enum event_queue_status_t
+{
+    EVENT_QUEUE_HIGH_WATERMARK_REACHED = 0x100,
+    EVENT_QUEUE_HIGH_WATERMARK_CLEARED
+};
+
+struct EventEntry {
+public:
+    ble_evt_t *event;
+    uint64_t readTime; // Time the event was read from the serial port, nanoseconds of std::chrono::steady_clock
+    int adapterID;
+};
+
+/*
+ * Events waiting to be sent to JavaScript. Events are pushed by the driver event thread and popped
+ * by the NodeJS thread. The queue grows as needed until the memory used by the queued events
+ * reaches the memory limit, events received after that are dropped and counted per event id.
+ *
+ * With coalescing enabled, an event that supersedes a queued event replaces it in place instead of being
+ * queued after it: BLE_GAP_EVT_RSSI_CHANGED per connection, and BLE_GAP_EVT_ADV_REPORT per peer address
+ * and report type. Events are only coalesced while they wait in the queue, so the coalescing window is
+ * the time until the next batch is sent to JavaScript.
+ */
+class EventQueue
+{
+public:
+    static const size_t DEFAULT_MEMORY_LIMIT = 16 * 1024 * 1024;
+    static const uint32_t DEFAULT_HIGH_WATERMARK = 1024;
+
+    EventQueue();
+    ~EventQueue();
+
+    // memoryLimit is in bytes, highWatermark in number of events
+    void setLimits(size_t memoryLimit, uint32_t highWatermark);
+    void setCoalescing(bool coalescing);
+
+    // Returns false if the event is dropped, the caller is then still the owner of eventEntry.
+    // count is set to the number of queued events, including eventEntry.
+    bool push(EventEntry *eventEntry, uint32_t &count);
+
+    // Moves all queued events to the end of eventEntries, oldest first
+    void takeAll(std::vector<EventEntry *> &eventEntries);
+    bool wasEmpty() const;
+
+    // Number of queued events and the read time of the oldest of them. Returns false if the queue is empty.
+    bool getBacklog(uint32_t &count, uint64_t &oldestReadTime) const;
+
+    // Compares the number of queued events with the high watermark. The watermark is reached when the queue holds
+    // highWatermark events, and cleared when it holds half of that or less. Returns true if the state changed.
+    bool updateHighWatermark(bool &reached, uint32_t &count);
+
+    // Largest number of events and bytes queued at the same time
+    uint32_t getMaxCount() const;
+    size_t getMaxMemory() const;
+
+    // Number of dropped events, indexed by event id
+    std::map<uint16_t, uint32_t> getDropCounts() const;
+
+    // Number of events replaced by a superseding event
+    uint32_t getCoalescedCount() const;
+
+private:
+    typedef std::pair<uint16_t, uint64_t> coalescing_key_t; // Event id and connection handle or peer address
+
+    static size_t entrySize(const EventEntry *eventEntry);
+    static bool coalescingKey(const ble_evt_t *event, coalescing_key_t &key);
+
+    mutable std::mutex queueMutex;
+    std::deque<EventEntry *> entries;
+
+    size_t memoryLimit;
+    uint32_t highWatermark;
+    bool highWatermarkReached;
+
+    bool coalescing;
+    std::map<coalescing_key_t, EventEntry *> coalescingEntries; // Queued events that may be superseded
+    uint32_t coalescedCount;
+    uint64_t oldestReadTime;
+
+    size_t memory;
+    size_t maxMemory;
+    uint32_t maxCount;
+    std::map<uint16_t, uint32_t> dropCounts;
+};
+
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,354 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "gatt_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+static const uint8_t FILE_MAGIC[] = { 'G', 'A', 'T', 'C' };
+static const uint8_t FILE_VERSION = 1;
+
+namespace {
+
+class Writer
+{
+public:
+    explicit Writer(std::vector<uint8_t> &data) : data(data) {}
+
+    void u8(uint8_t value)
+    {
+        data.push_back(value);
+    }
+
+    void u16(uint16_t value)
+    {
+        data.push_back(static_cast<uint8_t>(value));
+        data.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void u32(uint32_t value)
+    {
+        u16(static_cast<uint16_t>(value));
+        u16(static_cast<uint16_t>(value >> 16));
+    }
+
+    void bytes(const std::vector<uint8_t> &value)
+    {
+        u8(static_cast<uint8_t>(value.size()));
+        data.insert(data.end(), value.begin(), value.end());
+    }
+
+    void uuid(const ble_uuid_t &value)
+    {
+        u16(value.uuid);
+        u8(value.type);
+    }
+
+private:
+    std::vector<uint8_t> &data;
+};
+
+// A read past the end sets ok to false and returns 0, so that the result is only checked once at the end
+class Reader
+{
+public:
+    explicit Reader(const std::vector<uint8_t> &data) : data(data), position(0), ok(true) {}
+
+    uint8_t u8()
+    {
+        if (position + 1 > data.size())
+        {
+            ok = false;
+            return 0;
+        }
+
+        return data[position++];
+    }
+
+    uint16_t u16()
+    {
+        auto low = u8();
+        return static_cast<uint16_t>(low | (u8() << 8));
+    }
+
+    uint32_t u32()
+    {
+        auto low = u16();
+        return low | (static_cast<uint32_t>(u16()) << 16);
+    }
+
+    std::vector<uint8_t> bytes()
+    {
+        auto length = u8();
+
+        if (position + length > data.size())
+        {
+            ok = false;
+            return std::vector<uint8_t>();
+        }
+
+        std::vector<uint8_t> value(data.begin() + position, data.begin() + position + length);
+        position += length;
+        return value;
+    }
+
+    ble_uuid_t uuid()
+    {
+        ble_uuid_t value;
+        value.uuid = u16();
+        value.type = u8();
+        return value;
+    }
+
+    bool atEnd() const
+    {
+        return position == data.size();
+    }
+
+    const std::vector<uint8_t> &data;
+    size_t position;
+    bool ok;
+};
+
+uint8_t encodeProperties(const ble_gatt_char_props_t &props)
+{
+    return static_cast<uint8_t>(props.broadcast
+        | (props.read << 1)
+        | (props.write_wo_resp << 2)
+        | (props.write << 3)
+        | (props.notify << 4)
+        | (props.indicate << 5)
+        | (props.auth_signed_wr << 6));
+}
+
+ble_gatt_char_props_t decodeProperties(uint8_t value)
+{
+    ble_gatt_char_props_t props;
+    props.broadcast = value & 1;
+    props.read = (value >> 1) & 1;
+    props.write_wo_resp = (value >> 2) & 1;
+    props.write = (value >> 3) & 1;
+    props.notify = (value >> 4) & 1;
+    props.indicate = (value >> 5) & 1;
+    props.auth_signed_wr = (value >> 6) & 1;
+    return props;
+}
+
+} // namespace
+
+bool GattCache::find(const gatt_cache_key_t &key, GattCacheEntry &entry)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = entries.find(key);
+
+    if (it == entries.end())
+    {
+        return false;
+    }
+
+    entry = it->second;
+    return true;
+}
+
+void GattCache::store(const gatt_cache_key_t &key, const GattCacheEntry &entry)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    entries[key] = entry;
+}
+
+bool GattCache::remove(const gatt_cache_key_t &key)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return entries.erase(key) > 0;
+}
+
+void GattCache::clear()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    entries.clear();
+}
+
+uint32_t GattCache::getEntryCount()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return static_cast<uint32_t>(entries.size());
+}
+
+uint32_t GattCache::save(const std::string &path)
+{
+    std::vector<uint8_t> data;
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        encode(entries, data);
+    }
+
+    // Written next to the file and renamed, so that a failed write does not leave a truncated cache
+    auto temporaryPath = path + ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        if (!file)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+
+        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+        if (!file)
+        {
+            return NRF_ERROR_INTERNAL;
+        }
+    }
+
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows
+    std::remove(path.c_str());
+#endif
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t GattCache::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::map<gatt_cache_key_t, GattCacheEntry> loaded;
+
+    if (!decode(data, loaded))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    entries.swap(loaded);
+    return NRF_SUCCESS;
+}
+
+void GattCache::encode(const std::map<gatt_cache_key_t, GattCacheEntry> &entries, std::vector<uint8_t> &data)
+{
+    Writer writer(data);
+
+    data.insert(data.end(), std::begin(FILE_MAGIC), std::end(FILE_MAGIC));
+    writer.u8(FILE_VERSION);
+    writer.u32(static_cast<uint32_t>(entries.size()));
+
+    for (auto &entry : entries)
+    {
+        writer.bytes(entry.first);
+        writer.bytes(entry.second.databaseHash);
+        writer.u16(static_cast<uint16_t>(entry.second.services.size()));
+
+        for (auto &service : entry.second.services)
+        {
+            writer.u16(service.service.handle_range.start_handle);
+            writer.u16(service.service.handle_range.end_handle);
+            writer.uuid(service.service.uuid);
+            writer.u16(static_cast<uint16_t>(service.characteristics.size()));
+
+            for (auto &characteristic : service.characteristics)
+            {
+                writer.uuid(characteristic.characteristic.uuid);
+                writer.u8(encodeProperties(characteristic.characteristic.char_props));
+                writer.u8(characteristic.characteristic.char_ext_props);
+                writer.u16(characteristic.characteristic.handle_decl);
+                writer.u16(characteristic.characteristic.handle_value);
+                writer.u16(static_cast<uint16_t>(characteristic.descriptors.size()));
+
+                for (auto &descriptor : characteristic.descriptors)
+                {
+                    writer.u16(descriptor.handle);
+                    writer.uuid(descriptor.uuid);
+                }
+            }
+        }
+    }
+}
+
+bool GattCache::decode(const std::vector<uint8_t> &data, std::map<gatt_cache_key_t, GattCacheEntry> &entries)
+{
+    Reader reader(data);
+
+    for (auto magic : FILE_MAGIC)
+    {
+        if (reader.u8() != magic)
+        {
+            return false;
+        }
+    }
+
+    if (reader.u8() != FILE_VERSION)
+    {
+        return false;
+    }
+
+    auto entryCount = reader.u32();
+
+    for (uint32_t i = 0; i < entryCount && reader.ok; ++i)
+    {
+        auto key = reader.bytes();
+        auto &entry = entries[key];
+        entry.databaseHash = reader.bytes();
+
+        auto serviceCount = reader.u16();
+
+        for (auto j = 0; j < serviceCount && reader.ok; ++j)
+        {
+            DiscoveredService service;
+            service.service.handle_range.start_handle = reader.u16();
+            service.service.handle_range.end_handle = reader.u16();
+            service.service.uuid = reader.uuid();
+
+            auto characteristicCount = reader.u16();
+
+            for (auto k = 0; k < characteristicCount && reader.ok; ++k)
+            {
+                DiscoveredCharacteristic characteristic;
+                characteristic.characteristic.uuid = reader.uuid();
+                characteristic.characteristic.char_props = decodeProperties(reader.u8());
+                characteristic.characteristic.char_ext_props = reader.u8() & 1;
+                characteristic.characteristic.handle_decl = reader.u16();
+                characteristic.characteristic.handle_value = reader.u16();
+
+                auto descriptorCount = reader.u16();
+
+                for (auto l = 0; l < descriptorCount && reader.ok; ++l)
+                {
+                    ble_gattc_desc_t descriptor;
+                    descriptor.handle = reader.u16();
+                    descriptor.uuid = reader.uuid();
+                    characteristic.descriptors.push_back(descriptor);
+                }
+
+                service.characteristics.push_back(characteristic);
+            }
+
+            entry.services.push_back(service);
+        }
+    }
+
+    return reader.ok && reader.atEnd();
+}
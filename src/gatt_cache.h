@@ -0,0 +1,82 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef GATT_CACHE_H
+#define GATT_CACHE_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "sd_rpc.h"
+
+struct DiscoveredCharacteristic
+{
+    ble_gattc_char_t characteristic;
+    std::vector<ble_gattc_desc_t> descriptors;
+};
+
+struct DiscoveredService
+{
+    ble_gattc_service_t service;
+    std::vector<DiscoveredCharacteristic> characteristics;
+};
+
+// Identity of a peer, its address or its IRK once bonded, as given by the application
+typedef std::vector<uint8_t> gatt_cache_key_t;
+
+struct GattCacheEntry
+{
+    std::vector<DiscoveredService> services;
+    std::vector<uint8_t> databaseHash; // Empty if the server has no Database Hash characteristic
+};
+
+/*
+ * Attribute tables discovered on earlier connections, by peer identity, so that a known peer does not have to be
+ * discovered again on every connection. The cache is kept in memory and saved to and loaded from a file in a
+ * compact binary format:
+ *
+ *   "GATC", version (1 byte), entry count (4 bytes), then for each entry
+ *   key length (1 byte), key, database hash length (1 byte), database hash, service count (2 bytes), and for each
+ *   service: start handle, end handle, UUID, characteristic count, and for each characteristic: UUID, properties
+ *   (1 byte), extended properties (1 byte), declaration handle, value handle, descriptor count, and for each
+ *   descriptor: handle, UUID.
+ *
+ * Handles and counts are 2 bytes, UUIDs are the 2 byte UUID and the 1 byte type, all little endian. Vendor specific
+ * UUID types are only valid as long as the same UUIDs are added to the SoftDevice in the same order.
+ */
+class GattCache
+{
+public:
+    bool find(const gatt_cache_key_t &key, GattCacheEntry &entry);
+    void store(const gatt_cache_key_t &key, const GattCacheEntry &entry);
+    bool remove(const gatt_cache_key_t &key);
+    void clear();
+    uint32_t getEntryCount();
+
+    // save replaces the file, load replaces all entries in memory. NRF_ERROR_NOT_FOUND if the file can not be
+    // opened, NRF_ERROR_INVALID_DATA if it is not a cache file, NRF_ERROR_INTERNAL if it can not be written.
+    uint32_t save(const std::string &path);
+    uint32_t load(const std::string &path);
+
+    static void encode(const std::map<gatt_cache_key_t, GattCacheEntry> &entries, std::vector<uint8_t> &data);
+    static bool decode(const std::vector<uint8_t> &data, std::map<gatt_cache_key_t, GattCacheEntry> &entries);
+
+private:
+    std::mutex cacheMutex;
+    std::map<gatt_cache_key_t, GattCacheEntry> entries;
+};
+
+#endif // GATT_CACHE_H
@@ -0,0 +1,610 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "gatt_discovery.h"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+#include "ble.h"
+#include "ble_gattc.h"
+
+static const uint32_t LAST_HANDLE = 0xFFFF;
+static const uint16_t UUID_DATABASE_HASH = 0x2B2A; // Not defined by the SoftDevice headers
+
+static uint16_t findServiceChangedHandle(const std::vector<DiscoveredService> &services)
+{
+    for (auto &service : services)
+    {
+        for (auto &characteristic : service.characteristics)
+        {
+            auto &uuid = characteristic.characteristic.uuid;
+
+            if (uuid.type == BLE_UUID_TYPE_BLE && uuid.uuid == BLE_UUID_GATT_CHARACTERISTIC_SERVICE_CHANGED)
+            {
+                return characteristic.characteristic.handle_value;
+            }
+        }
+    }
+
+    return BLE_GATT_HANDLE_INVALID;
+}
+
+GattDiscovery::GattDiscovery(gatt_discovery_report_cb reportCallback, void *context) :
+    reportCallback(reportCallback),
+    context(context),
+    nextId(1),
+    asyncReport(nullptr),
+    pendingCount(0)
+{}
+
+GattDiscovery::~GattDiscovery()
+{
+    if (asyncReport == nullptr)
+    {
+        return;
+    }
+
+    auto handle = reinterpret_cast<uv_handle_t *>(asyncReport);
+    uv_close(handle, [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+
+    asyncReport = nullptr;
+}
+
+uint32_t GattDiscovery::add(uint16_t connHandle, const gatt_cache_key_t &cacheKey, bool validateHash)
+{
+    if (asyncReport == nullptr)
+    {
+        asyncReport = new uv_async_t();
+        asyncReport->data = static_cast<void *>(this);
+
+        if (uv_async_init(uv_default_loop(), asyncReport, [](uv_async_t *handle) {
+            static_cast<GattDiscovery *>(handle->data)->onReport();
+        }) != 0)
+        {
+            std::cerr << "Not able to create the GATT discovery async handler." << std::endl;
+            std::terminate();
+        }
+
+        // Only keeps the event loop alive while discoveries are running
+        uv_unref(reinterpret_cast<uv_handle_t *>(asyncReport));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(discoveryMutex);
+
+        if (discoveries.find(connHandle) != discoveries.end())
+        {
+            return NRF_ERROR_BUSY;
+        }
+
+        auto &discovery = discoveries[connHandle];
+        discovery.id = nextId++;
+        discovery.adapter = nullptr;
+        discovery.step = Step::SERVICES;
+        discovery.serviceIndex = 0;
+        discovery.characteristicIndex = 0;
+        discovery.nextHandle = 1;
+        discovery.awaitingResponse = false;
+        discovery.cacheKey = cacheKey;
+        discovery.validateHash = validateHash;
+        discovery.inCache = false;
+        discovery.result.connHandle = connHandle;
+        discovery.result.error = NRF_SUCCESS;
+        discovery.result.gattStatus = BLE_GATT_STATUS_SUCCESS;
+        discovery.result.cached = false;
+    }
+
+    if (pendingCount++ == 0)
+    {
+        uv_ref(reinterpret_cast<uv_handle_t *>(asyncReport));
+    }
+
+    return NRF_SUCCESS;
+}
+
+void GattDiscovery::start(adapter_t *adapter, uint16_t connHandle)
+{
+    std::unique_lock<std::mutex> lock(discoveryMutex);
+    auto it = discoveries.find(connHandle);
+
+    if (it == discoveries.end())
+    {
+        return;
+    }
+
+    auto &discovery = it->second;
+    discovery.adapter = adapter;
+
+    if (!discovery.cacheKey.empty())
+    {
+        discovery.inCache = cache.find(discovery.cacheKey, discovery.cacheEntry);
+
+        if (discovery.validateHash)
+        {
+            discovery.step = Step::DATABASE_HASH;
+        }
+        else if (discovery.inCache)
+        {
+            discovery.result.services = discovery.cacheEntry.services;
+            discovery.result.cached = true;
+            discovery.step = Step::DONE;
+        }
+    }
+
+    proceed(lock, it);
+}
+
+bool GattDiscovery::onEvent(const ble_evt_t *event)
+{
+    auto evtId = event->header.evt_id;
+
+    if (evtId == BLE_GATTC_EVT_HVX)
+    {
+        onServiceChanged(event);
+        return false;
+    }
+
+    if (evtId != BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP
+        && evtId != BLE_GATTC_EVT_CHAR_DISC_RSP
+        && evtId != BLE_GATTC_EVT_DESC_DISC_RSP
+        && evtId != BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP
+        && evtId != BLE_GATTC_EVT_TIMEOUT
+        && evtId != BLE_GAP_EVT_DISCONNECTED)
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(discoveryMutex);
+
+    // Timeouts and disconnects stop the discovery, but are still passed on
+    if (evtId == BLE_GAP_EVT_DISCONNECTED)
+    {
+        auto connHandle = event->evt.gap_evt.conn_handle;
+        auto it = discoveries.find(connHandle);
+
+        cachedConnections.erase(connHandle);
+
+        if (it != discoveries.end())
+        {
+            complete(it, BLE_ERROR_INVALID_CONN_HANDLE, BLE_GATT_STATUS_SUCCESS);
+        }
+
+        return false;
+    }
+
+    if (discoveries.empty())
+    {
+        return false;
+    }
+
+    auto &gattcEvent = event->evt.gattc_evt;
+    auto it = discoveries.find(gattcEvent.conn_handle);
+
+    if (it == discoveries.end())
+    {
+        return false;
+    }
+
+    if (evtId == BLE_GATTC_EVT_TIMEOUT)
+    {
+        complete(it, NRF_ERROR_TIMEOUT, BLE_GATT_STATUS_SUCCESS);
+        return false;
+    }
+
+    auto step = it->second.step;
+
+    // Responses to procedures that are not part of the discovery are passed on
+    if (!it->second.awaitingResponse || !onResponse(it->second, evtId, gattcEvent))
+    {
+        return false;
+    }
+
+    it->second.awaitingResponse = false;
+
+    auto gattStatus = gattcEvent.gatt_status;
+
+    // A server that does not let the database hash be read is discovered as if it had none
+    if (step != Step::DATABASE_HASH
+        && gattStatus != BLE_GATT_STATUS_SUCCESS
+        && gattStatus != BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        complete(it, NRF_SUCCESS, gattStatus);
+        return true;
+    }
+
+    proceed(lock, it);
+    return true;
+}
+
+// Adds the attributes of a response to the discovery, and moves it on to the handle after them
+bool GattDiscovery::onResponse(Discovery &discovery, uint16_t evtId, const ble_gattc_evt_t &gattcEvent)
+{
+    auto &services = discovery.result.services;
+    auto success = gattcEvent.gatt_status == BLE_GATT_STATUS_SUCCESS;
+
+    switch (discovery.step)
+    {
+        case Step::DATABASE_HASH:
+        {
+            if (evtId != BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP)
+            {
+                return false;
+            }
+
+            auto &response = gattcEvent.params.char_val_by_uuid_read_rsp;
+            std::vector<uint8_t> databaseHash;
+
+            if (success && response.count > 0)
+            {
+                auto value = response.handle_value[0].p_value;
+                databaseHash.assign(value, value + response.value_len);
+            }
+
+            // Without a hash to compare, the cached attribute table can not be trusted
+            if (discovery.inCache && !databaseHash.empty() && databaseHash == discovery.cacheEntry.databaseHash)
+            {
+                discovery.result.services = discovery.cacheEntry.services;
+                discovery.result.cached = true;
+                discovery.step = Step::DONE;
+            }
+            else
+            {
+                discovery.cacheEntry.databaseHash = databaseHash;
+                discovery.step = Step::SERVICES;
+                discovery.nextHandle = 1;
+            }
+
+            return true;
+        }
+
+        case Step::SERVICES:
+        {
+            if (evtId != BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP)
+            {
+                return false;
+            }
+
+            auto &response = gattcEvent.params.prim_srvc_disc_rsp;
+
+            if (!success || response.count == 0)
+            {
+                discovery.nextHandle = LAST_HANDLE + 1;
+            }
+            else
+            {
+                for (auto i = 0; i < response.count; ++i)
+                {
+                    DiscoveredService service;
+                    service.service = response.services[i];
+                    services.push_back(service);
+                }
+
+                discovery.nextHandle = static_cast<uint32_t>(response.services[response.count - 1].handle_range.end_handle) + 1;
+            }
+
+            if (discovery.nextHandle > LAST_HANDLE)
+            {
+                discovery.step = Step::CHARACTERISTICS;
+                discovery.serviceIndex = 0;
+                discovery.nextHandle = 0;
+            }
+
+            return true;
+        }
+
+        case Step::CHARACTERISTICS:
+        {
+            if (evtId != BLE_GATTC_EVT_CHAR_DISC_RSP)
+            {
+                return false;
+            }
+
+            auto &response = gattcEvent.params.char_disc_rsp;
+            auto &characteristics = services[discovery.serviceIndex].characteristics;
+
+            if (!success || response.count == 0)
+            {
+                discovery.serviceIndex++;
+                discovery.nextHandle = 0;
+                return true;
+            }
+
+            for (auto i = 0; i < response.count; ++i)
+            {
+                DiscoveredCharacteristic characteristic;
+                characteristic.characteristic = response.chars[i];
+                characteristics.push_back(characteristic);
+            }
+
+            discovery.nextHandle = static_cast<uint32_t>(response.chars[response.count - 1].handle_decl) + 1;
+            return true;
+        }
+
+        case Step::DESCRIPTORS:
+        {
+            if (evtId != BLE_GATTC_EVT_DESC_DISC_RSP)
+            {
+                return false;
+            }
+
+            auto &response = gattcEvent.params.desc_disc_rsp;
+            auto &descriptors = services[discovery.serviceIndex].characteristics[discovery.characteristicIndex].descriptors;
+
+            if (!success || response.count == 0)
+            {
+                discovery.characteristicIndex++;
+                discovery.nextHandle = 0;
+                return true;
+            }
+
+            descriptors.insert(descriptors.end(), response.descs, response.descs + response.count);
+            discovery.nextHandle = static_cast<uint32_t>(response.descs[response.count - 1].handle) + 1;
+            return true;
+        }
+
+        case Step::DONE:
+            return false;
+    }
+
+    return false;
+}
+
+// Finds the range of the next discovery call, moving on to the next service or characteristic when one is done.
+// Returns false when the whole attribute table has been discovered.
+bool GattDiscovery::prepareRequest(Discovery &discovery, Request &request)
+{
+    auto &services = discovery.result.services;
+
+    while (true)
+    {
+        switch (discovery.step)
+        {
+            case Step::DATABASE_HASH:
+                request.step = Step::DATABASE_HASH;
+                request.range.start_handle = 1;
+                request.range.end_handle = LAST_HANDLE;
+                return true;
+
+            case Step::DONE:
+                return false;
+
+            case Step::SERVICES:
+                request.step = Step::SERVICES;
+                request.range.start_handle = static_cast<uint16_t>(discovery.nextHandle);
+                request.range.end_handle = LAST_HANDLE;
+                return true;
+
+            case Step::CHARACTERISTICS:
+            {
+                if (discovery.serviceIndex >= services.size())
+                {
+                    discovery.step = Step::DESCRIPTORS;
+                    discovery.serviceIndex = 0;
+                    discovery.characteristicIndex = 0;
+                    discovery.nextHandle = 0;
+                    break;
+                }
+
+                auto &range = services[discovery.serviceIndex].service.handle_range;
+                auto startHandle = discovery.nextHandle == 0 ? range.start_handle : discovery.nextHandle;
+
+                if (startHandle > range.end_handle)
+                {
+                    discovery.serviceIndex++;
+                    discovery.nextHandle = 0;
+                    break;
+                }
+
+                request.step = Step::CHARACTERISTICS;
+                request.range.start_handle = static_cast<uint16_t>(startHandle);
+                request.range.end_handle = range.end_handle;
+                return true;
+            }
+
+            case Step::DESCRIPTORS:
+            {
+                if (discovery.serviceIndex >= services.size())
+                {
+                    return false;
+                }
+
+                auto &service = services[discovery.serviceIndex];
+                auto &characteristics = service.characteristics;
+
+                if (discovery.characteristicIndex >= characteristics.size())
+                {
+                    discovery.serviceIndex++;
+                    discovery.characteristicIndex = 0;
+                    discovery.nextHandle = 0;
+                    break;
+                }
+
+                // The descriptors of a characteristic are between its value and the next characteristic of the service
+                auto index = discovery.characteristicIndex;
+                auto startHandle = discovery.nextHandle == 0
+                    ? static_cast<uint32_t>(characteristics[index].characteristic.handle_value) + 1
+                    : discovery.nextHandle;
+                uint32_t endHandle = index + 1 < characteristics.size()
+                    ? characteristics[index + 1].characteristic.handle_decl - 1
+                    : service.service.handle_range.end_handle;
+
+                if (startHandle > endHandle)
+                {
+                    discovery.characteristicIndex++;
+                    discovery.nextHandle = 0;
+                    break;
+                }
+
+                request.step = Step::DESCRIPTORS;
+                request.range.start_handle = static_cast<uint16_t>(startHandle);
+                request.range.end_handle = static_cast<uint16_t>(endHandle);
+                return true;
+            }
+        }
+    }
+}
+
+// Makes the next discovery call outside the lock, or completes the discovery
+void GattDiscovery::proceed(std::unique_lock<std::mutex> &lock, discovery_it_t it)
+{
+    Request request;
+
+    if (!prepareRequest(it->second, request))
+    {
+        complete(it, NRF_SUCCESS, BLE_GATT_STATUS_SUCCESS);
+        return;
+    }
+
+    auto connHandle = it->first;
+    auto id = it->second.id;
+    auto adapter = it->second.adapter;
+    uint32_t err_code;
+
+    // The response may arrive before the call returns
+    it->second.awaitingResponse = true;
+    lock.unlock();
+
+    switch (request.step)
+    {
+        case Step::DATABASE_HASH:
+        {
+            ble_uuid_t uuid;
+            uuid.uuid = UUID_DATABASE_HASH;
+            uuid.type = BLE_UUID_TYPE_BLE;
+            err_code = sd_ble_gattc_char_value_by_uuid_read(adapter, connHandle, &uuid, &request.range);
+            break;
+        }
+        case Step::SERVICES:
+            err_code = sd_ble_gattc_primary_services_discover(adapter, connHandle, request.range.start_handle, nullptr);
+            break;
+        case Step::CHARACTERISTICS:
+            err_code = sd_ble_gattc_characteristics_discover(adapter, connHandle, &request.range);
+            break;
+        default:
+            err_code = sd_ble_gattc_descriptors_discover(adapter, connHandle, &request.range);
+            break;
+    }
+
+    lock.lock();
+
+    if (err_code == NRF_SUCCESS)
+    {
+        return;
+    }
+
+    // The discovery may have been stopped by a disconnect while the call was made
+    it = discoveries.find(connHandle);
+
+    if (it != discoveries.end() && it->second.id == id)
+    {
+        complete(it, err_code, BLE_GATT_STATUS_SUCCESS);
+    }
+}
+
+void GattDiscovery::complete(discovery_it_t it, uint32_t error, uint16_t gattStatus)
+{
+    auto &discovery = it->second;
+    auto &result = discovery.result;
+    result.error = error;
+    result.gattStatus = gattStatus;
+
+    if (error == NRF_SUCCESS && gattStatus == BLE_GATT_STATUS_SUCCESS && !discovery.cacheKey.empty())
+    {
+        if (!result.cached)
+        {
+            GattCacheEntry entry;
+            entry.services = result.services;
+            entry.databaseHash = discovery.cacheEntry.databaseHash;
+            cache.store(discovery.cacheKey, entry);
+        }
+
+        CachedConnection cachedConnection;
+        cachedConnection.cacheKey = discovery.cacheKey;
+        cachedConnection.serviceChangedHandle = findServiceChangedHandle(result.services);
+        cachedConnections[it->first] = cachedConnection;
+    }
+
+    completed.push_back(std::move(result));
+    discoveries.erase(it);
+
+    uv_async_send(asyncReport);
+}
+
+// Runs in the NodeJS thread, uv_async_send may have coalesced the notifications of several discoveries
+void GattDiscovery::onReport()
+{
+    std::vector<GattDiscoveryResult> results;
+
+    {
+        std::lock_guard<std::mutex> lock(discoveryMutex);
+        results.swap(completed);
+    }
+
+    for (auto &result : results)
+    {
+        reportCallback(context, result);
+    }
+
+    pendingCount -= static_cast<uint32_t>(results.size());
+
+    if (pendingCount == 0)
+    {
+        uv_unref(reinterpret_cast<uv_handle_t *>(asyncReport));
+    }
+}
+
+// The attribute table of the peer is removed from the cache, the application is still to confirm the indication
+void GattDiscovery::onServiceChanged(const ble_evt_t *event)
+{
+    auto &gattcEvent = event->evt.gattc_evt;
+
+    std::lock_guard<std::mutex> lock(discoveryMutex);
+    auto it = cachedConnections.find(gattcEvent.conn_handle);
+
+    if (it == cachedConnections.end()
+        || it->second.serviceChangedHandle == BLE_GATT_HANDLE_INVALID
+        || it->second.serviceChangedHandle != gattcEvent.params.hvx.handle)
+    {
+        return;
+    }
+
+    cache.remove(it->second.cacheKey);
+    cachedConnections.erase(it);
+}
+
+void GattDiscovery::failAll(uint32_t error)
+{
+    std::lock_guard<std::mutex> lock(discoveryMutex);
+
+    // Connection handles are reused when the adapter is opened again
+    cachedConnections.clear();
+
+    while (!discoveries.empty())
+    {
+        complete(discoveries.begin(), error, BLE_GATT_STATUS_SUCCESS);
+    }
+}
+
+GattCache &GattDiscovery::getCache()
+{
+    return cache;
+}
+
+uint32_t GattDiscovery::getDiscoveryCount()
+{
+    std::lock_guard<std::mutex> lock(discoveryMutex);
+    return static_cast<uint32_t>(discoveries.size());
+}
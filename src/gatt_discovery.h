@@ -0,0 +1,139 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef GATT_DISCOVERY_H
+#define GATT_DISCOVERY_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+#include <uv.h>
+
+#include "sd_rpc.h"
+
+#include "gatt_cache.h"
+
+// Attribute table of the server on one connection, reported to the NodeJS thread
+struct GattDiscoveryResult
+{
+    uint16_t connHandle;
+    uint32_t error;      // NRF_SUCCESS unless a discovery call failed or the connection is gone
+    uint16_t gattStatus; // Status of the response that stopped the discovery, if not error
+    bool cached;         // The services are from the cache, and were not discovered on this connection
+    std::vector<DiscoveredService> services;
+};
+
+typedef void (*gatt_discovery_report_cb)(void *context, GattDiscoveryResult &result);
+
+/*
+ * Discovers the primary services of the server on a connection, the characteristics of each service and the
+ * descriptors of each characteristic. Each discovery call is made from the driver event thread as the response to
+ * the previous one arrives, and the responses are not passed on to JavaScript. The whole attribute table is
+ * reported in the NodeJS thread when the discovery is done.
+ *
+ * Vendor specific UUIDs that are not registered with the SoftDevice are reported with type BLE_UUID_TYPE_UNKNOWN,
+ * reading the declarations to find them is left to the caller.
+ *
+ * A discovery with a cache key is answered from the cache when the peer has been discovered before, and the
+ * attribute table discovered is stored in the cache otherwise. With validateHash, the Database Hash characteristic
+ * is read first, and the cached table is only used if the hash has not changed. A Service Changed indication from
+ * a peer removes its attribute table from the cache.
+ */
+class GattDiscovery
+{
+public:
+    GattDiscovery(gatt_discovery_report_cb reportCallback, void *context);
+    ~GattDiscovery();
+
+    // Called from the NodeJS thread, NRF_ERROR_BUSY if a discovery is running on the connection
+    uint32_t add(uint16_t connHandle, const gatt_cache_key_t &cacheKey, bool validateHash);
+
+    // Called from the adapter executor thread after add, makes the first discovery call
+    void start(adapter_t *adapter, uint16_t connHandle);
+
+    // Called from the driver event thread. Returns true if the event is a response to a discovery and is consumed.
+    bool onEvent(const ble_evt_t *event);
+
+    // Called from the NodeJS thread when the adapter is closed, no responses, timeouts or disconnects arrive after
+    // it. Completes all discoveries with error, and forgets the peers of the connections.
+    void failAll(uint32_t error);
+
+    uint32_t getDiscoveryCount();
+
+    GattCache &getCache();
+
+private:
+    enum class Step
+    {
+        DATABASE_HASH,
+        SERVICES,
+        CHARACTERISTICS,
+        DESCRIPTORS,
+        DONE
+    };
+
+    struct Discovery
+    {
+        uint32_t id;
+        adapter_t *adapter;
+        Step step;
+        size_t serviceIndex;
+        size_t characteristicIndex;
+        uint32_t nextHandle; // 0 to start at the beginning of the current service or characteristic
+        bool awaitingResponse;
+        gatt_cache_key_t cacheKey;
+        bool validateHash;
+        bool inCache;
+        GattCacheEntry cacheEntry; // Found in the cache, or the database hash read for storing in the cache
+        GattDiscoveryResult result;
+    };
+
+    // Peer of a connection whose attribute table is in the cache
+    struct CachedConnection
+    {
+        gatt_cache_key_t cacheKey;
+        uint16_t serviceChangedHandle; // BLE_GATT_HANDLE_INVALID if the server has no Service Changed characteristic
+    };
+
+    struct Request
+    {
+        Step step;
+        ble_gattc_handle_range_t range;
+    };
+
+    typedef std::map<uint16_t, Discovery>::iterator discovery_it_t;
+
+    bool onResponse(Discovery &discovery, uint16_t evtId, const ble_gattc_evt_t &gattcEvent);
+    bool prepareRequest(Discovery &discovery, Request &request);
+    void proceed(std::unique_lock<std::mutex> &lock, discovery_it_t it);
+    void complete(discovery_it_t it, uint32_t error, uint16_t gattStatus);
+    void onReport();
+    void onServiceChanged(const ble_evt_t *event);
+
+    gatt_discovery_report_cb reportCallback;
+    void *context;
+
+    std::mutex discoveryMutex;
+    std::map<uint16_t, Discovery> discoveries; // By connection handle
+    std::map<uint16_t, CachedConnection> cachedConnections;
+    GattCache cache;
+    std::vector<GattDiscoveryResult> completed;
+    uint32_t nextId;
+
+    uv_async_t *asyncReport;
+    uint32_t pendingCount; // Only used in the NodeJS thread
+};
+
+#endif // GATT_DISCOVERY_H
@@ -0,0 +1,441 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "notification_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "ble.h"
+#include "ble_gatts.h"
+
+NotificationStreams::NotificationStreams(notification_stream_report_cb reportCallback, void *context, TxCredits &txCredits) :
+    reportCallback(reportCallback),
+    context(context),
+    txCredits(txCredits),
+    nextId(1),
+    lastSentId(0),
+    stopping(false),
+    asyncReport(nullptr),
+    referenced(false)
+{
+    txCredits.setReturnedCallback([](void *context) {
+        static_cast<NotificationStreams *>(context)->onCreditsReturned();
+    }, this);
+}
+
+NotificationStreams::~NotificationStreams()
+{
+    txCredits.setReturnedCallback(nullptr, nullptr);
+
+    if (asyncReport == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        stopping = true;
+    }
+
+    streamCondition.notify_one();
+    thread.join();
+
+    for (auto &stream : streams)
+    {
+        delete stream.second;
+    }
+
+    streams.clear();
+
+    auto handle = reinterpret_cast<uv_handle_t *>(asyncReport);
+    uv_close(handle, [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+
+    asyncReport = nullptr;
+}
+
+void NotificationStreams::start()
+{
+    asyncReport = new uv_async_t();
+    asyncReport->data = static_cast<void *>(this);
+
+    if (uv_async_init(uv_default_loop(), asyncReport, [](uv_async_t *handle) {
+        static_cast<NotificationStreams *>(handle->data)->onReport();
+    }) != 0)
+    {
+        std::cerr << "Not able to create the notification stream async handler." << std::endl;
+        std::terminate();
+    }
+
+    // Only keeps the event loop alive while streams have data to send
+    uv_unref(reinterpret_cast<uv_handle_t *>(asyncReport));
+
+    thread = std::thread(&NotificationStreams::run, this);
+}
+
+uint32_t NotificationStreams::open(adapter_t *adapter, uint16_t connHandle, uint16_t valueHandle, uint32_t *id)
+{
+    sd_rpc_conn_state_t state;
+    auto err_code = sd_rpc_conn_state_get(adapter, connHandle, &state);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (asyncReport == nullptr)
+    {
+        start();
+    }
+
+    auto stream = new Stream();
+    stream->adapter = adapter;
+    stream->connHandle = connHandle;
+    stream->valueHandle = valueHandle;
+    stream->packetLength = static_cast<uint16_t>(std::max<int>(state.att_mtu - 3, 1)); // Opcode and handle
+    stream->bytesSent = 0;
+    stream->packetsSent = 0;
+    stream->error = NRF_SUCCESS;
+    stream->closing = false;
+    stream->reportPending = false;
+
+    std::lock_guard<std::mutex> lock(streamMutex);
+    stream->id = nextId++;
+    streams[stream->id] = stream;
+
+    *id = stream->id;
+    return NRF_SUCCESS;
+}
+
+uint32_t NotificationStreams::write(uint32_t id, const uint8_t *data, size_t length)
+{
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        auto found = streams.find(id);
+
+        if (found == streams.end())
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+
+        auto stream = found->second;
+
+        if (stream->error != NRF_SUCCESS)
+        {
+            return stream->error;
+        }
+
+        if (stream->closing)
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+
+        stream->data.insert(stream->data.end(), data, data + length);
+    }
+
+    streamCondition.notify_one();
+    updateRef();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t NotificationStreams::close(uint32_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        auto found = streams.find(id);
+
+        if (found == streams.end())
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+
+        auto stream = found->second;
+
+        if (stream->closing)
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+
+        stream->closing = true;
+
+        if (isFinished(stream))
+        {
+            signalReport(stream);
+        }
+    }
+
+    updateRef();
+
+    return NRF_SUCCESS;
+}
+
+void NotificationStreams::onEvent(const ble_evt_t *event)
+{
+    if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        failStreams(event->evt.gap_evt.conn_handle, BLE_ERROR_INVALID_CONN_HANDLE);
+    }
+}
+
+// Called by TxCredits without its lock held, a stream waiting for credits may be ready now
+void NotificationStreams::onCreditsReturned()
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+    streamCondition.notify_one();
+}
+
+uint32_t NotificationStreams::getStreamCount()
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+    return static_cast<uint32_t>(streams.size());
+}
+
+void NotificationStreams::run()
+{
+    std::unique_lock<std::mutex> lock(streamMutex);
+    std::vector<uint8_t> packet;
+
+    while (true)
+    {
+        Stream *stream = nullptr;
+        streamCondition.wait(lock, [&] { return stopping || (stream = nextReadyStream()) != nullptr; });
+
+        if (stopping)
+        {
+            return;
+        }
+
+        auto adapter = stream->adapter;
+        auto connHandle = stream->connHandle;
+        auto id = stream->id;
+
+        lock.unlock();
+        uint32_t returnCount;
+        auto err_code = txCredits.take(adapter, connHandle, &returnCount);
+        lock.lock();
+
+        if (err_code == BLE_ERROR_NO_TX_PACKETS || err_code == NRF_ERROR_INVALID_STATE)
+        {
+            // Another thread took the last credit, or the adapter is being destroyed
+            continue;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            failStreams(connHandle, err_code);
+            continue;
+        }
+
+        // The stream may have failed, or have been removed, while the credit was taken
+        auto taken = streams.find(id);
+
+        if (taken == streams.end() || taken->second->error != NRF_SUCCESS || taken->second->data.empty())
+        {
+            lock.unlock();
+            txCredits.giveBack(connHandle);
+            lock.lock();
+            continue;
+        }
+
+        stream = taken->second;
+
+        auto length = std::min(static_cast<size_t>(stream->packetLength), stream->data.size());
+        packet.assign(stream->data.begin(), stream->data.begin() + length);
+
+        ble_gatts_hvx_params_t hvx_params;
+        auto hvx_length = static_cast<uint16_t>(length);
+        memset(&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = stream->valueHandle;
+        hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.p_len = &hvx_length;
+        hvx_params.p_data = packet.data();
+
+        // TxCredits calls onCreditsReturned, so it is not called with the lock held
+        lock.unlock();
+        err_code = sd_ble_gatts_hvx(adapter, connHandle, &hvx_params);
+
+        if (err_code == BLE_ERROR_NO_TX_PACKETS)
+        {
+            // Packets were sent without taking credits, wait for them to complete
+            txCredits.noTxPackets(connHandle, returnCount);
+        }
+        else if (err_code != NRF_SUCCESS)
+        {
+            txCredits.giveBack(connHandle);
+        }
+
+        lock.lock();
+
+        lastSentId = id;
+
+        // The stream is removed by the NodeJS thread if it failed meanwhile
+        auto found = streams.find(id);
+
+        if (found == streams.end() || found->second->error != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        stream = found->second;
+
+        if (err_code == NRF_SUCCESS)
+        {
+            auto sent = (hvx_length == 0 || hvx_length > length) ? length : hvx_length;
+            stream->data.erase(stream->data.begin(), stream->data.begin() + sent);
+            stream->bytesSent += sent;
+            stream->packetsSent++;
+
+            signalReport(stream);
+        }
+        else if (err_code != BLE_ERROR_NO_TX_PACKETS)
+        {
+            stream->error = err_code;
+            stream->data.clear();
+            signalReport(stream);
+        }
+    }
+}
+
+// Streams take turns, starting with the first stream after the one that sent last
+NotificationStreams::Stream *NotificationStreams::nextReadyStream()
+{
+    auto first = streams.upper_bound(lastSentId);
+
+    for (size_t i = 0; i < streams.size(); i++, first++)
+    {
+        if (first == streams.end())
+        {
+            first = streams.begin();
+        }
+
+        auto stream = first->second;
+
+        if (stream->error != NRF_SUCCESS || stream->data.empty())
+        {
+            continue;
+        }
+
+        if (txCredits.isAvailable(stream->connHandle))
+        {
+            return stream;
+        }
+    }
+
+    return nullptr;
+}
+
+bool NotificationStreams::isFinished(const Stream *stream) const
+{
+    return stream->error != NRF_SUCCESS || (stream->closing && stream->data.empty());
+}
+
+void NotificationStreams::failStreams(uint16_t connHandle, uint32_t error)
+{
+    for (auto &entry : streams)
+    {
+        auto stream = entry.second;
+
+        if (stream->connHandle == connHandle && stream->error == NRF_SUCCESS)
+        {
+            stream->error = error;
+            stream->data.clear();
+            signalReport(stream);
+        }
+    }
+}
+
+void NotificationStreams::signalReport(Stream *stream)
+{
+    stream->reportPending = true;
+    uv_async_send(asyncReport);
+}
+
+// Runs in the NodeJS thread, uv_async_send may have coalesced the reports of many packets
+void NotificationStreams::onReport()
+{
+    std::vector<NotificationStreamProgress> reports;
+
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+
+        for (auto entry = streams.begin(); entry != streams.end();)
+        {
+            auto stream = entry->second;
+            auto finished = isFinished(stream);
+
+            if (stream->reportPending || finished)
+            {
+                NotificationStreamProgress progress;
+                progress.id = stream->id;
+                progress.bytesQueued = static_cast<uint32_t>(stream->data.size());
+                progress.bytesSent = stream->bytesSent;
+                progress.packetsSent = stream->packetsSent;
+                progress.error = stream->error;
+                progress.finished = finished;
+                reports.push_back(progress);
+
+                stream->reportPending = false;
+            }
+
+            if (finished)
+            {
+                delete stream;
+                entry = streams.erase(entry);
+            }
+            else
+            {
+                ++entry;
+            }
+        }
+    }
+
+    updateRef();
+
+    if (!reports.empty())
+    {
+        reportCallback(context, reports);
+    }
+}
+
+// Keeps the event loop alive while a stream has data to send or a report to deliver
+void NotificationStreams::updateRef()
+{
+    auto busy = false;
+
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+
+        for (auto &entry : streams)
+        {
+            auto stream = entry.second;
+
+            if (!stream->data.empty() || stream->closing || stream->error != NRF_SUCCESS)
+            {
+                busy = true;
+                break;
+            }
+        }
+    }
+
+    if (busy != referenced)
+    {
+        auto handle = reinterpret_cast<uv_handle_t *>(asyncReport);
+        busy ? uv_ref(handle) : uv_unref(handle);
+        referenced = busy;
+    }
+}
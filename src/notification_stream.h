@@ -0,0 +1,110 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef NOTIFICATION_STREAM_H
+#define NOTIFICATION_STREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+#include <uv.h>
+
+#include "sd_rpc.h"
+
+#include "tx_credits.h"
+
+// Progress of a notification stream, reported to the NodeJS thread
+struct NotificationStreamProgress
+{
+    uint32_t id;
+    uint32_t bytesQueued;  // Written to the stream and not yet sent
+    uint64_t bytesSent;
+    uint64_t packetsSent;
+    uint32_t error;        // NRF_SUCCESS unless the stream has failed
+    bool finished;         // Closed and all data sent, or failed. The stream is removed after this report.
+};
+
+typedef void (*notification_stream_report_cb)(void *context, const std::vector<NotificationStreamProgress> &reports);
+
+/*
+ * Sends the data written to a stream as notifications of one characteristic value on one connection, split into
+ * packets of the ATT MTU of the connection. The notifications are sent from a thread of the adapter while the
+ * SoftDevice has application packets available, as counted by the TxCredits of the adapter, so the SoftDevice
+ * buffers are kept full without JavaScript taking part in sending each notification.
+ *
+ * Progress is reported in the NodeJS thread once for all packets sent since the last report, not per packet.
+ */
+class NotificationStreams
+{
+public:
+    NotificationStreams(notification_stream_report_cb reportCallback, void *context, TxCredits &txCredits);
+    ~NotificationStreams();
+
+    // Called from the NodeJS thread
+    uint32_t open(adapter_t *adapter, uint16_t connHandle, uint16_t valueHandle, uint32_t *id);
+    uint32_t write(uint32_t id, const uint8_t *data, size_t length);
+    uint32_t close(uint32_t id); // Finishes the stream when the data written has been sent
+
+    // Called from the driver event thread, before the event is queued for the NodeJS thread
+    void onEvent(const ble_evt_t *event);
+
+    uint32_t getStreamCount();
+
+private:
+    struct Stream
+    {
+        uint32_t id;
+        adapter_t *adapter;
+        uint16_t connHandle;
+        uint16_t valueHandle;
+        uint16_t packetLength;  // ATT MTU - 3
+        std::deque<uint8_t> data;
+        uint64_t bytesSent;
+        uint64_t packetsSent;
+        uint32_t error;
+        bool closing;
+        bool reportPending;
+    };
+
+    void start();
+    void run();
+    void onReport();
+    Stream *nextReadyStream();
+    bool isFinished(const Stream *stream) const;
+    void failStreams(uint16_t connHandle, uint32_t error);
+    void signalReport(Stream *stream);
+    void updateRef();
+    void onCreditsReturned();
+
+    notification_stream_report_cb reportCallback;
+    void *context;
+    TxCredits &txCredits;
+
+    std::thread thread;
+    std::mutex streamMutex;
+    std::condition_variable streamCondition;
+    std::map<uint32_t, Stream *> streams;
+    uint32_t nextId;
+    uint32_t lastSentId; // Streams that are ready take turns, starting after the stream that sent last
+    bool stopping;
+
+    uv_async_t *asyncReport;
+    bool referenced; // Only used in the NodeJS thread
+};
+
+#endif // NOTIFICATION_STREAM_H
@@ -0,0 +1,230 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "tx_credits.h"
+
+#include "ble.h"
+
+TxCredits::TxCredits() :
+    stopping(false),
+    returnedCallback(nullptr),
+    context(nullptr)
+{}
+
+void TxCredits::onEvent(const ble_evt_t *event)
+{
+    if (event->header.evt_id == BLE_EVT_TX_COMPLETE)
+    {
+        std::lock_guard<std::mutex> lock(creditMutex);
+        auto found = connections.find(event->evt.common_evt.conn_handle);
+
+        // The count of a connection that has not been read yet includes the packets returned
+        if (found == connections.end())
+        {
+            return;
+        }
+
+        auto &connection = found->second;
+        auto count = event->evt.common_evt.params.tx_complete.count;
+
+        if (connection.querying)
+        {
+            connection.completedWhileQuerying += count;
+        }
+        else if (connection.count >= 0)
+        {
+            connection.count += count;
+        }
+
+        connection.returnCount++;
+    }
+    else if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        // The calls of the waiting threads then fail with BLE_ERROR_INVALID_CONN_HANDLE
+        std::lock_guard<std::mutex> lock(creditMutex);
+        connections.erase(event->evt.gap_evt.conn_handle);
+    }
+    else
+    {
+        return;
+    }
+
+    notifyReturned();
+}
+
+void TxCredits::setReturnedCallback(tx_credits_returned_cb returnedCallback, void *context)
+{
+    std::lock_guard<std::mutex> lock(creditMutex);
+    this->returnedCallback = returnedCallback;
+    this->context = context;
+}
+
+uint32_t TxCredits::take(adapter_t *adapter, uint16_t connHandle, uint32_t *returnCount)
+{
+    std::unique_lock<std::mutex> lock(creditMutex);
+
+    if (stopping)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    auto found = connections.emplace(connHandle, Connection()).first;
+
+    // The credits are read when the connection first sends, another thread may be reading them already
+    if (found->second.count < 0 && !found->second.querying)
+    {
+        found->second.querying = true;
+        found->second.completedWhileQuerying = 0;
+
+        lock.unlock();
+        uint8_t count = 0;
+        auto err_code = sd_ble_tx_packet_count_get(adapter, connHandle, &count);
+        lock.lock();
+
+        // The connection is removed if it was disconnected meanwhile
+        found = connections.find(connHandle);
+
+        if (found == connections.end())
+        {
+            return BLE_ERROR_INVALID_CONN_HANDLE;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            connections.erase(found);
+            lock.unlock();
+            notifyReturned();
+            return err_code;
+        }
+
+        found->second.querying = false;
+        found->second.count = count + found->second.completedWhileQuerying;
+
+        // Other threads may have found no credits while they were read
+        if (found->second.count > 1)
+        {
+            lock.unlock();
+            notifyReturned();
+            lock.lock();
+
+            found = connections.find(connHandle);
+
+            if (found == connections.end())
+            {
+                return BLE_ERROR_INVALID_CONN_HANDLE;
+            }
+        }
+    }
+
+    if (found->second.count <= 0)
+    {
+        return BLE_ERROR_NO_TX_PACKETS;
+    }
+
+    found->second.count--;
+    *returnCount = found->second.returnCount;
+    return NRF_SUCCESS;
+}
+
+void TxCredits::giveBack(uint16_t connHandle)
+{
+    {
+        std::lock_guard<std::mutex> lock(creditMutex);
+        auto found = connections.find(connHandle);
+
+        if (found == connections.end() || found->second.count < 0)
+        {
+            return;
+        }
+
+        found->second.count++;
+    }
+
+    notifyReturned();
+}
+
+void TxCredits::noTxPackets(uint16_t connHandle, uint32_t returnCount)
+{
+    std::lock_guard<std::mutex> lock(creditMutex);
+    auto found = connections.find(connHandle);
+
+    // Credits returned after the credit was taken are for packets the SoftDevice has now
+    if (found != connections.end() && found->second.returnCount == returnCount && found->second.count > 0)
+    {
+        found->second.count = 0;
+    }
+}
+
+bool TxCredits::isAvailable(uint16_t connHandle)
+{
+    std::lock_guard<std::mutex> lock(creditMutex);
+    auto found = connections.find(connHandle);
+
+    if (stopping)
+    {
+        return false;
+    }
+
+    // Credits that have not been read yet are read by take
+    return found == connections.end() || (!found->second.querying && found->second.count != 0);
+}
+
+bool TxCredits::wait(uint16_t connHandle, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(creditMutex);
+
+    auto returned = creditCondition.wait_for(lock, timeout, [&] {
+        auto found = connections.find(connHandle);
+        return stopping || found == connections.end() || (!found->second.querying && found->second.count != 0);
+    });
+
+    if (!returned)
+    {
+        auto found = connections.find(connHandle);
+
+        if (found != connections.end() && !found->second.querying)
+        {
+            found->second.count = -1;
+        }
+    }
+
+    return !stopping;
+}
+
+void TxCredits::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(creditMutex);
+        stopping = true;
+    }
+
+    notifyReturned();
+}
+
+void TxCredits::notifyReturned()
+{
+    creditCondition.notify_all();
+
+    tx_credits_returned_cb callback;
+    void *callbackContext;
+
+    {
+        std::lock_guard<std::mutex> lock(creditMutex);
+        callback = returnedCallback;
+        callbackContext = context;
+    }
+
+    if (callback != nullptr)
+    {
+        callback(callbackContext);
+    }
+}
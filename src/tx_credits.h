@@ -0,0 +1,90 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef TX_CREDITS_H
+#define TX_CREDITS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include <stdint.h>
+
+#include "sd_rpc.h"
+
+typedef void (*tx_credits_returned_cb)(void *context);
+
+/*
+ * Counts the application packets available on each connection of an adapter, for all the threads that send
+ * packets without JavaScript taking part, so that they do not retry calls that fail with BLE_ERROR_NO_TX_PACKETS in
+ * a busy loop. The credits of a connection are read with sd_ble_tx_packet_count_get when they are first taken, one
+ * is taken for each packet given to the SoftDevice, and they are returned by BLE_EVT_TX_COMPLETE.
+ *
+ * Threads either wait for credits with wait, or are told with the returned callback that credits were returned.
+ * A disconnect and stop also wake the waiting threads.
+ */
+class TxCredits
+{
+public:
+    TxCredits();
+
+    // Called from the driver event thread, before the event is queued for the NodeJS thread
+    void onEvent(const ble_evt_t *event);
+
+    // The callback is called from the thread that returned the credits, with no lock of TxCredits held
+    void setReturnedCallback(tx_credits_returned_cb returnedCallback, void *context);
+
+    // Takes the credit of one packet on the connection. Returns BLE_ERROR_NO_TX_PACKETS if there is none,
+    // NRF_ERROR_INVALID_STATE after stop, or the error of reading the credits. returnCount is set for noTxPackets.
+    uint32_t take(adapter_t *adapter, uint16_t connHandle, uint32_t *returnCount);
+
+    // The call the credit was taken for failed, and did not use a packet
+    void giveBack(uint16_t connHandle);
+
+    // The call the credit was taken for failed with BLE_ERROR_NO_TX_PACKETS, the packets were used by calls that
+    // did not take credits. No credits are left unless some were returned after take.
+    void noTxPackets(uint16_t connHandle, uint32_t returnCount);
+
+    // False if take would not find a credit on the connection now, without reading the credits
+    bool isAvailable(uint16_t connHandle);
+
+    // Waits until credits are returned on the connection, it is disconnected or stop is called. After the timeout
+    // the credits are read again by the next take, in case an event was lost. Returns false after stop.
+    bool wait(uint16_t connHandle, std::chrono::milliseconds timeout);
+
+    // Wakes all waiting threads and fails the calls to take made after it
+    void stop();
+
+private:
+    // Application packets available on a connection, -1 until read from the SoftDevice
+    struct Connection
+    {
+        Connection() : count(-1), querying(false), completedWhileQuerying(0), returnCount(0) {}
+        int32_t count;
+        bool querying;
+        int32_t completedWhileQuerying; // Added to the count read, so that no BLE_EVT_TX_COMPLETE is lost
+        uint32_t returnCount;           // Number of BLE_EVT_TX_COMPLETE events counted
+    };
+
+    void notifyReturned();
+
+    std::mutex creditMutex;
+    std::condition_variable creditCondition;
+    std::map<uint16_t, Connection> connections;
+    bool stopping;
+
+    tx_credits_returned_cb returnedCallback;
+    void *context;
+};
+
+#endif // TX_CREDITS_H
@@ -0,0 +1,314 @@
+/* Copyright (c) 2016 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+// Checks that the attribute tables of the GATT cache are decoded as they were encoded, that truncated files, files
+// of another version and files with trailing bytes are rejected, and that save replaces an existing file.
+// Usage: test_gatt_cache [directory]
+
+#include "gatt_cache.h"
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+
+static const size_t VERSION_OFFSET = 4; // After "GATC"
+
+static ble_uuid_t makeUuid(uint16_t uuid, uint8_t type)
+{
+    ble_uuid_t value;
+    value.uuid = uuid;
+    value.type = type;
+    return value;
+}
+
+static std::map<gatt_cache_key_t, GattCacheEntry> makeEntries()
+{
+    std::map<gatt_cache_key_t, GattCacheEntry> entries;
+
+    // A server with a Database Hash, one service with a characteristic and its CCCD, and one empty service
+    auto &first = entries[{ 0x01, 0xC0, 0xDB, 0x7D, 0x00, 0xFF, 0x12 }];
+    first.databaseHash = std::vector<uint8_t>(16, 0xA5);
+
+    DiscoveredService heartRate;
+    heartRate.service.handle_range.start_handle = 0x000C;
+    heartRate.service.handle_range.end_handle = 0xFFFF;
+    heartRate.service.uuid = makeUuid(0x180D, BLE_UUID_TYPE_BLE);
+
+    DiscoveredCharacteristic measurement;
+    measurement.characteristic.uuid = makeUuid(0x2A37, BLE_UUID_TYPE_BLE);
+    measurement.characteristic.char_props = ble_gatt_char_props_t();
+    measurement.characteristic.char_props.read = 1;
+    measurement.characteristic.char_props.notify = 1;
+    measurement.characteristic.char_props.auth_signed_wr = 1;
+    measurement.characteristic.char_ext_props = 1;
+    measurement.characteristic.handle_decl = 0x000D;
+    measurement.characteristic.handle_value = 0x000E;
+
+    ble_gattc_desc_t cccd;
+    cccd.handle = 0x000F;
+    cccd.uuid = makeUuid(0x2902, BLE_UUID_TYPE_BLE);
+    measurement.descriptors.push_back(cccd);
+
+    heartRate.characteristics.push_back(measurement);
+    first.services.push_back(heartRate);
+
+    DiscoveredService empty;
+    empty.service.handle_range.start_handle = 0x0001;
+    empty.service.handle_range.end_handle = 0x000B;
+    empty.service.uuid = makeUuid(0x1234, BLE_UUID_TYPE_VENDOR_BEGIN);
+    first.services.push_back(empty);
+
+    // A server without a Database Hash or services
+    entries[{ 0x02 }];
+
+    return entries;
+}
+
+static bool isEqual(const ble_uuid_t &a, const ble_uuid_t &b)
+{
+    return a.uuid == b.uuid && a.type == b.type;
+}
+
+static bool isEqual(const ble_gatt_char_props_t &a, const ble_gatt_char_props_t &b)
+{
+    return a.broadcast == b.broadcast && a.read == b.read && a.write_wo_resp == b.write_wo_resp && a.write == b.write
+        && a.notify == b.notify && a.indicate == b.indicate && a.auth_signed_wr == b.auth_signed_wr;
+}
+
+static bool isEqual(const DiscoveredCharacteristic &a, const DiscoveredCharacteristic &b)
+{
+    if (!isEqual(a.characteristic.uuid, b.characteristic.uuid)
+        || !isEqual(a.characteristic.char_props, b.characteristic.char_props)
+        || a.characteristic.char_ext_props != b.characteristic.char_ext_props
+        || a.characteristic.handle_decl != b.characteristic.handle_decl
+        || a.characteristic.handle_value != b.characteristic.handle_value
+        || a.descriptors.size() != b.descriptors.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.descriptors.size(); i++)
+    {
+        if (a.descriptors[i].handle != b.descriptors[i].handle || !isEqual(a.descriptors[i].uuid, b.descriptors[i].uuid))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isEqual(const GattCacheEntry &a, const GattCacheEntry &b)
+{
+    if (a.databaseHash != b.databaseHash || a.services.size() != b.services.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.services.size(); i++)
+    {
+        auto &serviceA = a.services[i];
+        auto &serviceB = b.services[i];
+
+        if (serviceA.service.handle_range.start_handle != serviceB.service.handle_range.start_handle
+            || serviceA.service.handle_range.end_handle != serviceB.service.handle_range.end_handle
+            || !isEqual(serviceA.service.uuid, serviceB.service.uuid)
+            || serviceA.characteristics.size() != serviceB.characteristics.size())
+        {
+            return false;
+        }
+
+        for (size_t j = 0; j < serviceA.characteristics.size(); j++)
+        {
+            if (!isEqual(serviceA.characteristics[j], serviceB.characteristics[j]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool isEqual(const std::map<gatt_cache_key_t, GattCacheEntry> &a, const std::map<gatt_cache_key_t, GattCacheEntry> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    for (auto &entry : a)
+    {
+        auto found = b.find(entry.first);
+
+        if (found == b.end() || !isEqual(entry.second, found->second))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool checkRoundTrip(const std::vector<uint8_t> &data, const std::map<gatt_cache_key_t, GattCacheEntry> &entries)
+{
+    std::map<gatt_cache_key_t, GattCacheEntry> decoded;
+
+    if (!GattCache::decode(data, decoded) || !isEqual(entries, decoded))
+    {
+        std::cout << "Entries decoded differ from the entries encoded" << std::endl;
+        return false;
+    }
+
+    std::map<gatt_cache_key_t, GattCacheEntry> none;
+    std::vector<uint8_t> empty;
+    GattCache::encode(none, empty);
+
+    std::map<gatt_cache_key_t, GattCacheEntry> decodedEmpty;
+
+    if (!GattCache::decode(empty, decodedEmpty) || !decodedEmpty.empty())
+    {
+        std::cout << "Empty cache not decoded" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkTruncated(const std::vector<uint8_t> &data)
+{
+    for (size_t length = 0; length < data.size(); length++)
+    {
+        std::vector<uint8_t> truncated(data.begin(), data.begin() + length);
+        std::map<gatt_cache_key_t, GattCacheEntry> decoded;
+
+        if (GattCache::decode(truncated, decoded))
+        {
+            std::cout << "Cache truncated to " << length << " of " << data.size() << " bytes was decoded" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool checkWrongVersion(const std::vector<uint8_t> &data)
+{
+    for (auto version : { 0, 2, 0xFF })
+    {
+        auto changed = data;
+        changed[VERSION_OFFSET] = static_cast<uint8_t>(version);
+        std::map<gatt_cache_key_t, GattCacheEntry> decoded;
+
+        if (GattCache::decode(changed, decoded))
+        {
+            std::cout << "Cache of version " << version << " was decoded" << std::endl;
+            return false;
+        }
+    }
+
+    auto changed = data;
+    changed[0] = 'X';
+    std::map<gatt_cache_key_t, GattCacheEntry> decoded;
+
+    if (GattCache::decode(changed, decoded))
+    {
+        std::cout << "Cache with wrong magic was decoded" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkTrailingBytes(const std::vector<uint8_t> &data)
+{
+    for (size_t count = 1; count <= 3; count++)
+    {
+        auto extended = data;
+        extended.insert(extended.end(), count, 0x00);
+        std::map<gatt_cache_key_t, GattCacheEntry> decoded;
+
+        if (GattCache::decode(extended, decoded))
+        {
+            std::cout << "Cache with " << count << " trailing bytes was decoded" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// save replaces the file left by an earlier save, and load reads back what was saved
+static bool checkSaveLoad(const std::string &directory, const std::map<gatt_cache_key_t, GattCacheEntry> &entries)
+{
+    auto path = directory + "/test_gatt_cache.bin";
+    GattCache cache;
+
+    for (auto &entry : entries)
+    {
+        cache.store(entry.first, entry.second);
+    }
+
+    auto firstKey = entries.begin()->first;
+    GattCacheEntry firstEntry;
+    cache.find(firstKey, firstEntry);
+
+    if (cache.save(path) != NRF_SUCCESS)
+    {
+        std::cout << "Failed to save the cache to " << path << std::endl;
+        return false;
+    }
+
+    cache.remove(firstKey);
+
+    if (cache.save(path) != NRF_SUCCESS)
+    {
+        std::cout << "Failed to replace the cache in " << path << std::endl;
+        return false;
+    }
+
+    GattCache loaded;
+    loaded.store(firstKey, firstEntry);
+    auto errorCode = loaded.load(path);
+    std::remove(path.c_str());
+
+    if (errorCode != NRF_SUCCESS || loaded.getEntryCount() != entries.size() - 1 || loaded.find(firstKey, firstEntry))
+    {
+        std::cout << "Cache loaded from " << path << " is not the cache saved last, error code " << errorCode << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string directory = argc > 1 ? argv[1] : ".";
+
+    auto entries = makeEntries();
+    std::vector<uint8_t> data;
+    GattCache::encode(entries, data);
+
+    auto result = checkRoundTrip(data, entries)
+        && checkTruncated(data)
+        && checkWrongVersion(data)
+        && checkTrailingBytes(data)
+        && checkSaveLoad(directory, entries);
+
+    if (!result)
+    {
+        return -1;
+    }
+
+    std::cout << "Cache of " << entries.size() << " entries in " << data.size() << " bytes decoded and saved" << std::endl;
+    return 0;
+}